@@ -7,6 +7,15 @@ function onSay(player, words, param)
 		return false
 	end
 
+	if param == "background" then
+		if cleanMap(true) then
+			player:sendTextMessage(MESSAGE_STATUS_WARNING, "Started cleaning the map in the background.")
+		else
+			player:sendTextMessage(MESSAGE_STATUS_WARNING, "The map is already being cleaned in the background.")
+		end
+		return false
+	end
+
 	local itemCount = cleanMap()
 	if itemCount > 0 then
 		player:sendTextMessage(MESSAGE_STATUS_WARNING, "Cleaned " .. itemCount .. " item" .. (itemCount > 1 and "s" or "") .. " from the map.")
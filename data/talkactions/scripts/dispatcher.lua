@@ -0,0 +1,65 @@
+function onSay(player, words, param)
+	if not player:getGroup():getAccess() then
+		return true
+	end
+
+	if player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return false
+	end
+
+	if param == "reset" then
+		Game.resetDispatcherStats()
+		Game.resetSpectatorCacheStats()
+		Game.resetFlowFieldStats()
+		Game.resetDecayStats()
+		Game.resetDescriptionCacheStats()
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, "Dispatcher statistics have been reset.")
+		return false
+	end
+
+	local lanes = Game.getDispatcherLanes()
+	for _, name in ipairs({"input", "timer", "background"}) do
+		local lane = lanes[name]
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, ("%s lane: depth %d, max depth %d, executed %d, expired %d"):format(
+			name, lane.depth, lane.maxDepth, lane.executed, lane.expired))
+	end
+
+	local spectatorCache = Game.getSpectatorCacheStats()
+	for _, name in ipairs({"creatures", "players"}) do
+		local cache = spectatorCache[name]
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, ("spectator cache (%s): %d hits, %d misses, %d stale"):format(
+			name, cache.hits, cache.misses, cache.stale))
+	end
+	player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, ("spectator scans avoided by observers: %d"):format(spectatorCache.scansAvoided))
+
+	local flowFields = Game.getFlowFieldStats()
+	player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, ("follow paths served from shared flow fields: %d of %d, %d built, %d evicted"):format(
+		flowFields.served, flowFields.requests, flowFields.built, flowFields.evicted))
+
+	for _, sizeClass in ipairs(Game.getItemAllocatorStats()) do
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, ("items of %d bytes: %d live of %d slots, %d slabs (%d bytes), %d allocations"):format(
+			sizeClass.objectSize, sizeClass.live, sizeClass.capacity, sizeClass.slabs, sizeClass.bytes, sizeClass.allocations))
+	end
+
+	local decay = Game.getDecayStats()
+	player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, ("decay: %d active items, %d expired in %d ticks, processing total %d us, max %d us"):format(
+		decay.active, decay.expired, decay.ticks, decay.processingTotal, decay.processingMax))
+
+	local descriptions = Game.getDescriptionCacheStats()
+	player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, ("item descriptions: %d cache hits, %d misses, %d uncached, built in %d us, about %d us saved"):format(
+		descriptions.hits, descriptions.misses, descriptions.uncached, descriptions.buildTime, descriptions.timeSaved))
+
+	local stats = Game.getDispatcherStats()
+	table.sort(stats, function(a, b) return a.executionTotal > b.executionTotal end)
+
+	local limit = tonumber(param) or 10
+	player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, "Dispatcher tasks by total execution time (us):")
+	for i = 1, math.min(limit, #stats) do
+		local entry = stats[i]
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, ("%s: %d tasks, total %d, exec p50 %d p99 %d max %d, wait p50 %d p99 %d max %d, over budget %d"):format(
+			entry.name, entry.count, entry.executionTotal,
+			entry.executionP50, entry.executionP99, entry.executionMax,
+			entry.waitP50, entry.waitP99, entry.waitMax, entry.overBudget))
+	end
+	return false
+end
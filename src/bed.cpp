@@ -41,11 +41,10 @@ Attr_ReadValue BedItem::readAttr(AttrTypes_t attr, PropStream& propStream)
 			}
 
 			if (guid != 0) {
-				std::string name = IOLoginData::getNameByGuid(guid);
-				if (!name.empty()) {
-					setSpecialDescription(name + " is sleeping there.");
-					g_game.setBedSleeper(this, guid);
-					sleeperGUID = guid;
+				if (deferredLoadActions) {
+					deferredLoadActions->emplace_back([this, guid]() { loadSleeper(guid); });
+				} else {
+					loadSleeper(guid);
 				}
 			}
 			return ATTR_READ_CONTINUE;
@@ -67,6 +66,16 @@ Attr_ReadValue BedItem::readAttr(AttrTypes_t attr, PropStream& propStream)
 	return Item::readAttr(attr, propStream);
 }
 
+void BedItem::loadSleeper(uint32_t guid)
+{
+	std::string name = IOLoginData::getNameByGuid(guid);
+	if (!name.empty()) {
+		setSpecialDescription(name + " is sleeping there.");
+		g_game.setBedSleeper(this, guid);
+		sleeperGUID = guid;
+	}
+}
+
 void BedItem::serializeAttr(PropWriteStream& propWriteStream) const
 {
 	if (sleeperGUID != 0) {
@@ -61,6 +61,7 @@ class BedItem final : public Item
 		BedItem* getNextBedItem() const;
 
 	private:
+		void loadSleeper(uint32_t guid);
 		void updateAppearance(const Player* player);
 		void regeneratePlayer(Player* player) const;
 		void internalSetSleeper(const Player* player);
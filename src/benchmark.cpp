@@ -0,0 +1,467 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Benchmarks of the path search, creature walk cache, sight lines, map loading and item
+// allocator. Built only by "make tfs_benchmark" and run from the directory of a server,
+// it reads config.lua, the items and the map the same way the server does.
+
+#include "otpch.h"
+
+#include "game.h"
+
+#include "bed.h"
+#include "combat.h"
+#include "configmanager.h"
+#include "container.h"
+#include "databasetasks.h"
+#include "iomap.h"
+#include "itemallocator.h"
+#include "modules.h"
+#include "pathservice.h"
+#include "rsa.h"
+#include "scheduler.h"
+#include "teleport.h"
+#include "workerpool.h"
+
+#include <boost/filesystem.hpp>
+
+//the globals otserv.cpp defines for the server, every other source file is linked in
+Database g_database;
+DatabaseTasks g_databaseTasks;
+Dispatcher g_dispatcher;
+Scheduler g_scheduler;
+WorkerPool g_workerPool;
+PathService g_pathService;
+
+Game g_game;
+ConfigManager g_config;
+Monsters g_monsters;
+Vocations g_vocations;
+Modules g_modules;
+RSA g_RSA;
+
+namespace {
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+constexpr size_t PATH_SEARCHES = 20000;
+constexpr size_t WALK_STEPS = 200000;
+constexpr size_t SIGHT_PAIRS = 2048;
+constexpr size_t SIGHT_ROUNDS = 50;
+constexpr size_t ALLOCATOR_LIVE_ITEMS = 1 << 16;
+constexpr size_t ALLOCATOR_OPERATIONS = 1 << 22;
+//radius around the first temple the positions of the path, walk and sight cases are taken from
+constexpr int32_t BENCHMARK_RADIUS = 64;
+
+//fixed seed, two runs of different builds pick the same positions
+std::mt19937 benchmarkRandom(0x5EED);
+
+int64_t elapsedNanoseconds(BenchmarkClock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(BenchmarkClock::now() - start).count();
+}
+
+void printResult(const std::string& name, uint64_t operations, int64_t nanoseconds, const std::string& extra = std::string())
+{
+	const double perOperation = (operations != 0 ? static_cast<double>(nanoseconds) / operations : 0.);
+	std::cout << std::left << std::setw(44) << name << std::right << std::setw(10) << operations << " ops "
+	          << std::setw(12) << std::fixed << std::setprecision(1) << perOperation << " ns/op";
+	if (!extra.empty()) {
+		std::cout << "  " << extra;
+	}
+	std::cout << std::endl;
+}
+
+class BenchmarkCreature final : public Creature
+{
+	public:
+		const std::string& getName() const override {
+			return name;
+		}
+		const std::string& getNameDescription() const override {
+			return name;
+		}
+		std::string getDescription(int32_t) const override {
+			return name;
+		}
+
+		CreatureType_t getType() const override {
+			return CREATURETYPE_MONSTER;
+		}
+
+		void setID() override {}
+		void addList() override {}
+		void removeList() override {}
+
+		bool useCacheMap() const override {
+			return true;
+		}
+
+		//puts the creature on the tile without telling the map or the spectators
+		void placeOn(Tile* newTile) {
+			setParent(newTile);
+			isMapLoaded = true;
+			updateMapCache();
+		}
+
+		void rebuildWalkCache() {
+			updateMapCache();
+		}
+
+		std::vector<int32_t> getWalkCacheWindow() const {
+			std::vector<int32_t> window;
+			for (int32_t y = -maxWalkCacheHeight; y <= maxWalkCacheHeight; ++y) {
+				for (int32_t x = -maxWalkCacheWidth; x <= maxWalkCacheWidth; ++x) {
+					window.push_back(getWalkCache(Position(position.x + x, position.y + y, position.z)));
+				}
+			}
+			return window;
+		}
+
+	private:
+		std::string name = "benchmark creature";
+};
+
+bool canStandOn(const BenchmarkCreature& creature, const Tile* tile)
+{
+	return tile && tile->queryAdd(0, creature, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) == RETURNVALUE_NOERROR;
+}
+
+std::vector<Position> getWalkablePositions(const BenchmarkCreature& creature, const Position& center)
+{
+	std::vector<Position> positions;
+	for (int32_t y = -BENCHMARK_RADIUS; y <= BENCHMARK_RADIUS; ++y) {
+		for (int32_t x = -BENCHMARK_RADIUS; x <= BENCHMARK_RADIUS; ++x) {
+			const int32_t posX = center.x + x;
+			const int32_t posY = center.y + y;
+			if (posX < 0 || posY < 0 || posX > 0xFFFF || posY > 0xFFFF) {
+				continue;
+			}
+
+			Position pos(posX, posY, center.z);
+			if (canStandOn(creature, g_game.map.getTile(pos))) {
+				positions.push_back(pos);
+			}
+		}
+	}
+	return positions;
+}
+
+//pairs of positions on the screen of each other, like a creature and the target it follows
+std::vector<std::pair<Position, Position>> getViewportPairs(const std::vector<Position>& positions, size_t count)
+{
+	std::vector<std::pair<Position, Position>> pairs;
+	std::uniform_int_distribution<size_t> pick(0, positions.size() - 1);
+	for (size_t tries = 0; pairs.size() < count && tries < count * 100; ++tries) {
+		const Position& fromPos = positions[pick(benchmarkRandom)];
+		const Position& toPos = positions[pick(benchmarkRandom)];
+		if (fromPos != toPos && Position::getDistanceX(fromPos, toPos) <= Map::maxClientViewportX &&
+		        Position::getDistanceY(fromPos, toPos) <= Map::maxClientViewportY) {
+			pairs.emplace_back(fromPos, toPos);
+		}
+	}
+	return pairs;
+}
+
+void benchmarkPathSearch(BenchmarkCreature& creature, const std::vector<Position>& positions)
+{
+	std::cout << ">> Path search, " << PATH_SEARCHES << " searches towards a target on screen" << std::endl;
+
+	const auto pairs = getViewportPairs(positions, PATH_SEARCHES);
+
+	//the parameters of a creature following its target, see Creature::getPathSearchParams
+	FindPathParams fpp;
+	fpp.fullPathSearch = true;
+	fpp.clearSight = true;
+	fpp.maxSearchDist = 12;
+	fpp.minTargetDist = 1;
+	fpp.maxTargetDist = 1;
+
+	const bool jumpPointSearch = g_config.getBoolean(ConfigManager::JUMP_POINT_SEARCH);
+	for (bool jumpPoints : {false, true}) {
+		g_config.setBoolean(ConfigManager::JUMP_POINT_SEARCH, jumpPoints);
+
+		std::vector<Direction> dirList;
+		uint64_t found = 0;
+		uint64_t steps = 0;
+		uint64_t expandedNodes = 0;
+		int64_t nanoseconds = 0;
+		for (const auto& it : pairs) {
+			creature.placeOn(g_game.map.getTile(it.first));
+			dirList.clear();
+
+			const uint64_t nodes = Map::getExpandedPathNodes();
+			const auto start = BenchmarkClock::now();
+			if (g_game.map.getPathMatching(creature, it.second, dirList, FrozenPathingConditionCall(it.second), fpp)) {
+				++found;
+				steps += dirList.size();
+			}
+			nanoseconds += elapsedNanoseconds(start);
+			expandedNodes += Map::getExpandedPathNodes() - nodes;
+		}
+
+		std::ostringstream ss;
+		ss << std::fixed << std::setprecision(1) << "found " << found << ", "
+		   << (pairs.empty() ? 0. : static_cast<double>(expandedNodes) / pairs.size()) << " nodes/path, "
+		   << (found == 0 ? 0. : static_cast<double>(steps) / found) << " steps/path";
+		printResult(jumpPoints ? "jump point search" : "plain A*", pairs.size(), nanoseconds, ss.str());
+	}
+	g_config.setBoolean(ConfigManager::JUMP_POINT_SEARCH, jumpPointSearch);
+}
+
+void benchmarkWalkCache(BenchmarkCreature& creature, const std::vector<Position>& positions)
+{
+	std::cout << ">> Creature walk cache, " << WALK_STEPS << " steps of a random walk" << std::endl;
+
+	static const Direction directions[] = {
+		DIRECTION_NORTH, DIRECTION_EAST, DIRECTION_SOUTH, DIRECTION_WEST,
+		DIRECTION_NORTHEAST, DIRECTION_SOUTHEAST, DIRECTION_SOUTHWEST, DIRECTION_NORTHWEST
+	};
+
+	std::vector<Tile*> walk {g_game.map.getTile(positions[std::uniform_int_distribution<size_t>(0, positions.size() - 1)(benchmarkRandom)])};
+	std::uniform_int_distribution<size_t> pickDirection(0, 7);
+	for (size_t tries = 0; walk.size() <= WALK_STEPS && tries < WALK_STEPS * 16; ++tries) {
+		const Position nextPos = getNextPosition(directions[pickDirection(benchmarkRandom)], walk.back()->getPosition());
+		Tile* nextTile = g_game.map.getTile(nextPos);
+		if (canStandOn(creature, nextTile)) {
+			walk.push_back(nextTile);
+		}
+	}
+
+	//the way Game::internalMoveCreature updates the walk cache of the creature that moved
+	creature.placeOn(walk.front());
+	auto start = BenchmarkClock::now();
+	for (size_t i = 1; i < walk.size(); ++i) {
+		Tile* oldTile = walk[i - 1];
+		Tile* newTile = walk[i];
+		creature.setParent(newTile);
+		creature.onCreatureMove(&creature, newTile, newTile->getPosition(), oldTile, oldTile->getPosition(), false);
+	}
+	printResult("step update", walk.size() - 1, elapsedNanoseconds(start));
+
+	//the step updates have to end up with the same cache as a full rebuild
+	const std::vector<int32_t> stepCache = creature.getWalkCacheWindow();
+
+	creature.placeOn(walk.front());
+	start = BenchmarkClock::now();
+	for (size_t i = 1; i < walk.size(); ++i) {
+		creature.setParent(walk[i]);
+		creature.rebuildWalkCache();
+	}
+	printResult("full rebuild", walk.size() - 1, elapsedNanoseconds(start));
+
+	const std::vector<int32_t> rebuiltCache = creature.getWalkCacheWindow();
+	size_t mismatches = 0;
+	for (size_t i = 0; i < stepCache.size(); ++i) {
+		if (stepCache[i] != rebuiltCache[i]) {
+			++mismatches;
+		}
+	}
+
+	if (mismatches != 0) {
+		std::cout << "[Warning - benchmarkWalkCache] " << mismatches << " cells of the step updated cache differ from a full rebuild." << std::endl;
+	}
+}
+
+void benchmarkSightLines(const std::vector<Position>& positions)
+{
+	std::cout << ">> Sight lines, " << SIGHT_PAIRS << " lines on screen checked " << SIGHT_ROUNDS << " times" << std::endl;
+
+	const auto pairs = getViewportPairs(positions, SIGHT_PAIRS);
+	const Map& map = g_game.map;
+
+	uint64_t clear = 0;
+	auto start = BenchmarkClock::now();
+	for (const auto& it : pairs) {
+		if (map.checkSightLine(it.first, it.second)) {
+			++clear;
+		}
+	}
+	printResult("checkSightLine", pairs.size(), elapsedNanoseconds(start), "clear " + std::to_string(clear));
+
+	start = BenchmarkClock::now();
+	for (const auto& it : pairs) {
+		map.isSightClear(it.first, it.second, true);
+	}
+	printResult("isSightClear, first round", pairs.size(), elapsedNanoseconds(start));
+
+	start = BenchmarkClock::now();
+	for (size_t round = 1; round < SIGHT_ROUNDS; ++round) {
+		for (const auto& it : pairs) {
+			map.isSightClear(it.first, it.second, true);
+		}
+	}
+	printResult("isSightClear, repeated rounds", pairs.size() * (SIGHT_ROUNDS - 1), elapsedNanoseconds(start));
+}
+
+void benchmarkMapLoad(const std::string& fileName)
+{
+	std::cout << ">> Map loading, " << fileName << std::endl;
+
+	const bool mapCache = g_config.getBoolean(ConfigManager::MAP_CACHE);
+	const std::string cacheFileName = fileName + ".cache";
+
+	auto loadMap = [&fileName](const std::string& name, bool useCache) {
+		g_config.setBoolean(ConfigManager::MAP_CACHE, useCache);
+
+		//the second copy of the map reports the unique ids of the first as duplicates,
+		//the console is muted so that it does not count into the loading time
+		std::unique_ptr<Map> map(new Map());
+		IOMap loader;
+		std::streambuf* console = std::cout.rdbuf(nullptr);
+		const auto start = BenchmarkClock::now();
+		const bool loaded = loader.loadMap(map.get(), fileName);
+		const int64_t nanoseconds = elapsedNanoseconds(start);
+		std::cout.rdbuf(console);
+		std::cout.clear();
+
+		if (!loaded) {
+			std::cout << "[Error - benchmarkMapLoad] " << loader.getLastErrorString() << std::endl;
+			return;
+		}
+		printResult(name, 1, nanoseconds, std::to_string(nanoseconds / 1000000) + " ms");
+	};
+
+	loadMap(".otbm", false);
+
+	boost::system::error_code ec;
+	boost::filesystem::remove(cacheFileName, ec);
+	loadMap(".otbm, writing the map cache", true);
+	loadMap("map cache", true);
+
+	g_config.setBoolean(ConfigManager::MAP_CACHE, mapCache);
+}
+
+void benchmarkItemAllocator()
+{
+	std::cout << ">> Item allocation, " << ALLOCATOR_OPERATIONS << " frees and allocations with "
+	          << ALLOCATOR_LIVE_ITEMS << " items alive" << std::endl;
+
+	//the objects corpses, loot, fields, teleports and beds are made of
+	static const size_t sizes[] = {sizeof(Item), sizeof(Container), sizeof(MagicField), sizeof(Teleport), sizeof(BedItem)};
+
+	//drawn up front, so both allocators replace the same items with the same sizes
+	std::vector<uint32_t> slots(ALLOCATOR_OPERATIONS);
+	std::vector<uint8_t> sizeIndexes(ALLOCATOR_OPERATIONS + ALLOCATOR_LIVE_ITEMS);
+	std::uniform_int_distribution<uint32_t> pickSlot(0, ALLOCATOR_LIVE_ITEMS - 1);
+	std::uniform_int_distribution<uint32_t> pickSize(0, (sizeof(sizes) / sizeof(sizes[0])) - 1);
+	for (uint32_t& slot : slots) {
+		slot = pickSlot(benchmarkRandom);
+	}
+	for (uint8_t& sizeIndex : sizeIndexes) {
+		sizeIndex = pickSize(benchmarkRandom);
+	}
+
+	using AllocateFunction = void* (*)(size_t);
+	using DeallocateFunction = void (*)(void*, size_t);
+	auto churn = [&](const std::string& name, AllocateFunction allocate, DeallocateFunction deallocate) {
+		std::vector<std::pair<void*, size_t>> live(ALLOCATOR_LIVE_ITEMS);
+		for (size_t i = 0; i < ALLOCATOR_LIVE_ITEMS; ++i) {
+			const size_t size = sizes[sizeIndexes[i]];
+			live[i] = std::make_pair(allocate(size), size);
+			memset(live[i].first, 0, size);
+		}
+
+		const auto start = BenchmarkClock::now();
+		for (size_t i = 0; i < ALLOCATOR_OPERATIONS; ++i) {
+			auto& item = live[slots[i]];
+			deallocate(item.first, item.second);
+
+			const size_t size = sizes[sizeIndexes[ALLOCATOR_LIVE_ITEMS + i]];
+			item = std::make_pair(allocate(size), size);
+			//the constructor writes the reference counter and the item id
+			*static_cast<uint64_t*>(item.first) = i;
+		}
+		printResult(name, ALLOCATOR_OPERATIONS, elapsedNanoseconds(start));
+
+		for (auto& item : live) {
+			deallocate(item.first, item.second);
+		}
+	};
+
+	churn("ItemAllocator", ItemAllocator::allocate, ItemAllocator::deallocate);
+	churn("global operator new", [](size_t size) { return ::operator new(size); }, [](void* p, size_t) { ::operator delete(p); });
+
+	for (const ItemSizeClassStats& stats : ItemAllocator::getStats()) {
+		std::cout << "  size class " << std::setw(4) << stats.objectSize << ": " << stats.slabs << " slabs, "
+		          << stats.capacity << " slots, " << stats.live << " live" << std::endl;
+	}
+}
+
+}
+
+int main()
+{
+	std::cout << STATUS_SERVER_NAME << " - Version " << STATUS_SERVER_VERSION << " benchmarks" << std::endl;
+	std::cout << "Compiled with " << BOOST_COMPILER << std::endl << std::endl;
+
+	if (!g_config.load()) {
+		std::cout << "> ERROR: Unable to load config.lua!" << std::endl;
+		return 1;
+	}
+
+	int32_t workerThreads = g_config.getNumber(ConfigManager::WORKER_THREADS);
+	if (workerThreads > 0) {
+		g_workerPool.start(workerThreads);
+	}
+
+	benchmarkItemAllocator();
+
+	if (!Item::items.loadFromOtb("data/items/" + std::to_string(CLIENT_VERSION) + "/items.otb")) {
+		std::cout << "> ERROR: Unable to load items (OTB)!" << std::endl;
+		return 1;
+	}
+
+	if (!Item::items.loadFromXml()) {
+		std::cout << "> ERROR: Unable to load items (XML)!" << std::endl;
+		return 1;
+	}
+
+	//spawns and houses are left out, the cases only need the tiles
+	const std::string mapFileName = "data/world/" + g_config.getString(ConfigManager::MAP_NAME) + ".otbm";
+	IOMap loader;
+	if (!loader.loadMap(&g_game.map, mapFileName)) {
+		std::cout << "> ERROR: " << loader.getLastErrorString() << std::endl;
+		return 1;
+	}
+
+	const TownMap& towns = g_game.map.towns.getTowns();
+	if (towns.empty()) {
+		std::cout << "> ERROR: The map has no towns to take the benchmark positions around." << std::endl;
+		return 1;
+	}
+
+	const Position& center = towns.begin()->second->getTemplePosition();
+
+	BenchmarkCreature creature;
+	const std::vector<Position> positions = getWalkablePositions(creature, center);
+	if (positions.empty()) {
+		std::cout << "> ERROR: No walkable tiles around " << center << '.' << std::endl;
+		return 1;
+	}
+
+	std::cout << std::endl << ">> " << positions.size() << " walkable tiles around " << center << std::endl;
+	benchmarkPathSearch(creature, positions);
+	benchmarkWalkCache(creature, positions);
+	benchmarkSightLines(positions);
+	benchmarkMapLoad(mapFileName);
+
+	g_workerPool.shutdown();
+	return 0;
+}
@@ -23,6 +23,7 @@
 
 #include "configmanager.h"
 #include "game.h"
+#include "tasks.h"
 
 #if LUA_VERSION_NUM >= 502
 #undef lua_strlen
@@ -136,6 +137,15 @@ bool ConfigManager::load()
 	boolean[CLASSIC_EQUIPMENT_SLOTS] = getGlobalBoolean(L, "classicEquipmentSlots", false);
 	boolean[CLASSIC_ATTACK_SPEED] = getGlobalBoolean(L, "classicAttackSpeed", false);
 	boolean[SCRIPTS_CONSOLE_LOGS] = getGlobalBoolean(L, "showScriptsLogInConsole", true);
+	boolean[PARALLEL_CREATURE_THINK] = getGlobalBoolean(L, "parallelCreatureThink", false);
+	boolean[HIERARCHICAL_PATHFINDING] = getGlobalBoolean(L, "hierarchicalPathfinding", false);
+	boolean[JUMP_POINT_SEARCH] = getGlobalBoolean(L, "jumpPointSearch", false);
+	boolean[ASYNC_PATHFINDING] = getGlobalBoolean(L, "asyncPathfinding", false);
+	boolean[SHARED_FLOW_FIELDS] = getGlobalBoolean(L, "sharedFlowFields", false);
+	boolean[PARALLEL_MAP_LOADING] = getGlobalBoolean(L, "parallelMapLoading", true);
+	boolean[MAP_CHECKSUM] = getGlobalBoolean(L, "mapChecksum", false);
+	boolean[MAP_CACHE] = getGlobalBoolean(L, "mapCache", false);
+	boolean[MAP_CACHE_VERIFY] = getGlobalBoolean(L, "mapCacheVerify", false);
 
 	string[DEFAULT_PRIORITY] = getGlobalString(L, "defaultPriority", "high");
 	string[SERVER_NAME] = getGlobalString(L, "serverName", "");
@@ -176,6 +186,11 @@ bool ConfigManager::load()
 	integer[MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER] = getGlobalNumber(L, "maxMarketOffersAtATimePerPlayer", 100);
 	integer[MAX_PACKETS_PER_SECOND] = getGlobalNumber(L, "maxPacketsPerSecond", 25);
 	integer[COMPRESSION_LEVEL] = getGlobalNumber(L, "packetCompressionLevel", 6);
+	integer[DISPATCHER_TASK_BUDGET] = getGlobalNumber(L, "dispatcherTaskBudget", 100);
+	g_dispatcher.setTaskBudget(static_cast<uint32_t>(integer[DISPATCHER_TASK_BUDGET]));
+	integer[DISPATCHER_STATS_INTERVAL] = getGlobalNumber(L, "dispatcherStatsInterval", 0);
+	integer[WORKER_THREADS] = getGlobalNumber(L, "workerThreads", 0);
+	integer[ACTIVITY_ZONE_RADIUS] = getGlobalNumber(L, "activityZoneRadius", 0);
 	#if GAME_FEATURE_STORE > 0
 	integer[STORE_COIN_PACKAGES] = getGlobalNumber(L, "storeCoinPackages", 25);
 	#endif
@@ -229,3 +244,14 @@ bool ConfigManager::getBoolean(boolean_config_t what) const
 	}
 	return boolean[what];
 }
+
+bool ConfigManager::setBoolean(boolean_config_t what, bool value)
+{
+	if (what >= LAST_BOOLEAN_CONFIG) {
+		std::cout << "[Warning - ConfigManager::setBoolean] Accessing invalid index: " << what << std::endl;
+		return false;
+	}
+
+	boolean[what] = value;
+	return true;
+}
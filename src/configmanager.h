@@ -42,6 +42,15 @@ class ConfigManager
 			CLASSIC_EQUIPMENT_SLOTS,
 			CLASSIC_ATTACK_SPEED,
 			SCRIPTS_CONSOLE_LOGS,
+			PARALLEL_CREATURE_THINK,
+			HIERARCHICAL_PATHFINDING,
+			JUMP_POINT_SEARCH,
+			ASYNC_PATHFINDING,
+			SHARED_FLOW_FIELDS,
+			PARALLEL_MAP_LOADING,
+			MAP_CHECKSUM,
+			MAP_CACHE,
+			MAP_CACHE_VERIFY,
 
 			LAST_BOOLEAN_CONFIG /* this must be the last one */
 		};
@@ -104,6 +113,10 @@ class ConfigManager
 			EXP_FROM_PLAYERS_LEVEL_RANGE,
 			MAX_PACKETS_PER_SECOND,
 			COMPRESSION_LEVEL,
+			DISPATCHER_TASK_BUDGET,
+			DISPATCHER_STATS_INTERVAL,
+			WORKER_THREADS,
+			ACTIVITY_ZONE_RADIUS,
 			#if GAME_FEATURE_STORE > 0
 			STORE_COIN_PACKAGES,
 			#endif
@@ -124,6 +137,7 @@ class ConfigManager
 		const std::string& getString(string_config_t what) const;
 		int32_t getNumber(integer_config_t what) const;
 		bool getBoolean(boolean_config_t what) const;
+		bool setBoolean(boolean_config_t what, bool value);
 
 	private:
 		std::string string[LAST_STRING_CONFIG] = {};
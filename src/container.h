@@ -172,6 +172,7 @@ class Container : public Item, public Cylinder
 		void updateItemWeight(int32_t diff);
 
 		friend class ContainerIterator;
+		friend class IOMap;
 		friend class IOMapSerialize;
 		friend class IOLoginData;
 };
@@ -24,6 +24,7 @@
 #include "monster.h"
 #include "configmanager.h"
 #include "scheduler.h"
+#include "pathservice.h"
 
 double Creature::speedA = 857.36;
 double Creature::speedB = 261.29;
@@ -159,6 +160,9 @@ void Creature::onThink(uint32_t interval)
 		goToFollowCreature();
 	}
 
+	//a prepared path is only valid for the think it was searched for
+	hasPreparedPath = false;
+
 	//scripting event - onThink
 	const CreatureEventList& thinkEvents = getCreatureEvents(CREATURE_EVENT_THINK);
 	for (CreatureEvent* thinkEvent : thinkEvents) {
@@ -282,7 +286,7 @@ void Creature::addEventWalk(bool firstStep)
 		g_game.checkCreatureWalk(getID());
 	}
 
-	eventWalk = g_scheduler.addEvent(createSchedulerTask(ticks, std::bind(&Game::checkCreatureWalk, &g_game, getID())));
+	eventWalk = g_scheduler.addEvent(createSchedulerTask(ticks, std::bind(&Game::checkCreatureWalk, &g_game, getID()), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CREATURE_WALK)));
 }
 
 void Creature::stopEventWalk()
@@ -312,7 +316,14 @@ void Creature::updateMapCache()
 void Creature::updateTileCache(const Tile* tile, int32_t dx, int32_t dy)
 {
 	if (std::abs(dx) <= maxWalkCacheWidth && std::abs(dy) <= maxWalkCacheHeight) {
-		localMapCache[maxWalkCacheHeight + dy][maxWalkCacheWidth + dx] = tile && tile->queryAdd(0, *this, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) == RETURNVALUE_NOERROR;
+		const Position& myPos = getPosition();
+		uint32_t& row = localMapCache[getWalkCacheRow(myPos.y + dy)];
+		const uint32_t bit = 1u << getWalkCacheColumn(myPos.x + dx);
+		if (tile && tile->queryAdd(0, *this, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) == RETURNVALUE_NOERROR) {
+			row |= bit;
+		} else {
+			row &= ~bit;
+		}
 	}
 }
 
@@ -345,7 +356,7 @@ int32_t Creature::getWalkCache(const Position& pos) const
 	if (std::abs(dx) <= maxWalkCacheWidth) {
 		int32_t dy = Position::getOffsetY(pos, myPos);
 		if (std::abs(dy) <= maxWalkCacheHeight) {
-			if (localMapCache[maxWalkCacheHeight + dy][maxWalkCacheWidth + dx]) {
+			if (localMapCache[getWalkCacheRow(pos.y)] & (1u << getWalkCacheColumn(pos.x))) {
 				return 1;
 			} else {
 				return 0;
@@ -486,80 +497,30 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 
 		//update map cache
 		if (isMapLoaded) {
-			if (teleport || oldPos.z != newPos.z) {
+			if (teleport || oldPos.z != newPos.z || Position::getDistanceX(oldPos, newPos) > 1 || Position::getDistanceY(oldPos, newPos) > 1) {
 				updateMapCache();
 			} else {
 				const Position& myPos = getPosition();
 
-				if (oldPos.y > newPos.y) { //north
-					//shift y south
-					for (int32_t y = mapWalkHeight - 1; --y >= 0;) {
-						memcpy(localMapCache[y + 1], localMapCache[y], sizeof(localMapCache[y]));
-					}
-
-					//update 0
-					for (int32_t x = -maxWalkCacheWidth; x <= maxWalkCacheWidth; ++x) {
-						Tile* cacheTile = g_game.map.getTile(myPos.getX() + x, myPos.getY() - maxWalkCacheHeight, myPos.z);
-						updateTileCache(cacheTile, x, -maxWalkCacheHeight);
-					}
-				} else if (oldPos.y < newPos.y) { // south
-					//shift y north
-					for (int32_t y = 0; y <= mapWalkHeight - 2; ++y) {
-						memcpy(localMapCache[y], localMapCache[y + 1], sizeof(localMapCache[y]));
-					}
-
-					//update mapWalkHeight - 1
+				int32_t enteringY = 0;
+				if (oldPos.y != newPos.y) {
+					enteringY = (oldPos.y > newPos.y ? -maxWalkCacheHeight : maxWalkCacheHeight);
 					for (int32_t x = -maxWalkCacheWidth; x <= maxWalkCacheWidth; ++x) {
-						Tile* cacheTile = g_game.map.getTile(myPos.getX() + x, myPos.getY() + maxWalkCacheHeight, myPos.z);
-						updateTileCache(cacheTile, x, maxWalkCacheHeight);
+						Tile* cacheTile = g_game.map.getTile(myPos.x + x, myPos.y + enteringY, myPos.z);
+						updateTileCache(cacheTile, x, enteringY);
 					}
 				}
 
-				if (oldPos.x < newPos.x) { // east
-					//shift y west
-					int32_t starty = 0;
-					int32_t endy = mapWalkHeight - 1;
-					int32_t dy = Position::getDistanceY(oldPos, newPos);
-
-					if (dy < 0) {
-						endy += dy;
-					} else if (dy > 0) {
-						starty = dy;
-					}
-
-					for (int32_t y = starty; y <= endy; ++y) {
-						for (int32_t x = 0; x <= mapWalkWidth - 2; ++x) {
-							localMapCache[y][x] = localMapCache[y][x + 1];
-						}
-					}
-
-					//update mapWalkWidth - 1
+				if (oldPos.x != newPos.x) {
+					const int32_t enteringX = (oldPos.x > newPos.x ? -maxWalkCacheWidth : maxWalkCacheWidth);
 					for (int32_t y = -maxWalkCacheHeight; y <= maxWalkCacheHeight; ++y) {
-						Tile* cacheTile = g_game.map.getTile(myPos.x + maxWalkCacheWidth, myPos.y + y, myPos.z);
-						updateTileCache(cacheTile, maxWalkCacheWidth, y);
-					}
-				} else if (oldPos.x > newPos.x) { // west
-					//shift y east
-					int32_t starty = 0;
-					int32_t endy = mapWalkHeight - 1;
-					int32_t dy = Position::getDistanceY(oldPos, newPos);
-
-					if (dy < 0) {
-						endy += dy;
-					} else if (dy > 0) {
-						starty = dy;
-					}
-
-					for (int32_t y = starty; y <= endy; ++y) {
-						for (int32_t x = mapWalkWidth - 1; --x >= 0;) {
-							localMapCache[y][x + 1] = localMapCache[y][x];
+						//the corner of a diagonal step came in with the row already
+						if (enteringY != 0 && y == enteringY) {
+							continue;
 						}
-					}
 
-					//update 0
-					for (int32_t y = -maxWalkCacheHeight; y <= maxWalkCacheHeight; ++y) {
-						Tile* cacheTile = g_game.map.getTile(myPos.x - maxWalkCacheWidth, myPos.y + y, myPos.z);
-						updateTileCache(cacheTile, -maxWalkCacheWidth, y);
+						Tile* cacheTile = g_game.map.getTile(myPos.x + enteringX, myPos.y + y, myPos.z);
+						updateTileCache(cacheTile, enteringX, y);
 					}
 				}
 
@@ -899,10 +860,18 @@ void Creature::goToFollowCreature()
 				hasFollowPath = true;
 				startAutoWalk(listWalkDir);
 			}
+		} else if (g_config.getBoolean(ConfigManager::SHARED_FLOW_FIELDS) && g_game.map.getFlowFieldPath(*this, *followCreature, fpp, listWalkDir)) {
+			hasFollowPath = true;
+			startAutoWalk(listWalkDir);
+		} else if (g_pathService.canRequestPath(*this, followCreature->getPosition(), fpp)) {
+			//keeps walking the current path until the search thread has the new one
+			g_pathService.requestPath(*this, followCreature->getPosition(), fpp);
 		} else {
 			listWalkDir.clear();
-			if (getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
-				hasFollowPath = true;
+			bool partial;
+			if (getFollowPath(followCreature->getPosition(), listWalkDir, fpp, partial)) {
+				//a partial path walks towards the target, but it is not known to be reachable yet
+				hasFollowPath = !partial;
 				startAutoWalk(listWalkDir);
 			} else {
 				hasFollowPath = false;
@@ -1134,7 +1103,7 @@ bool Creature::addCondition(Condition* condition, bool force/* = false*/)
 	if (!force && condition->getType() == CONDITION_HASTE && hasCondition(CONDITION_PARALYZE)) {
 		int64_t walkDelay = getWalkDelay();
 		if (walkDelay > 0) {
-			g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceAddCondition, &g_game, getID(), condition)));
+			g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceAddCondition, &g_game, getID(), condition), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CONDITION)));
 			return false;
 		}
 	}
@@ -1179,7 +1148,7 @@ void Creature::removeCondition(ConditionType_t type, bool force/* = false*/)
 		if (!force && type == CONDITION_PARALYZE) {
 			int64_t walkDelay = getWalkDelay();
 			if (walkDelay > 0) {
-				g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceRemoveCondition, &g_game, getID(), type)));
+				g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceRemoveCondition, &g_game, getID(), type), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CONDITION)));
 				return;
 			}
 		}
@@ -1200,7 +1169,7 @@ void Creature::removeCondition(ConditionType_t type, ConditionId_t conditionId,
 		if (!force && type == CONDITION_PARALYZE) {
 			int64_t walkDelay = getWalkDelay();
 			if (walkDelay > 0) {
-				g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceRemoveCondition, &g_game, getID(), type)));
+				g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceRemoveCondition, &g_game, getID(), type), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CONDITION)));
 				return;
 			}
 		}
@@ -1225,7 +1194,7 @@ void Creature::removeCondition(Condition* condition, bool force/* = false*/)
 	if (!force && condition->getType() == CONDITION_PARALYZE) {
 		int64_t walkDelay = getWalkDelay();
 		if (walkDelay > 0) {
-			g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceRemoveCondition, &g_game, getID(), condition->getType())));
+			g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceRemoveCondition, &g_game, getID(), condition->getType()), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CONDITION)));
 			return;
 		}
 	}
@@ -1580,9 +1549,96 @@ bool Creature::isInvisible() const
 bool Creature::getPathTo(const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp) const
 {
 	if (fpp.maxSearchDist != 0 || fpp.keepDistance) {
-		return g_game.map.getPathMatchingCond(*this, targetPos, dirList, FrozenPathingConditionCall(targetPos), fpp);
+		if (g_game.map.getPathMatchingCond(*this, targetPos, dirList, FrozenPathingConditionCall(targetPos), fpp)) {
+			return true;
+		}
+	} else if (g_game.map.getPathMatching(*this, targetPos, dirList, FrozenPathingConditionCall(targetPos), fpp)) {
+		return true;
+	}
+	return false;
+}
+
+bool Creature::getFollowPathTo(const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp, bool& partial) const
+{
+	partial = false;
+	if (getPathTo(targetPos, dirList, fpp)) {
+		return true;
+	}
+
+	//fleeing is not about reaching the target
+	if (fpp.keepDistance || !g_config.getBoolean(ConfigManager::HIERARCHICAL_PATHFINDING)) {
+		return false;
+	}
+
+	dirList.clear();
+	return g_game.map.getHierarchicalPath(*this, targetPos, dirList, fpp, partial);
+}
+
+bool Creature::prepareFollowPath(uint32_t interval)
+{
+	//mirrors the follow path update in onThink, a wrong guess only costs the search
+	if (!followCreature || (!isMapLoaded && useCacheMap())) {
+		return false;
+	}
+
+	if (!isUpdatingPath && !forceUpdateFollowPath && walkUpdateTicks + interval < 2000) {
+		return false;
+	}
+
+	FindPathParams fpp;
+	getPathSearchParams(followCreature, fpp);
+
+	//fleeing and distance keeping monsters try a single step first
+	const Monster* monster = getMonster();
+	if (monster && !monster->getMaster() && (monster->isFleeing() || fpp.maxTargetDist > 1)) {
+		return false;
+	}
+
+	if (g_pathService.canRequestPath(*this, followCreature->getPosition(), fpp)) {
+		return false;
+	}
+
+	preparedPathParams = fpp;
+	preparedPathFrom = getPosition();
+	preparedPathTo = followCreature->getPosition();
+	return true;
+}
+
+void Creature::searchPreparedPath()
+{
+	//runs on a worker thread while the dispatcher waits, must not modify anything but the prepared path
+	preparedPath.clear();
+	preparedPathFound = getFollowPathTo(preparedPathTo, preparedPath, preparedPathParams, preparedPathPartial);
+	hasPreparedPath = true;
+}
+
+bool Creature::getFollowPath(const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp, bool& partial)
+{
+	if (hasPreparedPath) {
+		hasPreparedPath = false;
+
+		const FindPathParams& prepared = preparedPathParams;
+		if (preparedPathFrom == getPosition() && preparedPathTo == targetPos &&
+		        prepared.fullPathSearch == fpp.fullPathSearch && prepared.clearSight == fpp.clearSight &&
+		        prepared.allowDiagonal == fpp.allowDiagonal && prepared.keepDistance == fpp.keepDistance &&
+		        prepared.maxSearchDist == fpp.maxSearchDist && prepared.minTargetDist == fpp.minTargetDist &&
+		        prepared.maxTargetDist == fpp.maxTargetDist) {
+			dirList.swap(preparedPath);
+			partial = preparedPathPartial;
+			return preparedPathFound;
+		}
+	}
+	return getFollowPathTo(targetPos, dirList, fpp, partial);
+}
+
+void Creature::onFollowPathResult(const std::vector<Direction>& dirList, bool found, bool partial/* = false*/)
+{
+	if (found) {
+		hasFollowPath = !partial;
+		startAutoWalk(dirList);
+	} else {
+		hasFollowPath = false;
 	}
-	return g_game.map.getPathMatching(*this, targetPos, dirList, FrozenPathingConditionCall(targetPos), fpp);
 }
 
 bool Creature::getPathTo(const Position& targetPos, std::vector<Direction>& dirList, int32_t minTargetDist, int32_t maxTargetDist, bool fullPathSearch /*= true*/, bool clearSight /*= true*/, int32_t maxSearchDist /*= 0*/) const
@@ -250,6 +250,11 @@ class Creature : virtual public Thing
 			return getTile()->getZone();
 		}
 
+		//players in the sectors around, maintained by Map
+		const std::vector<Player*>& getObservers() const {
+			return observers;
+		}
+
 		//walk functions
 		void startAutoWalk(const std::vector<Direction>& listDir);
 		void addEventWalk(bool firstStep = false);
@@ -456,6 +461,12 @@ class Creature : virtual public Thing
 
 		bool getPathTo(const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp) const;
 		bool getPathTo(const Position& targetPos, std::vector<Direction>& dirList, int32_t minTargetDist, int32_t maxTargetDist, bool fullPathSearch = true, bool clearSight = true, int32_t maxSearchDist = 0) const;
+		//like getPathTo, but may fall back to the first leg over the path graph, partial is set then
+		bool getFollowPathTo(const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp, bool& partial) const;
+
+		//parallel think pre-pass, see Game::prepareCreatureThink
+		bool prepareFollowPath(uint32_t interval);
+		void searchPreparedPath();
 
 		void incrementReferenceCounter() {
 			++referenceCounter;
@@ -480,6 +491,7 @@ class Creature : virtual public Thing
 		static constexpr int32_t mapWalkHeight = Map::maxViewportY * 2 + 1;
 		static constexpr int32_t maxWalkCacheWidth = (mapWalkWidth - 1) / 2;
 		static constexpr int32_t maxWalkCacheHeight = (mapWalkHeight - 1) / 2;
+		static_assert(mapWalkWidth <= 32, "Walk cache rows are kept as 32-bit masks");
 
 		Position position;
 
@@ -487,10 +499,15 @@ class Creature : virtual public Thing
 		CountMap damageMap;
 
 		std::vector<Creature*> summons;
+		std::vector<Player*> observers;
 		CreatureEventList eventsList;
 		ConditionList conditions;
 
 		std::vector<Direction> listWalkDir;
+		std::vector<Direction> preparedPath;
+		FindPathParams preparedPathParams;
+		Position preparedPathFrom;
+		Position preparedPathTo;
 
 		Tile* tile = nullptr;
 		Creature* attackedCreature = nullptr;
@@ -499,10 +516,14 @@ class Creature : virtual public Thing
 		uint64_t eventWalk = 0;
 
 		uint64_t lastStep = 0;
+		int64_t suspendTime = 0;
+		//suspended time the conditions still have to catch up on
+		int64_t suspendedConditionTime = 0;
 		uint32_t referenceCounter = 0;
 		uint32_t id = 0;
 		uint32_t scriptEventsBitField = 0;
 		uint32_t walkUpdateTicks = 0;
+		uint32_t pathRequestId = 0;
 		uint32_t lastHitCreatureId = 0;
 		uint32_t blockCount = 0;
 		uint32_t blockTicks = 0;
@@ -521,7 +542,9 @@ class Creature : virtual public Thing
 		Direction direction = DIRECTION_SOUTH;
 		Skulls_t skull = SKULL_NONE;
 
-		bool localMapCache[mapWalkHeight][mapWalkWidth] = {{ false }};
+		//ring buffer indexed by the map coordinates modulo the window size, a step overwrites the
+		//row or column leaving the window with the one entering it and leaves the rest in place
+		uint32_t localMapCache[mapWalkHeight] = {};
 		bool isInternalRemoved = false;
 		bool isMapLoaded = false;
 		bool isUpdatingPath = false;
@@ -532,6 +555,10 @@ class Creature : virtual public Thing
 		bool cancelNextWalk = false;
 		bool hasFollowPath = false;
 		bool forceUpdateFollowPath = false;
+		bool hasPreparedPath = false;
+		bool preparedPathFound = false;
+		bool preparedPathPartial = false;
+		bool hasPendingPath = false;
 		bool hiddenHealth = false;
 		bool canUseDefense = true;
 
@@ -550,6 +577,12 @@ class Creature : virtual public Thing
 		void updateMapCache();
 		void updateTileCache(const Tile* tile, int32_t dx, int32_t dy);
 		void updateTileCache(const Tile* tile, const Position& pos);
+		static int32_t getWalkCacheColumn(int32_t x) {
+			return (x + mapWalkWidth) % mapWalkWidth;
+		}
+		static int32_t getWalkCacheRow(int32_t y) {
+			return (y + mapWalkHeight) % mapWalkHeight;
+		}
 		void onCreatureDisappear(const Creature* creature, bool isLogout);
 		virtual void doAttacking(uint32_t) {}
 		virtual bool hasExtraSwing() {
@@ -564,6 +597,8 @@ class Creature : virtual public Thing
 			return 0;
 		}
 		virtual void getPathSearchParams(const Creature* creature, FindPathParams& fpp) const;
+		bool getFollowPath(const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp, bool& partial);
+		void onFollowPathResult(const std::vector<Direction>& dirList, bool found, bool partial = false);
 		virtual void death(Creature*) {}
 		virtual bool dropCorpse(Creature* lastHitCreature, Creature* mostDamageCreature, bool lastHitUnjustified, bool mostDamageUnjustified);
 		virtual Item* getCorpse(Creature* lastHitCreature, Creature* mostDamageCreature);
@@ -571,6 +606,7 @@ class Creature : virtual public Thing
 		friend class Game;
 		friend class Map;
 		friend class LuaScriptInterface;
+		friend class PathService;
 };
 
 #endif
@@ -79,7 +79,7 @@ void DatabaseTasks::runTask(const DatabaseTask& task)
 	}
 
 	if (task.callback) {
-		g_dispatcher.addTask(std::bind(task.callback, result, success));
+		g_dispatcher.addTask(std::bind(task.callback, result, success), makeTaskTag(TASK_KIND_DATABASE));
 	}
 }
 
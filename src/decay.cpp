@@ -26,86 +26,140 @@
 extern Game g_game;
 Decay g_decay;
 
+constexpr int64_t Decay::DECAY_TICK_INTERVAL;
+constexpr uint32_t Decay::INVALID_NODE;
+
+Decay::Decay()
+{
+	wheel.fill(INVALID_NODE);
+}
+
 void Decay::startDecay(Item* item, int32_t duration)
 {
 	if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
-		stopDecay(item, item->getIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP));
+		stopDecay(item);
+	}
+
+	int64_t now = OTSYS_TIME();
+	int64_t timestamp = now + static_cast<int64_t>(duration);
+	if (activeCount == 0) {
+		//nothing is linked, the ticks in between are empty
+		processedTick = now / DECAY_TICK_INTERVAL;
 	}
 
-	int64_t timestamp = OTSYS_TIME() + static_cast<int64_t>(duration);
-	if (decayMap.empty()) {
-		eventId = g_scheduler.addEvent(createSchedulerTask(std::max<int32_t>(SCHEDULER_MINTICKS, duration), std::bind(&Decay::checkDecay, this)));
+	uint32_t index;
+	if (freeNode != INVALID_NODE) {
+		index = freeNode;
+		freeNode = nodes[index].next;
 	} else {
-		if (timestamp < decayMap.begin()->first) {
-			g_scheduler.stopEvent(eventId);
-			eventId = g_scheduler.addEvent(createSchedulerTask(std::max<int32_t>(SCHEDULER_MINTICKS, duration), std::bind(&Decay::checkDecay, this)));
-		}
+		index = nodes.size();
+		nodes.emplace_back();
 	}
 
+	//the first tick at or after the timestamp, always a tick that has not been processed yet
+	int64_t tick = (timestamp + DECAY_TICK_INTERVAL - 1) / DECAY_TICK_INTERVAL;
+	uint32_t& head = wheel[tick % WHEEL_SIZE];
+
+	DecayNode& node = nodes[index];
+	node.item = item;
+	node.tick = tick;
+	node.prev = INVALID_NODE;
+	node.next = head;
+	if (head != INVALID_NODE) {
+		nodes[head].prev = index;
+	}
+	head = index;
+	++activeCount;
+
 	item->incrementReferenceCounter();
 	item->setDecaying(DECAYING_TRUE);
 	item->setDurationTimestamp(timestamp);
-	decayMap[timestamp].push_back(item);
+	item->getAttributes()->decayNode = index;
+	scheduleCheck();
 }
 
-void Decay::stopDecay(Item* item, int64_t timestamp)
+void Decay::scheduleCheck()
 {
-	auto it = decayMap.find(timestamp);
-	if (it != decayMap.end()) {
-		std::vector<Item*>& decayItems = it->second;
-
-		size_t i = 0, end = decayItems.size();
-		if (end == 1) {
-			if (item == decayItems[i]) {
-				if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
-					//Incase we removed duration attribute don't assign new duration
-					item->setDuration(item->getDuration());
-				}
-				item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
-				g_game.ReleaseItem(item);
-
-				decayMap.erase(it);
-			}
-			return;
-		}
-		while (i < end) {
-			if (item == decayItems[i]) {
-				if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
-					//Incase we removed duration attribute don't assign new duration
-					item->setDuration(item->getDuration());
-				}
-				item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
-				g_game.ReleaseItem(item);
-
-				std::swap(decayItems[i], decayItems.back());
-				decayItems.pop_back();
-				return;
-			}
-			++i;
-		}
+	if (checkScheduled) {
+		return;
 	}
+
+	checkScheduled = true;
+	g_scheduler.addEvent(createSchedulerTask(std::max<int32_t>(SCHEDULER_MINTICKS, DECAY_TICK_INTERVAL), std::bind(&Decay::checkDecay, this), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_DECAY)));
 }
 
-void Decay::checkDecay()
+void Decay::stopDecay(Item* item)
 {
-	int64_t timestamp = OTSYS_TIME();
+	if (!item->attributes) {
+		return;
+	}
+
+	uint32_t index = item->attributes->decayNode;
+	if (index == INVALID_NODE || nodes[index].item != item) {
+		return;
+	}
 
-	std::vector<Item*> tempItems;
-	tempItems.reserve(32);// Small preallocation
+	unlinkNode(index);
+	releaseNode(item, index);
 
-	auto it = decayMap.begin(), end = decayMap.end();
-	while (it != end) {
-		if (it->first > timestamp) {
-			break;
-		}
+	if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
+		//Incase we removed duration attribute don't assign new duration
+		item->setDuration(item->getDuration());
+	}
+	item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
+	g_game.ReleaseItem(item);
+}
+
+void Decay::unlinkNode(uint32_t index)
+{
+	DecayNode& node = nodes[index];
+	if (node.prev != INVALID_NODE) {
+		nodes[node.prev].next = node.next;
+	} else {
+		wheel[node.tick % WHEEL_SIZE] = node.next;
+	}
 
-		// Iterating here is unsafe so let's copy our items into temporary vector
-		std::vector<Item*>& decayItems = it->second;
-		tempItems.insert(tempItems.end(), decayItems.begin(), decayItems.end());
-		it = decayMap.erase(it);
+	if (node.next != INVALID_NODE) {
+		nodes[node.next].prev = node.prev;
 	}
+}
 
-	for (Item* item : tempItems) {
+void Decay::releaseNode(Item* item, uint32_t index)
+{
+	item->attributes->decayNode = INVALID_NODE;
+
+	DecayNode& node = nodes[index];
+	node.item = nullptr;
+	node.next = freeNode;
+	freeNode = index;
+	--activeCount;
+}
+
+void Decay::checkDecay()
+{
+	checkScheduled = false;
+
+	const auto start = std::chrono::steady_clock::now();
+	int64_t currentTick = OTSYS_TIME() / DECAY_TICK_INTERVAL;
+
+	//the due items are unlinked first, decaying an item can start the decay of other items
+	for (; processedTick < currentTick; ++processedTick) {
+		int64_t tick = processedTick + 1;
+		uint32_t index = wheel[tick % WHEEL_SIZE];
+		while (index != INVALID_NODE) {
+			DecayNode& node = nodes[index];
+			uint32_t next = node.next;
+			if (node.tick <= tick) {
+				Item* item = node.item;
+				unlinkNode(index);
+				releaseNode(item, index);
+				expiredItems.push_back(item);
+			}
+			index = next;
+		}
+	}
+
+	for (Item* item : expiredItems) {
 		if (!item->canDecay()) {
 			item->setDuration(item->getDuration());
 			item->setDecaying(DECAYING_FALSE);
@@ -117,7 +171,15 @@ void Decay::checkDecay()
 		g_game.ReleaseItem(item);
 	}
 
-	if (it != end) {
-		eventId = g_scheduler.addEvent(createSchedulerTask(std::max<int32_t>(SCHEDULER_MINTICKS, static_cast<int32_t>(it->first - timestamp)), std::bind(&Decay::checkDecay, this)));
+	stats.expired += expiredItems.size();
+	expiredItems.clear();
+
+	if (activeCount != 0) {
+		scheduleCheck();
 	}
+
+	uint64_t processingTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	++stats.ticks;
+	stats.processingTotal += processingTime;
+	stats.processingMax = std::max(stats.processingMax, processingTime);
 }
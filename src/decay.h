@@ -22,17 +22,64 @@
 
 #include "item.h"
 
+#include <array>
+
+//processing times are in microseconds
+struct DecayStats {
+	uint64_t ticks = 0;
+	uint64_t expired = 0;
+	uint64_t processingTotal = 0;
+	uint64_t processingMax = 0;
+};
+
+//hashed timing wheel of DECAY_TICK_INTERVAL slots, an item is linked into the slot of
+//the tick it expires on and keeps its node index, so starting and stopping are O(1)
 class Decay
 {
 	public:
+		static constexpr int64_t DECAY_TICK_INTERVAL = 50;
+
+		Decay();
+
 		void startDecay(Item* item, int32_t duration);
-		void stopDecay(Item* item, int64_t timestamp);
+		void stopDecay(Item* item);
+
+		size_t getActiveCount() const {
+			return activeCount;
+		}
+		const DecayStats& getStats() const {
+			return stats;
+		}
+		void resetStats() {
+			stats = DecayStats();
+		}
 
 	private:
+		//one revolution of the wheel covers a bit more than three minutes, items that decay
+		//later stay in their slot until the revolution of their tick comes
+		static constexpr uint32_t WHEEL_SIZE = 4096;
+		static constexpr uint32_t INVALID_NODE = ItemAttributes::INVALID_DECAY_NODE;
+
+		struct DecayNode {
+			Item* item = nullptr;
+			int64_t tick = 0;
+			uint32_t prev = INVALID_NODE;
+			uint32_t next = INVALID_NODE;
+		};
+
 		void checkDecay();
+		void scheduleCheck();
+		void unlinkNode(uint32_t index);
+		void releaseNode(Item* item, uint32_t index);
 
-		uint64_t eventId {0};
-		std::map<int64_t, std::vector<Item*>> decayMap;
+		std::vector<DecayNode> nodes;
+		std::vector<Item*> expiredItems;
+		std::array<uint32_t, WHEEL_SIZE> wheel;
+		uint32_t freeNode = INVALID_NODE;
+		size_t activeCount = 0;
+		int64_t processedTick = 0;
+		bool checkScheduled = false;
+		DecayStats stats;
 };
 
 extern Decay g_decay;
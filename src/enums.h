@@ -63,6 +63,50 @@ enum ThreadState {
 	THREAD_STATE_TERMINATED,
 };
 
+enum TaskKind_t : uint8_t {
+	TASK_KIND_GENERIC,
+	TASK_KIND_PACKET,
+	TASK_KIND_SCHEDULER,
+	TASK_KIND_DATABASE,
+	TASK_KIND_LUA,
+	TASK_KIND_PATH,
+	TASK_KIND_CONNECTION,
+
+	TASK_KIND_LAST /* this must be the last one */
+};
+
+enum DispatcherLane_t : uint8_t {
+	DISPATCHER_LANE_INPUT,
+	DISPATCHER_LANE_TIMER,
+	DISPATCHER_LANE_BACKGROUND,
+
+	DISPATCHER_LANE_LAST /* this must be the last one */
+};
+
+enum SchedulerEvent_t : uint8_t {
+	SCHEDULER_EVENT_GENERIC,
+	SCHEDULER_EVENT_CREATURE_THINK,
+	SCHEDULER_EVENT_CREATURE_WALK,
+	SCHEDULER_EVENT_CREATURE_ATTACK,
+	SCHEDULER_EVENT_CONDITION,
+	SCHEDULER_EVENT_PLAYER_ACTION,
+	SCHEDULER_EVENT_DECAY,
+	SCHEDULER_EVENT_SPAWN,
+	SCHEDULER_EVENT_RAID,
+	SCHEDULER_EVENT_GLOBALEVENT,
+	SCHEDULER_EVENT_AUTOSEND,
+	SCHEDULER_EVENT_LIGHT,
+	SCHEDULER_EVENT_MAP_CLEAN,
+};
+
+enum ConnectionTask_t : uint8_t {
+	CONNECTION_TASK_CONNECT,
+	CONNECTION_TASK_RELEASE,
+	CONNECTION_TASK_LOGIN,
+	CONNECTION_TASK_CHARACTER_LIST,
+	CONNECTION_TASK_STATUS,
+};
+
 enum itemAttrTypes : uint32_t {
 	ITEM_ATTRIBUTE_NONE,
 
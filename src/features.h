@@ -287,8 +287,20 @@
 //compared with visual studio stl library it is at least 2x faster
 #define GAME_FEATURE_ROBINHOOD_HASH_MAP 0
 
+//flat two-level grid of map sectors indexed directly by coordinates instead of hashing them on every tile lookup
+//if disabled it'll fallback to the hash map above
+#define GAME_FEATURE_FLAT_SECTOR_GRID 1
+
 //Xiaolin Wu's line algorithm for isSightClear - it seems cipsoft use this algorithm or at least something very similar
 //if disabled it'll fallback to Bresenham's line algorithm
 #define GAME_FEATURE_XIAOLIN_WU_SIGHT_CLEAR 1
 
+//size-class slab allocator for items - items of the same size share cache-line aligned slabs and a freelist
+//if disabled items are allocated with the global operator new
+#define GAME_FEATURE_ITEM_SLAB_ALLOCATOR 1
+
+//hierarchical timing wheel for the scheduler - insert and cancel are O(1) and the scheduler thread wakes up once per tick
+//if disabled it'll fallback to one boost::asio::deadline_timer per event
+#define GAME_FEATURE_SCHEDULER_TIMING_WHEEL 1
+
 #endif
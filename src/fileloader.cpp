@@ -84,6 +84,10 @@ const Node& Loader::parseTree()
 			if (++it == fileContents.end()) {
 				throw InvalidOTBFormat{};
 			}
+
+			if (!parseStack.empty()) {
+				parseStack.back()->escaped = true;
+			}
 		}
 	}
 	if (!parseStack.empty()) {
@@ -99,6 +103,14 @@ bool Loader::getProps(const Node& node, PropStream& props)
 	if (size == 0) {
 		return false;
 	}
+
+	if (!node.escaped) {
+		props.init(node.propsBegin, size);
+		return true;
+	}
+
+	//tile areas of the map are decoded on several threads at once
+	static thread_local std::vector<char> propBuffer;
 	if (propBuffer.size() < size) {
 		propBuffer.resize(size);
 	}
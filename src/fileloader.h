@@ -42,13 +42,15 @@ struct Node
 	Node& operator=(const Node&) = delete;
 
 	// moveable
-	Node(Node&& rhs) noexcept : children(std::move(rhs.children)), propsBegin(rhs.propsBegin), propsEnd(rhs.propsEnd), type(rhs.type) {}
+	Node(Node&& rhs) noexcept : children(std::move(rhs.children)), propsBegin(rhs.propsBegin), propsEnd(rhs.propsEnd), type(rhs.type), escaped(rhs.escaped) {}
 	Node& operator=(const Node&&) = delete;
 
 	ChildrenVector children;
 	ContentIt      propsBegin;
 	ContentIt      propsEnd;
 	uint8_t           type;
+	//set when the node holds escaped bytes, only those props are copied to be unescaped
+	bool              escaped = false;
 	enum NodeChar: uint8_t
 	{
 		ESCAPE = 0xFD,
@@ -70,9 +72,10 @@ struct InvalidOTBFormat final : LoadError {
 class Loader {
 	MappedFile     fileContents;
 	Node              root;
-	std::vector<char> propBuffer;
 public:
 	Loader(const std::string& fileName, const Identifier& acceptedIdentifier);
+	//the props point into the file, or into a buffer of the calling thread valid until
+	//its next call when they had to be unescaped
 	bool getProps(const Node& node, PropStream& props);
 	const Node& parseTree();
 };
@@ -91,6 +94,10 @@ class PropStream
 			return end - p;
 		}
 
+		const char* data() const {
+			return p;
+		}
+
 		template <typename T>
 		bool read(T& ret) {
 			if (size() < sizeof(T)) {
@@ -107,17 +114,24 @@ class PropStream
 				return false;
 			}
 
-			char* str = new char[strLen + 1];
-			memcpy(str, p, strLen);
-			str[strLen] = 0;
-			ret.assign(str, strLen);
-			delete[] str;
+			ret.assign(p, strLen);
 			p += strLen;
 			return true;
 		}
 
 		bool readString(std::string& ret) {
+			const char* str;
 			uint16_t strLen;
+			if (!readStringView(str, strLen)) {
+				return false;
+			}
+
+			ret.assign(str, strLen);
+			return true;
+		}
+
+		//the string is not copied, it stays valid as long as the buffer of the stream
+		bool readStringView(const char*& str, uint16_t& strLen) {
 			if (!read<uint16_t>(strLen)) {
 				return false;
 			}
@@ -126,11 +140,7 @@ class PropStream
 				return false;
 			}
 
-			char* str = new char[strLen + 1];
-			memcpy(str, p, strLen);
-			str[strLen] = 0;
-			ret.assign(str, strLen);
-			delete[] str;
+			str = p;
 			p += strLen;
 			return true;
 		}
@@ -184,6 +194,10 @@ class PropWriteStream
 			std::copy(str.begin(), str.end(), std::back_inserter(buffer));
 		}
 
+		void writeBytes(const char* data, size_t size) {
+			buffer.insert(buffer.end(), data, data + size);
+		}
+
 	private:
 		std::vector<char> buffer;
 };
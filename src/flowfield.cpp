@@ -0,0 +1,267 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "flowfield.h"
+#include "map.h"
+#include "pathservice.h"
+
+#include <queue>
+
+constexpr int32_t FlowFieldCache::UNREACHABLE;
+
+namespace {
+
+const int32_t neighbors[8][2] = {
+	{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
+};
+
+int32_t getStepCost(int32_t dx, int32_t dy)
+{
+	return (dx != 0 && dy != 0) ? MAP_NORMALWALKCOST + MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST;
+}
+
+}
+
+bool FlowFieldCache::getPath(const Creature& creature, const Creature& target, const FindPathParams& fpp, std::vector<Direction>& dirList)
+{
+	const Position& targetPos = target.getPosition();
+	if (!canUseField(creature, targetPos, fpp)) {
+		return false;
+	}
+
+	const int64_t now = OTSYS_TIME();
+	if (now - lastEviction >= EVICT_INTERVAL) {
+		evictExpired(now);
+		lastEviction = now;
+	}
+
+	++stats.requests;
+
+	Field& field = fields[getKey(target, fpp)];
+	field.lastUse = now;
+	if (field.targetPos != targetPos) {
+		field.targetPos = targetPos;
+		field.requests = 0;
+		field.built = false;
+	} else if (field.built && !isFieldValid(field)) {
+		//the chasers are still around, no need to wait for another one
+		buildField(field, fpp);
+		++stats.built;
+	}
+
+	if (!field.built) {
+		if (++field.requests < BUILD_THRESHOLD) {
+			return false;
+		}
+
+		buildField(field, fpp);
+		++stats.built;
+	}
+
+	if (!walkField(creature, field, dirList)) {
+		return false;
+	}
+
+	++stats.served;
+	return true;
+}
+
+bool FlowFieldCache::canUseField(const Creature& creature, const Position& targetPos, const FindPathParams& fpp)
+{
+	//the field knows the tiles next to the target only, distance keeping is left to the path search
+	if (!creature.getMonster() || fpp.keepDistance || fpp.maxTargetDist != 1) {
+		return false;
+	}
+
+	const Position& creaturePos = creature.getPosition();
+	return creaturePos.z == targetPos.z && Position::getDistanceX(creaturePos, targetPos) < RADIUS &&
+	        Position::getDistanceY(creaturePos, targetPos) < RADIUS;
+}
+
+uint64_t FlowFieldCache::getKey(const Creature& target, const FindPathParams& fpp)
+{
+	return static_cast<uint64_t>(target.getID()) | static_cast<uint64_t>(static_cast<uint8_t>(fpp.minTargetDist)) << 32 |
+	       static_cast<uint64_t>(fpp.clearSight) << 40;
+}
+
+bool FlowFieldCache::isFieldValid(const Field& field) const
+{
+	const Position& targetPos = field.targetPos;
+	const int32_t minX = std::max<int32_t>(0, targetPos.x - RADIUS);
+	const int32_t minY = std::max<int32_t>(0, targetPos.y - RADIUS);
+	const int32_t maxX = std::min<int32_t>(0xFFFF, targetPos.x + RADIUS);
+	const int32_t maxY = std::min<int32_t>(0xFFFF, targetPos.y + RADIUS);
+	for (int32_t y = minY & ~SECTOR_MASK; y <= maxY; y += SECTOR_SIZE) {
+		for (int32_t x = minX & ~SECTOR_MASK; x <= maxX; x += SECTOR_SIZE) {
+			if (map.getWalkVersion(Position(x, y, targetPos.z)) > field.walkVersion) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void FlowFieldCache::buildField(Field& field, const FindPathParams& fpp) const
+{
+	const Position& targetPos = field.targetPos;
+	const int32_t minTargetDist = std::max<int32_t>(0, fpp.minTargetDist);
+
+	std::vector<uint8_t> walkFlags(SIZE * SIZE, 0);
+	for (int32_t y = targetPos.y - RADIUS; y <= targetPos.y + RADIUS; ++y) {
+		for (int32_t x = targetPos.x - RADIUS; x <= targetPos.x + RADIUS; ++x) {
+			if (x < 0 || y < 0 || x > 0xFFFF || y > 0xFFFF) {
+				continue;
+			}
+
+			const Tile* tile = map.getTile(x, y, targetPos.z);
+			if (tile) {
+				walkFlags[getIndex(targetPos, x, y)] = PathService::getWalkFlags(*tile);
+			}
+		}
+	}
+
+	auto isWalkable = [&](int32_t x, int32_t y) {
+		//monsters never enter protection zones or houses
+		if (std::abs(x - targetPos.x) > RADIUS || std::abs(y - targetPos.y) > RADIUS) {
+			return false;
+		}
+		return walkFlags[getIndex(targetPos, x, y)] == PathService::WALK_OPEN;
+	};
+
+	typedef std::pair<int32_t, size_t> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+	field.costs.assign(SIZE * SIZE, UNREACHABLE);
+	for (int32_t y = targetPos.y - 1; y <= targetPos.y + 1; ++y) {
+		for (int32_t x = targetPos.x - 1; x <= targetPos.x + 1; ++x) {
+			const int32_t dist = std::max<int32_t>(std::abs(x - targetPos.x), std::abs(y - targetPos.y));
+			if (dist < minTargetDist || !isWalkable(x, y)) {
+				continue;
+			}
+
+			const Position pos(x, y, targetPos.z);
+			if (fpp.clearSight && !map.isSightClear(pos, targetPos, true)) {
+				continue;
+			}
+
+			const size_t index = getIndex(targetPos, x, y);
+			field.costs[index] = 0;
+			queue.emplace(0, index);
+		}
+	}
+
+	//walking costs are symmetric, so the costs from the goals equal the costs towards them
+	while (!queue.empty()) {
+		const QueueEntry entry = queue.top();
+		queue.pop();
+		if (entry.first != field.costs[entry.second]) {
+			continue;
+		}
+
+		const int32_t x = targetPos.x - RADIUS + static_cast<int32_t>(entry.second % SIZE);
+		const int32_t y = targetPos.y - RADIUS + static_cast<int32_t>(entry.second / SIZE);
+		for (const auto& offset : neighbors) {
+			const int32_t nx = x + offset[0];
+			const int32_t ny = y + offset[1];
+			if (!isWalkable(nx, ny)) {
+				continue;
+			}
+
+			const size_t index = getIndex(targetPos, nx, ny);
+			const int32_t cost = entry.first + getStepCost(offset[0], offset[1]);
+			if (cost < field.costs[index]) {
+				field.costs[index] = cost;
+				queue.emplace(cost, index);
+			}
+		}
+	}
+
+	field.walkVersion = map.getWalkVersion();
+	field.built = true;
+}
+
+bool FlowFieldCache::walkField(const Creature& creature, const Field& field, std::vector<Direction>& dirList) const
+{
+	const Position& targetPos = field.targetPos;
+	Position pos = creature.getPosition();
+
+	if (field.costs[getIndex(targetPos, pos.x, pos.y)] == 0) {
+		dirList.clear();
+		return true;
+	}
+
+	//the field leaves out creatures and fields, the steps are checked against the live tiles
+	std::vector<Direction> steps;
+	int32_t current = UNREACHABLE;
+	while (current != 0) {
+		Position bestPos;
+		int32_t bestCost = UNREACHABLE;
+		int32_t bestRemaining = UNREACHABLE;
+		for (const auto& offset : neighbors) {
+			const int32_t nx = pos.x + offset[0];
+			const int32_t ny = pos.y + offset[1];
+			if (std::abs(nx - targetPos.x) > RADIUS || std::abs(ny - targetPos.y) > RADIUS) {
+				continue;
+			}
+
+			const int32_t remaining = field.costs[getIndex(targetPos, nx, ny)];
+			if (remaining >= current || remaining == UNREACHABLE) {
+				continue;
+			}
+
+			const Position nextPos(nx, ny, pos.z);
+			const Tile* tile = map.canWalkTo(creature, nextPos);
+			if (!tile) {
+				continue;
+			}
+
+			const int32_t cost = remaining + getStepCost(offset[0], offset[1]) + AStarNodes::getTileWalkCost(creature, tile);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestRemaining = remaining;
+				bestPos = nextPos;
+			}
+		}
+
+		if (bestCost == UNREACHABLE) {
+			return false;
+		}
+
+		steps.push_back(getDirectionTo(pos, bestPos));
+		pos = bestPos;
+		current = bestRemaining;
+	}
+
+	dirList.assign(steps.rbegin(), steps.rend());
+	return true;
+}
+
+void FlowFieldCache::evictExpired(int64_t now)
+{
+	for (auto it = fields.begin(); it != fields.end();) {
+		if (now - it->second.lastUse >= EXPIRE_TIME) {
+			it = fields.erase(it);
+			++stats.evicted;
+		} else {
+			++it;
+		}
+	}
+}
@@ -0,0 +1,99 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_FLOWFIELD_H_E1CA0EFB721F45BCA818C801F062B5A0
+#define FS_FLOWFIELD_H_E1CA0EFB721F45BCA818C801F062B5A0
+
+#include "position.h"
+
+#include <limits>
+
+class Map;
+class Creature;
+struct FindPathParams;
+
+struct FlowFieldStats {
+	uint64_t requests = 0;
+	uint64_t served = 0;
+	uint64_t built = 0;
+	uint64_t evicted = 0;
+};
+
+//Walking costs towards the tiles next to a target, computed once for the area around the target
+//and walked down by every monster chasing it instead of each of them running its own path search
+class FlowFieldCache
+{
+	public:
+		static constexpr int32_t RADIUS = 16;
+		static constexpr int32_t SIZE = RADIUS * 2 + 1;
+		//a field is only built once a second chaser asks for the same target position
+		static constexpr uint32_t BUILD_THRESHOLD = 2;
+		static constexpr int64_t EXPIRE_TIME = 2000;
+		static constexpr int64_t EVICT_INTERVAL = 1000;
+
+		explicit FlowFieldCache(const Map& map) : map(map) {}
+
+		// non-copyable
+		FlowFieldCache(const FlowFieldCache&) = delete;
+		FlowFieldCache& operator=(const FlowFieldCache&) = delete;
+
+		/**
+		  * Walks the field of target down from the position of creature.
+		  *	\param dirList is only replaced when the field could be walked
+		  *	\returns false if the creature has to search its path itself
+		  */
+		bool getPath(const Creature& creature, const Creature& target, const FindPathParams& fpp, std::vector<Direction>& dirList);
+
+		const FlowFieldStats& getStats() const {
+			return stats;
+		}
+		void resetStats() {
+			stats = FlowFieldStats();
+		}
+
+	private:
+		static constexpr int32_t UNREACHABLE = std::numeric_limits<int32_t>::max();
+
+		struct Field {
+			std::vector<int32_t> costs;
+			Position targetPos;
+			int64_t lastUse = 0;
+			uint32_t walkVersion = 0;
+			uint32_t requests = 0;
+			bool built = false;
+		};
+
+		static bool canUseField(const Creature& creature, const Position& targetPos, const FindPathParams& fpp);
+		static uint64_t getKey(const Creature& target, const FindPathParams& fpp);
+		static size_t getIndex(const Position& targetPos, int32_t x, int32_t y) {
+			return (y - targetPos.y + RADIUS) * SIZE + (x - targetPos.x + RADIUS);
+		}
+
+		bool isFieldValid(const Field& field) const;
+		void buildField(Field& field, const FindPathParams& fpp) const;
+		bool walkField(const Creature& creature, const Field& field, std::vector<Direction>& dirList) const;
+		void evictExpired(int64_t now);
+
+		const Map& map;
+		std::unordered_map<uint64_t, Field> fields;
+		FlowFieldStats stats;
+		int64_t lastEviction = 0;
+};
+
+#endif
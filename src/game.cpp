@@ -42,8 +42,12 @@
 #include "spells.h"
 #include "talkaction.h"
 #include "weapons.h"
+#include "workerpool.h"
+#include "pathservice.h"
 #include "script.h"
 
+#include <fstream>
+
 extern ConfigManager g_config;
 extern Modules g_modules;
 extern Actions* g_actions;
@@ -59,6 +63,10 @@ extern MoveEvents* g_moveEvents;
 extern Weapons* g_weapons;
 extern Scripts* g_scripts;
 
+// a walk started by a packet handler runs in the input lane like an autowalk packet,
+// so the packets that follow it can't overtake it
+static constexpr uint16_t AUTOWALK_TASK_TAG = makeTaskTag(TASK_KIND_PACKET, 0x64);
+
 Game::Game()
 {
 	offlineTrainingWindow.choices.emplace_back("Sword Fighting and Shielding", SKILL_SWORD);
@@ -84,8 +92,17 @@ void Game::start(ServiceManager* manager)
 {
 	serviceManager = manager;
 
-	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL, std::bind(&Game::checkLight, this)));
-	g_scheduler.addEvent(createSchedulerTask(EVENT_CREATURE_THINK_INTERVAL, std::bind(&Game::checkCreatures, this, 0)));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL, std::bind(&Game::checkLight, this), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_LIGHT)));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_CREATURE_THINK_INTERVAL, std::bind(&Game::checkCreatures, this, 0), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CREATURE_THINK)));
+
+	int32_t dispatcherStatsInterval = g_config.getNumber(ConfigManager::DISPATCHER_STATS_INTERVAL);
+	if (dispatcherStatsInterval > 0) {
+		g_scheduler.addEvent(createSchedulerTask(dispatcherStatsInterval * 1000, std::bind(&Game::dumpDispatcherStats, this)));
+	}
+
+	if (g_config.getNumber(ConfigManager::ACTIVITY_ZONE_RADIUS) > 0) {
+		g_scheduler.addEvent(createSchedulerTask(EVENT_ACTIVITY_ZONE_INTERVAL, std::bind(&Game::updateActivityZones, this), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CREATURE_THINK)));
+	}
 }
 
 GameState_t Game::getGameState() const
@@ -716,7 +733,7 @@ void Game::playerMoveCreature(Player* player, Creature* movingCreature, const Po
 		//need to walk to the creature first before moving it
 		std::vector<Direction> listDir;
 		if (player->getPathTo(movingCreatureOrigPos, listDir, 0, 1, true, true)) {
-			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 			SchedulerTask* task = createSchedulerTask(1500, std::bind(&Game::playerMoveCreatureByID, this, player->getID(), movingCreature->getID(), movingCreatureOrigPos, toTile->getPosition()));
 			player->setNextWalkActionTask(task);
 		} else {
@@ -951,7 +968,7 @@ void Game::playerMoveItem(Player* player, const Position& fromPos,
 		//need to walk to the item first before using it
 		std::vector<Direction> listDir;
 		if (player->getPathTo(item->getPosition(), listDir, 0, 1, true, true)) {
-			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 			SchedulerTask* task = createSchedulerTask(400, std::bind(&Game::playerMoveItemByPlayerID, this, player->getID(), fromPos, spriteId, fromStackPos, toPos, count));
 			player->setNextWalkActionTask(task);
 		} else {
@@ -1007,7 +1024,7 @@ void Game::playerMoveItem(Player* player, const Position& fromPos,
 
 			std::vector<Direction> listDir;
 			if (player->getPathTo(walkPos, listDir, 0, 0, true, true)) {
-				g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+				g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 				SchedulerTask* task = createSchedulerTask(400, std::bind(&Game::playerMoveItemByPlayerID, this, player->getID(), itemPos, spriteId, itemStackPos, toPos, count));
 				player->setNextWalkActionTask(task);
 			} else {
@@ -2017,7 +2034,7 @@ void Game::playerUseItemEx(uint32_t playerId, const Position& fromPos, uint8_t f
 
 			std::vector<Direction> listDir;
 			if (player->getPathTo(walkToPos, listDir, 0, 1, true, true)) {
-				g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+				g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 				SchedulerTask* task = createSchedulerTask(400, std::bind(&Game::playerUseItemEx, this, playerId, itemPos, itemStackPos, fromSpriteId, toPos, toStackPos, toSpriteId));
 				player->setNextWalkActionTask(task);
 			} else {
@@ -2074,7 +2091,7 @@ void Game::playerUseItem(uint32_t playerId, const Position& pos, uint8_t stackPo
 		if (ret == RETURNVALUE_TOOFARAWAY) {
 			std::vector<Direction> listDir;
 			if (player->getPathTo(pos, listDir, 0, 1, true, true)) {
-				g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+				g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 				SchedulerTask* task = createSchedulerTask(400, std::bind(&Game::playerUseItem, this, playerId, pos, stackPos, index, spriteId));
 				player->setNextWalkActionTask(task);
 				return;
@@ -2166,7 +2183,7 @@ void Game::playerUseWithCreature(uint32_t playerId, const Position& fromPos, uin
 
 			std::vector<Direction> listDir;
 			if (player->getPathTo(walkToPos, listDir, 0, 1, true, true)) {
-				g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+				g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 				SchedulerTask* task = createSchedulerTask(400, std::bind(&Game::playerUseWithCreature, this, playerId, itemPos, itemStackPos, creatureId, spriteId));
 				player->setNextWalkActionTask(task);
 			} else {
@@ -2271,7 +2288,7 @@ void Game::playerRotateItem(uint32_t playerId, const Position& pos, uint8_t stac
 	if (pos.x != 0xFFFF && !Position::areInRange<1, 1, 0>(pos, player->getPosition())) {
 		std::vector<Direction> listDir;
 		if (player->getPathTo(pos, listDir, 0, 1, true, true)) {
-			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 			SchedulerTask* task = createSchedulerTask(400, std::bind(&Game::playerRotateItem, this, playerId, pos, stackPos, spriteId));
 			player->setNextWalkActionTask(task);
 		} else {
@@ -2320,7 +2337,7 @@ void Game::playerWrapableItem(uint32_t playerId, const Position& pos, uint8_t st
 	if (pos.x != 0xFFFF && !Position::areInRange<1, 1, 0>(pos, player->getPosition())) {
 		std::vector<Direction> listDir;
 		if (player->getPathTo(pos, listDir, 0, 1, true, true)) {
-			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 			SchedulerTask* task = createSchedulerTask(400, std::bind(&Game::playerWrapableItem, this, playerId, pos, stackPos, spriteId));
 			player->setNextWalkActionTask(task);
 		} else {
@@ -2443,7 +2460,7 @@ void Game::playerBrowseField(uint32_t playerId, const Position& pos)
 	if (!Position::areInRange<1, 1>(playerPos, pos)) {
 		std::vector<Direction> listDir;
 		if (player->getPathTo(pos, listDir, 0, 1, true, true)) {
-			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 			SchedulerTask* task = createSchedulerTask(400, std::bind(&Game::playerBrowseField, this, playerId, pos));
 			player->setNextWalkActionTask(task);
 		} else {
@@ -2587,7 +2604,7 @@ void Game::playerRequestTrade(uint32_t playerId, const Position& pos, uint8_t st
 	if (!Position::areInRange<1, 1>(tradeItemPosition, playerPosition)) {
 		std::vector<Direction> listDir;
 		if (player->getPathTo(pos, listDir, 0, 1, true, true)) {
-			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir));
+			g_dispatcher.addTask(std::bind(&Game::playerAutoWalk, this, player->getID(), listDir), AUTOWALK_TASK_TAG);
 			SchedulerTask* task = createSchedulerTask(400, std::bind(&Game::playerRequestTrade, this, playerId, pos, stackPos, tradePlayerId, spriteId));
 			player->setNextWalkActionTask(task);
 		} else {
@@ -3436,7 +3453,7 @@ bool Game::internalCreatureTurn(Creature* creature, Direction dir)
 
 	//send to client
 	SpectatorVector spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
+	map.getObservers(spectators, creature, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureTurn(creature);
 	}
@@ -3515,6 +3532,12 @@ void Game::checkCreatureAttack(uint32_t creatureId)
 void Game::addCreatureCheck(Creature* creature)
 {
 	creature->creatureCheck = true;
+	if (creature->suspendTime != 0) {
+		//this also runs from move and spectator callbacks, the conditions catch up in updateActivityZones
+		creature->suspendedConditionTime += OTSYS_TIME() - creature->suspendTime;
+		creature->suspendTime = 0;
+	}
+
 	if (creature->inCheckCreaturesVector) {
 		// already in a vector
 		return;
@@ -3532,11 +3555,103 @@ void Game::removeCreatureCheck(Creature* creature)
 	}
 }
 
+void Game::suspendCreatureCheck(Creature* creature)
+{
+	if (!creature->creatureCheck || creature->getHealth() <= 0) {
+		return;
+	}
+
+	//player summons follow their master, they are never left behind
+	Creature* master = creature->getMaster();
+	if (creature->getPlayer() || (master && master->getPlayer())) {
+		return;
+	}
+
+	creature->suspendTime = OTSYS_TIME();
+	removeCreatureCheck(creature);
+}
+
+bool Game::startMapClean()
+{
+	if (!map.startBackgroundClean()) {
+		return false;
+	}
+
+	checkMapClean();
+	return true;
+}
+
+void Game::checkMapClean()
+{
+	if (gameState == GAME_STATE_SHUTDOWN) {
+		return;
+	}
+
+	if (!map.backgroundCleanSlice(MAP_CLEAN_SLICE_BUDGET)) {
+		g_scheduler.addEvent(createSchedulerTask(EVENT_MAP_CLEAN_INTERVAL, std::bind(&Game::checkMapClean, this), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_MAP_CLEAN)));
+	}
+}
+
+void Game::updateActivityZones()
+{
+	g_scheduler.addEvent(createSchedulerTask(EVENT_ACTIVITY_ZONE_INTERVAL, std::bind(&Game::updateActivityZones, this), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CREATURE_THINK)));
+
+	//the zone has to reach past the screen or monsters would freeze in view
+	int32_t radius = std::max<int32_t>(g_config.getNumber(ConfigManager::ACTIVITY_ZONE_RADIUS), Map::maxViewportX);
+
+	std::vector<Position> centers;
+	centers.reserve(players.size());
+	for (const auto& it : players) {
+		centers.push_back(it.second->getPosition());
+	}
+
+	std::vector<Creature*> activeCreatures;
+	std::vector<Creature*> inactiveCreatures;
+	map.updateActivityZones(centers, radius, activeCreatures, inactiveCreatures);
+
+	for (Creature* creature : inactiveCreatures) {
+		suspendCreatureCheck(creature);
+	}
+
+	for (Creature* creature : activeCreatures) {
+		if (creature->suspendTime != 0) {
+			addCreatureCheck(creature);
+		}
+	}
+
+	//the time spent in an inactive sector is applied to the conditions as a single tick, once per wake-up;
+	//deaths are handled by checkCreatureDeath and removed creatures are only released in cleanup
+	for (Creature* creature : activeCreatures) {
+		if (creature->suspendedConditionTime == 0) {
+			continue;
+		}
+
+		int64_t elapsed = std::min<int64_t>(creature->suspendedConditionTime, std::numeric_limits<int32_t>::max());
+		creature->suspendedConditionTime = 0;
+		if (!creature->isRemoved() && creature->getHealth() > 0) {
+			creature->executeConditions(static_cast<uint32_t>(elapsed));
+		}
+	}
+}
+
 void Game::checkCreatures(size_t index)
 {
-	g_scheduler.addEvent(createSchedulerTask(EVENT_CHECK_CREATURE_INTERVAL, std::bind(&Game::checkCreatures, this, (index + 1) % EVENT_CREATURECOUNT)));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_CHECK_CREATURE_INTERVAL, std::bind(&Game::checkCreatures, this, (index + 1) % EVENT_CREATURECOUNT), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CREATURE_THINK)));
 
 	auto& checkCreatureList = checkCreatureLists[index];
+	if (g_config.getNumber(ConfigManager::ACTIVITY_ZONE_RADIUS) > 0) {
+		//creatures that wandered or were woken up outside of every activity zone
+		for (Creature* creature : checkCreatureList) {
+			if (creature->creatureCheck && !creature->getPlayer() && !map.isSectorActive(creature->getPosition())) {
+				suspendCreatureCheck(creature);
+			}
+		}
+	}
+
+	if (g_config.getBoolean(ConfigManager::PARALLEL_CREATURE_THINK)) {
+		prepareCreatureThink(checkCreatureList);
+	}
+
 	size_t it = 0, end = checkCreatureList.size();
 	while (it < end) {
 		Creature* creature = checkCreatureList[it];
@@ -3561,6 +3676,50 @@ void Game::checkCreatures(size_t index)
 	cleanup();
 }
 
+void Game::prepareCreatureThink(const std::vector<Creature*>& checkCreatureList)
+{
+	if (g_workerPool.getThreadCount() == 0) {
+		return;
+	}
+
+	//collect the follow path searches this think will run, keyed by map region
+	std::vector<std::pair<uint64_t, Creature*>> pathSearches;
+	for (Creature* creature : checkCreatureList) {
+		if (!creature->creatureCheck || creature->getHealth() <= 0 || !creature->prepareFollowPath(EVENT_CREATURE_THINK_INTERVAL)) {
+			continue;
+		}
+
+		const Position& pos = creature->getPosition();
+		uint64_t region = (static_cast<uint64_t>(pos.z) << 32) | (static_cast<uint64_t>(pos.x >> THINK_REGION_BITS) << 16) | (pos.y >> THINK_REGION_BITS);
+		pathSearches.emplace_back(region, creature);
+	}
+
+	if (pathSearches.size() < THINK_PARALLEL_MIN_PATHS) {
+		//not worth waking the workers, onThink searches these itself
+		return;
+	}
+
+	std::stable_sort(pathSearches.begin(), pathSearches.end(), [](const std::pair<uint64_t, Creature*>& lhs, const std::pair<uint64_t, Creature*>& rhs) {
+		return lhs.first < rhs.first;
+	});
+
+	std::vector<size_t> regionStarts;
+	for (size_t i = 0, size = pathSearches.size(); i < size; ++i) {
+		if (i == 0 || pathSearches[i].first != pathSearches[i - 1].first) {
+			regionStarts.push_back(i);
+		}
+	}
+	regionStarts.push_back(pathSearches.size());
+
+	//the map is not modified until parallelFor returns, the results are consumed
+	//by onThink in list order so the outcome does not depend on the worker count
+	g_workerPool.parallelFor(regionStarts.size() - 1, [&](size_t region) {
+		for (size_t i = regionStarts[region], last = regionStarts[region + 1]; i < last; ++i) {
+			pathSearches[i].second->searchPreparedPath();
+		}
+	});
+}
+
 void Game::changeSpeed(Creature* creature, int32_t varSpeedDelta)
 {
 	int32_t varSpeed = creature->getSpeed() - creature->getBaseSpeed();
@@ -3570,7 +3729,7 @@ void Game::changeSpeed(Creature* creature, int32_t varSpeedDelta)
 
 	//send to clients
 	SpectatorVector spectators;
-	map.getSpectators(spectators, creature->getPosition(), false, true);
+	map.getObservers(spectators, creature);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendChangeSpeed(creature, creature->getStepSpeed());
 	}
@@ -3590,7 +3749,7 @@ void Game::internalCreatureChangeOutfit(Creature* creature, const Outfit_t& outf
 
 	//send to clients
 	SpectatorVector spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
+	map.getObservers(spectators, creature, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureChangeOutfit(creature, outfit);
 	}
@@ -3600,7 +3759,7 @@ void Game::internalCreatureChangeVisible(Creature* creature, bool visible)
 {
 	//send to clients
 	SpectatorVector spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
+	map.getObservers(spectators, creature, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureChangeVisible(creature, visible);
 	}
@@ -3610,7 +3769,7 @@ void Game::changeLight(const Creature* creature)
 {
 	//send to clients
 	SpectatorVector spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
+	map.getObservers(spectators, creature, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureLight(creature);
 	}
@@ -4282,7 +4441,7 @@ bool Game::combatChangeMana(Creature* attacker, Creature* target, CombatDamage&
 void Game::addCreatureHealth(const Creature* target)
 {
 	SpectatorVector spectators;
-	map.getSpectators(spectators, target->getPosition(), true, true);
+	map.getObservers(spectators, target, true);
 	addCreatureHealth(spectators, target);
 }
 
@@ -4411,7 +4570,7 @@ void Game::stopDecay(Item* item)
 {
 	if (item->hasAttribute(ITEM_ATTRIBUTE_DECAYSTATE)) {
 		if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
-			g_decay.stopDecay(item, item->getIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP));
+			g_decay.stopDecay(item);
 			item->removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
 		} else {
 			item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
@@ -4432,9 +4591,37 @@ void Game::internalDecayItem(Item* item)
 	}
 }
 
+void Game::dumpDispatcherStats()
+{
+	int32_t dispatcherStatsInterval = g_config.getNumber(ConfigManager::DISPATCHER_STATS_INTERVAL);
+	if (dispatcherStatsInterval <= 0) {
+		return;
+	}
+
+	g_scheduler.addEvent(createSchedulerTask(dispatcherStatsInterval * 1000, std::bind(&Game::dumpDispatcherStats, this)));
+
+	std::ofstream file("data/logs/dispatcher.log", std::ios::app);
+	if (!file.is_open()) {
+		std::cout << "[Error - Game::dumpDispatcherStats] Unable to open data/logs/dispatcher.log." << std::endl;
+		return;
+	}
+
+	file << "[" << formatDate(time(nullptr)) << "] dispatcher cycle " << g_dispatcher.getDispatcherCycle() << std::endl;
+
+	for (uint8_t lane = DISPATCHER_LANE_INPUT; lane < DISPATCHER_LANE_LAST; ++lane) {
+		const DispatcherLaneStats& laneStats = g_dispatcher.getLaneStats(static_cast<DispatcherLane_t>(lane));
+		file << getDispatcherLaneName(static_cast<DispatcherLane_t>(lane)) << " lane: depth " << laneStats.depth.load(std::memory_order_relaxed)
+			<< ", max depth " << laneStats.maxDepth.load(std::memory_order_relaxed)
+			<< ", executed " << laneStats.executed.load(std::memory_order_relaxed)
+			<< ", expired " << laneStats.expired.load(std::memory_order_relaxed) << std::endl;
+	}
+	g_dispatcher.getStats().dump(file);
+	file << std::endl;
+}
+
 void Game::checkLight()
 {
-	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL, std::bind(&Game::checkLight, this)));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL, std::bind(&Game::checkLight, this), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_LIGHT)));
 
 	lightHour += lightHourDelta;
 
@@ -4506,7 +4693,10 @@ void Game::shutdown()
 
 	g_scheduler.shutdown();
 	g_databaseTasks.shutdown();
+	//joins the path thread, so no path result can be queued behind the terminate task
+	g_pathService.shutdown();
 	g_dispatcher.shutdown();
+	g_workerPool.shutdown();
 	map.spawns.clear();
 	raids.clear();
 
@@ -4558,7 +4748,7 @@ void Game::updateCreatureWalkthrough(const Creature* creature)
 {
 	//send to clients
 	SpectatorVector spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
+	map.getObservers(spectators, creature, true);
 	for (Creature* spectator : spectators) {
 		Player* tmpPlayer = spectator->getPlayer();
 		tmpPlayer->sendCreatureWalkthrough(creature, tmpPlayer->canWalkthroughEx(creature));
@@ -4573,7 +4763,7 @@ void Game::updateCreatureSkull(const Creature* creature)
 	}
 
 	SpectatorVector spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
+	map.getObservers(spectators, creature, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureSkull(creature);
 	}
@@ -4586,7 +4776,7 @@ void Game::updatePlayerHelpers(const Player& player)
 	uint16_t helpers = player.getHelpers();
 
 	SpectatorVector spectators;
-	map.getSpectators(spectators, player.getPosition(), true, true);
+	map.getObservers(spectators, &player, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->sendCreatureHelpers(creatureId, helpers);
 	}
@@ -4614,7 +4804,7 @@ void Game::updateCreatureType(Creature* creature)
 
 	//send to clients
 	SpectatorVector spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
+	map.getObservers(spectators, creature, true);
 	if (creatureType == CREATURETYPE_SUMMON_OTHERS) {
 		for (Creature* spectator : spectators) {
 			Player* player = spectator->getPlayer();
@@ -5670,6 +5860,9 @@ bool Game::reloadCreatureScripts(bool fromLua, bool reload)
 
 bool Game::reload(ReloadTypes_t reloadType)
 {
+	//item descriptions are made of item types, weapons, runes and vocations
+	Item::clearDescriptionCache();
+
 	switch (reloadType) {
 		case RELOAD_TYPE_ACTIONS: return g_actions->reload();
 		case RELOAD_TYPE_CHAT: return g_chat->load();
@@ -71,6 +71,14 @@ enum LightState_t {
 };
 
 static constexpr int32_t EVENT_LIGHTINTERVAL = 10000;
+static constexpr int32_t EVENT_ACTIVITY_ZONE_INTERVAL = 1000;
+static constexpr int32_t EVENT_MAP_CLEAN_INTERVAL = 100;
+//milliseconds a background map clean may spend in one dispatcher task
+static constexpr int64_t MAP_CLEAN_SLICE_BUDGET = 5;
+
+//the parallel think pre-pass hands out whole map regions of (1 << THINK_REGION_BITS) tiles per side to the workers
+static constexpr int32_t THINK_REGION_BITS = 6;
+static constexpr size_t THINK_PARALLEL_MIN_PATHS = 16;
 
 /**
   * Main Game class.
@@ -213,6 +221,7 @@ class Game
 
 		void addCreatureCheck(Creature* creature);
 		static void removeCreatureCheck(Creature* creature);
+		static void suspendCreatureCheck(Creature* creature);
 
 		size_t getPlayersOnline() const {
 			return players.size();
@@ -467,7 +476,13 @@ class Game
 		void updateCreatureWalk(uint32_t creatureId);
 		void checkCreatureAttack(uint32_t creatureId);
 		void checkCreatures(size_t index);
+		void prepareCreatureThink(const std::vector<Creature*>& checkCreatureList);
+		void updateActivityZones();
+		//cleans the map a slice at a time instead of in one go, false if a background clean is running already
+		bool startMapClean();
+		void checkMapClean();
 		void checkLight();
+		void dumpDispatcherStats();
 
 		bool combatBlockHit(CombatDamage& damage, Creature* attacker, Creature* target, bool checkDefense, bool checkArmor, bool field);
 
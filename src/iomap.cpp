@@ -21,8 +21,10 @@
 
 #include "iomap.h"
 
+#include <fstream>
 #include <boost/filesystem.hpp>
 #include "bed.h"
+#include "workerpool.h"
 
 /*
 	OTBM_ROOTV1
@@ -67,6 +69,42 @@ Tile* IOMap::createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8
 	return tile;
 }
 
+namespace {
+
+const std::array<char, 4> MAP_CACHE_IDENTIFIER{{'O', 'T', 'M', 'C'}};
+constexpr uint32_t MAP_CACHE_VERSION = 2;
+
+bool hashFile(const std::string& fileName, uint64_t& hash)
+{
+	if (!boost::filesystem::exists(fileName)) {
+		return false;
+	}
+
+	try {
+		OTB::MappedFile file(fileName);
+		const char* data = file.data();
+		size_t size = file.size();
+
+		//FNV-1a over 64-bit words, only used to notice a changed file
+		hash = 0xCBF29CE484222325ULL ^ size;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, data + i, sizeof(word));
+			hash = (hash ^ word) * 0x100000001B3ULL;
+		}
+
+		for (; i < size; ++i) {
+			hash = (hash ^ static_cast<uint8_t>(data[i])) * 0x100000001B3ULL;
+		}
+	} catch (const std::exception&) {
+		return false;
+	}
+	return true;
+}
+
+}
+
 bool IOMap::loadMap(Map* map, const std::string& fileName)
 {
 	if (!boost::filesystem::exists(fileName)) {
@@ -74,9 +112,49 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 		return false;
 	}
 
+	int64_t start = OTSYS_TIME();
+	const std::string cacheFileName = fileName + ".cache";
+	MapCacheKey cacheKey;
+	bool loaded = false;
+	if (g_config.getBoolean(ConfigManager::MAP_CACHE) && getMapCacheKey(fileName, cacheKey, g_config.getBoolean(ConfigManager::MAP_CACHE_VERIFY))) {
+		if (!loadMapCache(*map, cacheFileName, cacheKey, loaded)) {
+			return false;
+		}
+
+		if (!loaded) {
+			cacheWriter.reset(new MapCacheWriter());
+		}
+	}
+
+	if (!loaded && !parseMap(*map, fileName)) {
+		cacheWriter.reset();
+		return false;
+	}
+
+	std::cout << "> Map loading time: " << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
+
+	if (cacheWriter) {
+		start = OTSYS_TIME();
+		if (saveMapCache(*map, cacheFileName, cacheKey)) {
+			std::cout << "> Map cache saving time: " << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
+		} else {
+			std::cout << "[Warning - IOMap::loadMap] Could not save map cache " << cacheFileName << '.' << std::endl;
+		}
+		cacheWriter.reset();
+	}
+
+	if (g_config.getBoolean(ConfigManager::MAP_CHECKSUM)) {
+		std::cout << "> Map checksum: " << std::hex << std::setw(16) << std::setfill('0') << map->getChecksum() << std::dec << std::setfill(' ') << std::endl;
+	}
+	return true;
+}
+
+bool IOMap::parseMap(Map& map, const std::string& fileName)
+{
 	int64_t start = OTSYS_TIME();
 	OTB::Loader loader{fileName, OTB::Identifier{{'O', 'T', 'B', 'M'}}};
 	auto& root = loader.parseTree();
+	std::cout << "> Map tree parsing time: " << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
 
 	PropStream propStream;
 	if (!loader.getProps(root, propStream)) {
@@ -106,8 +184,11 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 	}
 
 	std::cout << "> Map size: " << root_header.width << "x" << root_header.height << '.' << std::endl;
-	map->width = root_header.width;
-	map->height = root_header.height;
+	map.width = root_header.width;
+	map.height = root_header.height;
+	#if GAME_FEATURE_FLAT_SECTOR_GRID > 0
+	map.mapSectors.reserve(map.width, map.height);
+	#endif
 
 	if (root.children.size() != 1 || root.children[0].type != OTBM_MAP_DATA) {
 		setLastErrorString("Could not read data node.");
@@ -115,21 +196,20 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 	}
 
 	auto& mapNode = root.children[0];
-	if (!parseMapDataAttributes(loader, mapNode, *map, fileName)) {
+	if (!parseMapDataAttributes(loader, mapNode, map, fileName)) {
 		return false;
 	}
 
+	std::vector<const OTB::Node*> tileAreaNodes;
 	for (auto& mapDataNode : mapNode.children) {
 		if (mapDataNode.type == OTBM_TILE_AREA) {
-			if (!parseTileArea(loader, mapDataNode, *map, (headerVersion == 0))) {
-				return false;
-			}
+			tileAreaNodes.push_back(&mapDataNode);
 		} else if (mapDataNode.type == OTBM_TOWNS) {
-			if (!parseTowns(loader, mapDataNode, *map)) {
+			if (!parseTowns(loader, mapDataNode, map)) {
 				return false;
 			}
 		} else if (mapDataNode.type == OTBM_WAYPOINTS && headerVersion > 1) {
-			if (!parseWaypoints(loader, mapDataNode, *map)) {
+			if (!parseWaypoints(loader, mapDataNode, map)) {
 				return false;
 			}
 		} else {
@@ -138,8 +218,17 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 		}
 	}
 
-	std::cout << "> Map loading time: " << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
-	return true;
+	bool legacy = (headerVersion == 0);
+	if (cacheWriter) {
+		cacheWriter->legacy = legacy;
+	}
+
+	return parseTileAreas(tileAreaNodes.size(), [&](size_t index, StagedTileArea& area) {
+		if (cacheWriter) {
+			area.cacheStream.reset(new PropWriteStream());
+		}
+		return decodeTileArea(loader, *tileAreaNodes[index], legacy, area);
+	}, map);
 }
 
 bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, const std::string& fileName)
@@ -171,6 +260,9 @@ bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode
 
 				map.spawnfile = fileName.substr(0, fileName.rfind('/') + 1);
 				map.spawnfile += tmp;
+				if (cacheWriter) {
+					cacheWriter->spawnFile = map.spawnfile;
+				}
 				break;
 
 			case OTBM_ATTR_EXT_HOUSE_FILE:
@@ -181,6 +273,9 @@ bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode
 
 				map.housefile = fileName.substr(0, fileName.rfind('/') + 1);
 				map.housefile += tmp;
+				if (cacheWriter) {
+					cacheWriter->houseFile = map.housefile;
+				}
 				break;
 
 			default:
@@ -191,17 +286,68 @@ bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode
 	return true;
 }
 
-bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map, bool _legacy)
+bool IOMap::parseTileAreas(size_t areaCount, const TileAreaDecoder& decodeArea, Map& map)
+{
+	int64_t start = OTSYS_TIME();
+	if (!g_config.getBoolean(ConfigManager::PARALLEL_MAP_LOADING) || g_workerPool.getThreadCount() == 0) {
+		for (size_t index = 0; index < areaCount; ++index) {
+			StagedTileArea area;
+			if (!decodeArea(index, area)) {
+				setLastErrorString(area.error);
+				return false;
+			}
+
+			if (!mergeTileArea(area, map)) {
+				return false;
+			}
+		}
+
+		std::cout << "> Map tile loading time: " << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
+		return true;
+	}
+
+	//the registrations decoding an item makes with the game are collected per area and
+	//replayed by the merge, so the loaded map is the same as the one of a serial load
+	std::vector<StagedTileArea> areas(areaCount);
+	g_workerPool.parallelFor(areas.size(), [&](size_t index) {
+		StagedTileArea& area = areas[index];
+		Item::deferredLoadActions = &area.deferredActions;
+		area.decoded = decodeArea(index, area);
+		Item::deferredLoadActions = nullptr;
+	});
+
+	std::cout << "> Map tile decoding time: " << (OTSYS_TIME() - start) / (1000.) << " seconds on "
+	          << (g_workerPool.getThreadCount() + 1) << " threads." << std::endl;
+
+	start = OTSYS_TIME();
+	for (StagedTileArea& area : areas) {
+		if (!area.decoded) {
+			setLastErrorString(area.error);
+			return false;
+		}
+
+		if (!mergeTileArea(area, map)) {
+			return false;
+		}
+
+		area = StagedTileArea();
+	}
+
+	std::cout << "> Map tile merging time: " << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
+	return true;
+}
+
+bool IOMap::decodeTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, bool _legacy, StagedTileArea& area)
 {
 	PropStream propStream;
 	if (!loader.getProps(tileAreaNode, propStream)) {
-		setLastErrorString("Invalid map node.");
+		area.error = "Invalid map node.";
 		return false;
 	}
 
 	OTBM_Destination_coords area_coord;
 	if (!propStream.read(area_coord)) {
-		setLastErrorString("Invalid map node.");
+		area.error = "Invalid map node.";
 		return false;
 	}
 
@@ -209,52 +355,46 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 	uint16_t base_y = area_coord.y;
 	uint16_t z = area_coord.z;
 
+	area.tiles.reserve(tileAreaNode.children.size());
+	if (area.cacheStream) {
+		area.cacheStream->write<uint32_t>(tileAreaNode.children.size());
+	}
+
+	std::vector<std::pair<const char*, size_t>> cachedTileItems;
 	for (auto& tileNode : tileAreaNode.children) {
 		if (tileNode.type != OTBM_TILE && tileNode.type != OTBM_HOUSETILE) {
-			setLastErrorString("Unknown tile node.");
+			area.error = "Unknown tile node.";
 			return false;
 		}
 
 		if (!loader.getProps(tileNode, propStream)) {
-			setLastErrorString("Could not read node data.");
+			area.error = "Could not read node data.";
 			return false;
 		}
 
 		OTBM_Tile_coords tile_coord;
 		if (!propStream.read(tile_coord)) {
-			setLastErrorString("Could not read tile position.");
+			area.error = "Could not read tile position.";
 			return false;
 		}
 
 		uint16_t x = base_x + tile_coord.x;
 		uint16_t y = base_y + tile_coord.y;
 
-		bool isHouseTile = false;
-		House* house = nullptr;
-		Tile* tile = nullptr;
-		Item* ground_item = nullptr;
-		uint32_t tileflags = TILESTATE_NONE;
+		area.tiles.emplace_back();
+		StagedTile& tile = area.tiles.back();
+		tile.x = x;
+		tile.y = y;
+		tile.z = z;
 
 		if (tileNode.type == OTBM_HOUSETILE) {
-			uint32_t houseId;
-			if (!propStream.read<uint32_t>(houseId)) {
+			if (!propStream.read<uint32_t>(tile.houseId)) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not read house id.";
-				setLastErrorString(ss.str());
-				return false;
-			}
-
-			house = map.houses.addHouse(houseId);
-			if (!house) {
-				std::ostringstream ss;
-				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << houseId;
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				return false;
 			}
-
-			tile = new HouseTile(x, y, z, house);
-			house->addTile(static_cast<HouseTile*>(tile));
-			isHouseTile = true;
+			tile.isHouseTile = true;
 		}
 
 		uint8_t attribute;
@@ -266,77 +406,78 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 					if (!propStream.read<uint32_t>(flags)) {
 						std::ostringstream ss;
 						ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to read tile flags.";
-						setLastErrorString(ss.str());
+						area.error = ss.str();
 						return false;
 					}
 
 					if ((flags & OTBM_TILEFLAG_PROTECTIONZONE) != 0) {
-						tileflags |= TILESTATE_PROTECTIONZONE;
+						tile.flags |= TILESTATE_PROTECTIONZONE;
 					} else if ((flags & OTBM_TILEFLAG_NOPVPZONE) != 0) {
-						tileflags |= TILESTATE_NOPVPZONE;
+						tile.flags |= TILESTATE_NOPVPZONE;
 					} else if ((flags & OTBM_TILEFLAG_PVPZONE) != 0) {
-						tileflags |= TILESTATE_PVPZONE;
+						tile.flags |= TILESTATE_PVPZONE;
 					}
 
 					if ((flags & OTBM_TILEFLAG_NOLOGOUT) != 0) {
-						tileflags |= TILESTATE_NOLOGOUT;
+						tile.flags |= TILESTATE_NOLOGOUT;
 					}
 					break;
 				}
 
 				case OTBM_ATTR_ITEM: {
+					const char* itemData = propStream.data();
 					Item* item = (_legacy ? Item::CreateItem_legacy(propStream) : Item::CreateItem(propStream));
 					if (!item) {
 						std::ostringstream ss;
 						ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
-						setLastErrorString(ss.str());
+						area.error = ss.str();
 						return false;
 					}
 
-					if (isHouseTile && item->isMoveable()) {
-						std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
-						delete item;
-					} else {
-						if (item->getItemCount() == 0) {
-							item->setItemCount(1);
-						}
-
-						if (tile) {
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						} else if (item->isGroundTile()) {
-							delete ground_item;
-							ground_item = item;
-						} else {
-							tile = createTile(ground_item, item, x, y, z);
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						}
+					if (area.cacheStream) {
+						cachedTileItems.emplace_back(itemData, propStream.data() - itemData);
 					}
+					tile.items.push_back(item);
 					break;
 				}
 
 				default:
 					std::ostringstream ss;
 					ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown tile attribute.";
-					setLastErrorString(ss.str());
+					area.error = ss.str();
 					return false;
 			}
 		}
 
+		if (area.cacheStream) {
+			//written before the item nodes are read, the tile items still point into the props of the tile
+			PropWriteStream& cacheStream = *area.cacheStream;
+			cacheStream.write<uint16_t>(x);
+			cacheStream.write<uint16_t>(y);
+			cacheStream.write<uint8_t>(z);
+			cacheStream.write<uint8_t>(tile.isHouseTile);
+			cacheStream.write<uint32_t>(tile.houseId);
+			cacheStream.write<uint32_t>(tile.flags);
+			cacheStream.write<uint16_t>(cachedTileItems.size());
+			for (const auto& tileItem : cachedTileItems) {
+				cacheStream.write<uint16_t>(tileItem.second);
+				cacheStream.writeBytes(tileItem.first, tileItem.second);
+			}
+			cacheStream.write<uint32_t>(tileNode.children.size());
+			cachedTileItems.clear();
+		}
+
 		for (auto& itemNode : tileNode.children) {
 			if (itemNode.type != OTBM_ITEM) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown node type.";
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				return false;
 			}
 
 			PropStream stream;
 			if (!loader.getProps(itemNode, stream)) {
-				setLastErrorString("Invalid item node.");
+				area.error = "Invalid item node.";
 				return false;
 			}
 
@@ -344,19 +485,57 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			if (!item) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				return false;
 			}
 
 			if (!item->unserializeItemNode(loader, itemNode, stream, _legacy)) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to load item " << item->getID() << '.';
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				delete item;
 				return false;
 			}
 
-			if (isHouseTile && item->isMoveable()) {
+			if (area.cacheStream) {
+				writeCachedItem(loader, itemNode, item, *area.cacheStream);
+			}
+			tile.items.push_back(item);
+		}
+	}
+	return true;
+}
+
+bool IOMap::mergeTileArea(StagedTileArea& area, Map& map)
+{
+	for (const auto& action : area.deferredActions) {
+		action();
+	}
+
+	for (StagedTile& stagedTile : area.tiles) {
+		uint16_t x = stagedTile.x;
+		uint16_t y = stagedTile.y;
+		uint16_t z = stagedTile.z;
+
+		House* house = nullptr;
+		Tile* tile = nullptr;
+		Item* ground_item = nullptr;
+
+		if (stagedTile.isHouseTile) {
+			house = map.houses.addHouse(stagedTile.houseId);
+			if (!house) {
+				std::ostringstream ss;
+				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << stagedTile.houseId;
+				setLastErrorString(ss.str());
+				return false;
+			}
+
+			tile = new HouseTile(x, y, z, house);
+			house->addTile(static_cast<HouseTile*>(tile));
+		}
+
+		for (Item* item : stagedTile.items) {
+			if (stagedTile.isHouseTile && item->isMoveable()) {
 				std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
 				delete item;
 			} else {
@@ -384,10 +563,14 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			tile = createTile(ground_item, nullptr, x, y, z);
 		}
 
-		tile->setFlag(static_cast<tileflags_t>(tileflags));
+		tile->setFlag(static_cast<tileflags_t>(stagedTile.flags));
 
 		map.setTile(x, y, z, tile);
 	}
+
+	if (area.cacheStream) {
+		cacheWriter->tileAreas.push_back(std::move(area.cacheStream));
+	}
 	return true;
 }
 
@@ -432,6 +615,13 @@ bool IOMap::parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map
 		}
 
 		town->setTemplePos(Position(town_coords.x, town_coords.y, town_coords.z));
+
+		if (cacheWriter) {
+			cacheWriter->towns.write<uint32_t>(townId);
+			cacheWriter->towns.writeString(townName);
+			cacheWriter->towns.write(town_coords);
+			++cacheWriter->townCount;
+		}
 	}
 	return true;
 }
@@ -464,7 +654,361 @@ bool IOMap::parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode,
 		}
 
 		map.waypoints[name] = Position(waypoint_coords.x, waypoint_coords.y, waypoint_coords.z);
+
+		if (cacheWriter) {
+			cacheWriter->waypoints.writeString(name);
+			cacheWriter->waypoints.write(waypoint_coords);
+			++cacheWriter->waypointCount;
+		}
 	}
 	return true;
 }
 
+bool IOMap::getMapCacheFile(const std::string& fileName, MapCacheFile& file, bool hashContents)
+{
+	//size and modification time are enough to notice a replaced or edited file without reading it
+	boost::system::error_code error;
+	file.size = boost::filesystem::file_size(fileName, error);
+	if (error) {
+		return false;
+	}
+
+	file.modified = boost::filesystem::last_write_time(fileName, error);
+	if (error) {
+		return false;
+	}
+	return !hashContents || hashFile(fileName, file.hash);
+}
+
+bool IOMap::isSameMapCacheFile(const MapCacheFile& file, const MapCacheFile& other, bool compareHashes)
+{
+	return file.size == other.size && file.modified == other.modified && (!compareHashes || file.hash == other.hash);
+}
+
+bool IOMap::getMapCacheKey(const std::string& fileName, MapCacheKey& key, bool hashContents)
+{
+	const std::string itemsFileName = "data/items/" + std::to_string(CLIENT_VERSION) + "/items.";
+	return getMapCacheFile(fileName, key.map, hashContents) && getMapCacheFile(itemsFileName + "otb", key.itemsOtb, hashContents) &&
+		getMapCacheFile(itemsFileName + "xml", key.itemsXml, hashContents);
+}
+
+bool IOMap::loadMapCache(Map& map, const std::string& cacheFileName, const MapCacheKey& key, bool& loaded)
+{
+	loaded = false;
+	if (!boost::filesystem::exists(cacheFileName)) {
+		return true;
+	}
+
+	OTB::MappedFile file;
+	try {
+		file.open(cacheFileName);
+	} catch (const std::exception&) {
+		return true;
+	}
+
+	PropStream propStream;
+	propStream.init(file.data(), file.size());
+
+	std::array<char, 4> identifier;
+	uint32_t version;
+	uint32_t clientVersion;
+	MapCacheKey fileKey;
+	const bool compareHashes = g_config.getBoolean(ConfigManager::MAP_CACHE_VERIFY);
+	if (!propStream.read(identifier) || identifier != MAP_CACHE_IDENTIFIER ||
+	        !propStream.read<uint32_t>(version) || version != MAP_CACHE_VERSION ||
+	        !propStream.read<uint32_t>(clientVersion) || clientVersion != CLIENT_VERSION ||
+	        !propStream.read(fileKey) || !isSameMapCacheFile(fileKey.map, key.map, compareHashes) ||
+	        !isSameMapCacheFile(fileKey.itemsOtb, key.itemsOtb, compareHashes) || !isSameMapCacheFile(fileKey.itemsXml, key.itemsXml, compareHashes)) {
+		std::cout << "> Map cache " << cacheFileName << " is out of date." << std::endl;
+		return true;
+	}
+
+	//nothing is added to the map before the whole header is read
+	uint16_t width;
+	uint16_t height;
+	uint8_t legacy;
+	std::string spawnFile;
+	std::string houseFile;
+	uint32_t townCount;
+	if (!propStream.read<uint16_t>(width) || !propStream.read<uint16_t>(height) || !propStream.read<uint8_t>(legacy) ||
+	        !propStream.readString(spawnFile) || !propStream.readString(houseFile) || !propStream.read<uint32_t>(townCount)) {
+		std::cout << "[Warning - IOMap::loadMapCache] Invalid map cache header in " << cacheFileName << '.' << std::endl;
+		return true;
+	}
+
+	struct CachedTown {
+		std::string name;
+		uint32_t id;
+		OTBM_Destination_coords coords;
+	};
+
+	std::vector<CachedTown> towns(townCount);
+	for (CachedTown& town : towns) {
+		if (!propStream.read<uint32_t>(town.id) || !propStream.readString(town.name) || !propStream.read(town.coords)) {
+			std::cout << "[Warning - IOMap::loadMapCache] Invalid town in " << cacheFileName << '.' << std::endl;
+			return true;
+		}
+	}
+
+	uint32_t waypointCount;
+	if (!propStream.read<uint32_t>(waypointCount)) {
+		std::cout << "[Warning - IOMap::loadMapCache] Invalid map cache header in " << cacheFileName << '.' << std::endl;
+		return true;
+	}
+
+	std::vector<std::pair<std::string, OTBM_Destination_coords>> waypoints(waypointCount);
+	for (auto& waypoint : waypoints) {
+		if (!propStream.readString(waypoint.first) || !propStream.read(waypoint.second)) {
+			std::cout << "[Warning - IOMap::loadMapCache] Invalid waypoint in " << cacheFileName << '.' << std::endl;
+			return true;
+		}
+	}
+
+	uint32_t areaCount;
+	if (!propStream.read<uint32_t>(areaCount)) {
+		std::cout << "[Warning - IOMap::loadMapCache] Invalid map cache header in " << cacheFileName << '.' << std::endl;
+		return true;
+	}
+
+	std::vector<std::pair<uint64_t, uint64_t>> areas(areaCount);
+	for (auto& area : areas) {
+		if (!propStream.read<uint64_t>(area.first) || !propStream.read<uint64_t>(area.second) ||
+		        area.first > file.size() || area.second > file.size() - area.first) {
+			std::cout << "[Warning - IOMap::loadMapCache] Invalid tile area table in " << cacheFileName << '.' << std::endl;
+			return true;
+		}
+	}
+
+	loaded = true;
+	std::cout << "> Map size: " << width << "x" << height << " (from " << cacheFileName << ")." << std::endl;
+	map.width = width;
+	map.height = height;
+	#if GAME_FEATURE_FLAT_SECTOR_GRID > 0
+	map.mapSectors.reserve(map.width, map.height);
+	#endif
+
+	if (!spawnFile.empty()) {
+		map.spawnfile = spawnFile;
+	}
+
+	if (!houseFile.empty()) {
+		map.housefile = houseFile;
+	}
+
+	for (const CachedTown& cachedTown : towns) {
+		Town* town = map.towns.getTown(cachedTown.id);
+		if (!town) {
+			town = new Town(cachedTown.id);
+			map.towns.addTown(cachedTown.id, town);
+		}
+
+		town->setName(cachedTown.name);
+		town->setTemplePos(Position(cachedTown.coords.x, cachedTown.coords.y, cachedTown.coords.z));
+	}
+
+	for (const auto& waypoint : waypoints) {
+		map.waypoints[waypoint.first] = Position(waypoint.second.x, waypoint.second.y, waypoint.second.z);
+	}
+
+	//the tiles are added while the areas are read, a broken area can not fall back to the .otbm file anymore
+	const char* data = file.data();
+	if (!parseTileAreas(areas.size(), [&](size_t index, StagedTileArea& area) {
+		return decodeCachedTileArea(data + areas[index].first, areas[index].second, legacy != 0, area);
+	}, map)) {
+		setLastErrorString(getLastErrorString() + " Remove " + cacheFileName + " to load the map from its .otbm file.");
+		return false;
+	}
+	return true;
+}
+
+bool IOMap::saveMapCache(const Map& map, const std::string& cacheFileName, const MapCacheKey& key)
+{
+	PropWriteStream header;
+	header.write(MAP_CACHE_IDENTIFIER);
+	header.write<uint32_t>(MAP_CACHE_VERSION);
+	header.write<uint32_t>(CLIENT_VERSION);
+	header.write(key);
+	header.write<uint16_t>(map.width);
+	header.write<uint16_t>(map.height);
+	header.write<uint8_t>(cacheWriter->legacy);
+	header.writeString(cacheWriter->spawnFile);
+	header.writeString(cacheWriter->houseFile);
+
+	size_t size;
+	const char* data = cacheWriter->towns.getStream(size);
+	header.write<uint32_t>(cacheWriter->townCount);
+	header.writeBytes(data, size);
+
+	data = cacheWriter->waypoints.getStream(size);
+	header.write<uint32_t>(cacheWriter->waypointCount);
+	header.writeBytes(data, size);
+
+	const auto& tileAreas = cacheWriter->tileAreas;
+	header.write<uint32_t>(tileAreas.size());
+	header.getStream(size);
+
+	uint64_t offset = size + tileAreas.size() * 2 * sizeof(uint64_t);
+	for (const auto& tileArea : tileAreas) {
+		tileArea->getStream(size);
+		header.write<uint64_t>(offset);
+		header.write<uint64_t>(size);
+		offset += size;
+	}
+
+	//written under another name first, an interrupted save never leaves a truncated cache behind
+	const std::string tmpFileName = cacheFileName + ".tmp";
+	std::ofstream file(tmpFileName, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	data = header.getStream(size);
+	file.write(data, size);
+	for (const auto& tileArea : tileAreas) {
+		data = tileArea->getStream(size);
+		file.write(data, size);
+	}
+
+	file.close();
+	if (!file) {
+		return false;
+	}
+
+	boost::system::error_code ec;
+	boost::filesystem::rename(tmpFileName, cacheFileName, ec);
+	return !ec;
+}
+
+bool IOMap::decodeCachedTileArea(const char* data, size_t size, bool _legacy, StagedTileArea& area)
+{
+	PropStream cacheStream;
+	cacheStream.init(data, size);
+
+	uint32_t tileCount;
+	if (!cacheStream.read<uint32_t>(tileCount)) {
+		area.error = "Invalid map cache tile area.";
+		return false;
+	}
+
+	area.tiles.reserve(tileCount);
+	for (uint32_t i = 0; i < tileCount; ++i) {
+		area.tiles.emplace_back();
+		StagedTile& tile = area.tiles.back();
+
+		uint8_t isHouseTile;
+		uint16_t tileItemCount;
+		if (!cacheStream.read<uint16_t>(tile.x) || !cacheStream.read<uint16_t>(tile.y) || !cacheStream.read<uint8_t>(tile.z) ||
+		        !cacheStream.read<uint8_t>(isHouseTile) || !cacheStream.read<uint32_t>(tile.houseId) ||
+		        !cacheStream.read<uint32_t>(tile.flags) || !cacheStream.read<uint16_t>(tileItemCount)) {
+			area.error = "Invalid map cache tile.";
+			return false;
+		}
+		tile.isHouseTile = isHouseTile != 0;
+
+		//items of the tile props, the same bytes the .otbm file had
+		for (uint16_t j = 0; j < tileItemCount; ++j) {
+			uint16_t itemSize;
+			Item* item = nullptr;
+			if (cacheStream.read<uint16_t>(itemSize) && cacheStream.size() >= itemSize) {
+				PropStream propStream;
+				propStream.init(cacheStream.data(), itemSize);
+				cacheStream.skip(itemSize);
+				item = (_legacy ? Item::CreateItem_legacy(propStream) : Item::CreateItem(propStream));
+			}
+
+			if (!item) {
+				std::ostringstream ss;
+				ss << "[x:" << tile.x << ", y:" << tile.y << ", z:" << static_cast<uint16_t>(tile.z) << "] Failed to create item.";
+				area.error = ss.str();
+				return false;
+			}
+
+			tile.items.push_back(item);
+		}
+
+		uint32_t itemCount;
+		if (!cacheStream.read<uint32_t>(itemCount)) {
+			area.error = "Invalid map cache tile.";
+			return false;
+		}
+
+		for (uint32_t j = 0; j < itemCount; ++j) {
+			Item* item = readCachedItem(cacheStream, _legacy);
+			if (!item) {
+				std::ostringstream ss;
+				ss << "[x:" << tile.x << ", y:" << tile.y << ", z:" << static_cast<uint16_t>(tile.z) << "] Failed to load item.";
+				area.error = ss.str();
+				return false;
+			}
+
+			tile.items.push_back(item);
+		}
+	}
+	return true;
+}
+
+void IOMap::writeCachedItem(OTB::Loader& loader, const OTB::Node& itemNode, const Item* item, PropWriteStream& cacheStream)
+{
+	PropStream propStream;
+	loader.getProps(itemNode, propStream);
+	cacheStream.write<uint32_t>(propStream.size());
+	cacheStream.writeBytes(propStream.data(), propStream.size());
+
+	//only containers read the child nodes of an item
+	const Container* container = item->getContainer();
+	if (!container) {
+		cacheStream.write<uint32_t>(0);
+		return;
+	}
+
+	cacheStream.write<uint32_t>(itemNode.children.size());
+	auto it = container->getItemList().begin();
+	for (auto& childNode : itemNode.children) {
+		writeCachedItem(loader, childNode, *it++, cacheStream);
+	}
+}
+
+Item* IOMap::readCachedItem(PropStream& cacheStream, bool _legacy)
+{
+	uint32_t size;
+	if (!cacheStream.read<uint32_t>(size) || cacheStream.size() < size) {
+		return nullptr;
+	}
+
+	PropStream propStream;
+	propStream.init(cacheStream.data(), size);
+	cacheStream.skip(size);
+
+	Item* item = (_legacy ? Item::CreateItem_legacy(propStream) : Item::CreateItem(propStream));
+	if (!item) {
+		return nullptr;
+	}
+
+	uint32_t childCount;
+	if (!item->unserializeAttr(propStream) || !cacheStream.read<uint32_t>(childCount)) {
+		delete item;
+		return nullptr;
+	}
+
+	if (childCount == 0) {
+		return item;
+	}
+
+	Container* container = item->getContainer();
+	if (!container) {
+		delete item;
+		return nullptr;
+	}
+
+	for (uint32_t i = 0; i < childCount; ++i) {
+		Item* child = readCachedItem(cacheStream, _legacy);
+		if (!child) {
+			delete item;
+			return nullptr;
+		}
+
+		container->addItem(child);
+		container->updateItemWeight(child->getWeight());
+	}
+	return item;
+}
@@ -148,10 +148,74 @@ class IOMap
 		}
 
 	private:
+		struct StagedTile {
+			//items in file order, ground items included
+			std::vector<Item*> items;
+			uint32_t houseId = 0;
+			uint32_t flags = TILESTATE_NONE;
+			uint16_t x = 0;
+			uint16_t y = 0;
+			uint8_t z = 0;
+			bool isHouseTile = false;
+		};
+
+		struct StagedTileArea {
+			std::vector<StagedTile> tiles;
+			std::vector<std::function<void()>> deferredActions;
+			//the area in map cache format, only kept while a map cache is written
+			std::unique_ptr<PropWriteStream> cacheStream;
+			std::string error;
+			bool decoded = false;
+		};
+
+		//a file a map cache was made from, the hash of its contents is only taken with mapCacheVerify
+		struct MapCacheFile {
+			uint64_t size = 0;
+			int64_t modified = 0;
+			uint64_t hash = 0;
+		};
+
+		struct MapCacheKey {
+			MapCacheFile map;
+			MapCacheFile itemsOtb;
+			MapCacheFile itemsXml;
+		};
+
+		//the parts of the map cache collected while the .otbm file is read
+		struct MapCacheWriter {
+			PropWriteStream towns;
+			PropWriteStream waypoints;
+			std::vector<std::unique_ptr<PropWriteStream>> tileAreas;
+			std::string spawnFile;
+			std::string houseFile;
+			uint32_t townCount = 0;
+			uint32_t waypointCount = 0;
+			bool legacy = false;
+		};
+
+		using TileAreaDecoder = std::function<bool(size_t index, StagedTileArea& area)>;
+
+		bool parseMap(Map& map, const std::string& fileName);
 		bool parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, const std::string& fileName);
 		bool parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode, Map& map);
 		bool parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map);
-		bool parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map, bool _legacy);
+		bool parseTileAreas(size_t areaCount, const TileAreaDecoder& decodeArea, Map& map);
+		//only reads the file and creates the items, areas can be decoded on several threads at once
+		static bool decodeTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, bool _legacy, StagedTileArea& area);
+		static bool decodeCachedTileArea(const char* data, size_t size, bool _legacy, StagedTileArea& area);
+		//creates the tiles of a decoded area and adds them to the map, in file order
+		bool mergeTileArea(StagedTileArea& area, Map& map);
+
+		static bool getMapCacheFile(const std::string& fileName, MapCacheFile& file, bool hashContents);
+		static bool isSameMapCacheFile(const MapCacheFile& file, const MapCacheFile& other, bool compareHashes);
+		static bool getMapCacheKey(const std::string& fileName, MapCacheKey& key, bool hashContents);
+		//returns false only when the cache was valid but could not be loaded, loaded tells whether it was used
+		bool loadMapCache(Map& map, const std::string& cacheFileName, const MapCacheKey& key, bool& loaded);
+		bool saveMapCache(const Map& map, const std::string& cacheFileName, const MapCacheKey& key);
+		static void writeCachedItem(OTB::Loader& loader, const OTB::Node& itemNode, const Item* item, PropWriteStream& cacheStream);
+		static Item* readCachedItem(PropStream& cacheStream, bool _legacy);
+
+		std::unique_ptr<MapCacheWriter> cacheWriter;
 		std::string errorString;
 };
 
@@ -36,6 +36,25 @@ extern Spells* g_spells;
 extern Vocations g_vocations;
 
 Items Item::items;
+thread_local std::vector<std::function<void()>>* Item::deferredLoadActions = nullptr;
+
+namespace {
+
+struct DescriptionCacheEntry {
+	std::string description;
+	uint64_t key = 0;
+	uint64_t version = 0;
+	bool valid = false;
+};
+
+constexpr uint32_t DESCRIPTION_CACHE_BITS = 12;
+
+//descriptions are only built on the dispatcher thread
+DescriptionCacheEntry descriptionCache[1 << DESCRIPTION_CACHE_BITS];
+DescriptionCacheStats descriptionCacheStats;
+uint64_t descriptionCacheVersion = 0;
+
+}
 
 Item* Item::CreateItem(const uint16_t type, uint16_t count /*= 0*/)
 {
@@ -206,24 +225,20 @@ bool Item::equals(const Item* otherItem) const
 		return false;
 	}
 
-	const auto& attributeList = attributes->attributes;
-	const auto& otherAttributeList = otherAttributes->attributes;
-	for (const auto& attribute : attributeList) {
-		if (ItemAttributes::isStrAttrType(attribute.type)) {
-			for (const auto& otherAttribute : otherAttributeList) {
-				if (attribute.type == otherAttribute.type && *attribute.value.string != *otherAttribute.value.string) {
-					return false;
-				}
-			}
-		} else {
-			for (const auto& otherAttribute : otherAttributeList) {
-				if (attribute.type == otherAttribute.type && attribute.value.integer != otherAttribute.value.integer) {
-					return false;
-				}
-			}
+	//custom attributes are not compared, items that have them never count as equal
+	if (attributes->hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
+		return false;
+	}
+
+	size_t integerCount = _mm_popcount(attributes->attributeBits & ItemAttributes::INT_ATTRIBUTES);
+	for (size_t i = 0; i < integerCount; ++i) {
+		if (attributes->getInteger(i) != otherAttributes->getInteger(i)) {
+			return false;
 		}
 	}
-	return true;
+
+	//interned strings with the same text are the same string
+	return attributes->strings == otherAttributes->strings;
 }
 
 void Item::setDefaultSubtype()
@@ -407,12 +422,13 @@ Attr_ReadValue Item::readAttr(AttrTypes_t attr, PropStream& propStream)
 		}
 
 		case ATTR_TEXT: {
-			std::string text;
-			if (!propStream.readString(text)) {
+			const char* text;
+			uint16_t textLength;
+			if (!propStream.readStringView(text, textLength)) {
 				return ATTR_READ_ERROR;
 			}
 
-			setText(text);
+			setStrAttr(ITEM_ATTRIBUTE_TEXT, text, textLength);
 			break;
 		}
 
@@ -427,22 +443,24 @@ Attr_ReadValue Item::readAttr(AttrTypes_t attr, PropStream& propStream)
 		}
 
 		case ATTR_WRITTENBY: {
-			std::string writer;
-			if (!propStream.readString(writer)) {
+			const char* writer;
+			uint16_t writerLength;
+			if (!propStream.readStringView(writer, writerLength)) {
 				return ATTR_READ_ERROR;
 			}
 
-			setWriter(writer);
+			setStrAttr(ITEM_ATTRIBUTE_WRITER, writer, writerLength);
 			break;
 		}
 
 		case ATTR_DESC: {
-			std::string text;
-			if (!propStream.readString(text)) {
+			const char* text;
+			uint16_t textLength;
+			if (!propStream.readStringView(text, textLength)) {
 				return ATTR_READ_ERROR;
 			}
 
-			setSpecialDescription(text);
+			setStrAttr(ITEM_ATTRIBUTE_DESCRIPTION, text, textLength);
 			break;
 		}
 
@@ -479,32 +497,35 @@ Attr_ReadValue Item::readAttr(AttrTypes_t attr, PropStream& propStream)
 		}
 
 		case ATTR_NAME: {
-			std::string name;
-			if (!propStream.readString(name)) {
+			const char* name;
+			uint16_t nameLength;
+			if (!propStream.readStringView(name, nameLength)) {
 				return ATTR_READ_ERROR;
 			}
 
-			setStrAttr(ITEM_ATTRIBUTE_NAME, name);
+			setStrAttr(ITEM_ATTRIBUTE_NAME, name, nameLength);
 			break;
 		}
 
 		case ATTR_ARTICLE: {
-			std::string article;
-			if (!propStream.readString(article)) {
+			const char* article;
+			uint16_t articleLength;
+			if (!propStream.readStringView(article, articleLength)) {
 				return ATTR_READ_ERROR;
 			}
 
-			setStrAttr(ITEM_ATTRIBUTE_ARTICLE, article);
+			setStrAttr(ITEM_ATTRIBUTE_ARTICLE, article, articleLength);
 			break;
 		}
 
 		case ATTR_PLURALNAME: {
-			std::string pluralName;
-			if (!propStream.readString(pluralName)) {
+			const char* pluralName;
+			uint16_t pluralNameLength;
+			if (!propStream.readStringView(pluralName, pluralNameLength)) {
 				return ATTR_READ_ERROR;
 			}
 
-			setStrAttr(ITEM_ATTRIBUTE_PLURALNAME, pluralName);
+			setStrAttr(ITEM_ATTRIBUTE_PLURALNAME, pluralName, pluralNameLength);
 			break;
 		}
 
@@ -789,7 +810,7 @@ void Item::serializeAttr(PropWriteStream& propWriteStream) const
 		propWriteStream.write<uint64_t>(static_cast<uint64_t>(customAttrMap->size()));
 		for (const auto &entry : *customAttrMap) {
 			// Serializing key type and value
-			propWriteStream.writeString(entry.first);
+			propWriteStream.writeString(*entry.first);
 
 			// Serializing value type and value
 			entry.second.serialize(propWriteStream);
@@ -799,20 +820,20 @@ void Item::serializeAttr(PropWriteStream& propWriteStream) const
 
 bool Item::hasProperty(ITEMPROPERTY prop) const
 {
-	const ItemType& it = items[id];
+	const PackedItemType& it = items.getPackedType(id);
 	switch (prop) {
-		case CONST_PROP_BLOCKSOLID: return it.blockSolid;
-		case CONST_PROP_MOVEABLE: return it.moveable && !hasAttribute(ITEM_ATTRIBUTE_UNIQUEID);
-		case CONST_PROP_HASHEIGHT: return it.hasHeight;
-		case CONST_PROP_BLOCKPROJECTILE: return it.blockProjectile;
-		case CONST_PROP_BLOCKPATH: return it.blockPathFind;
-		case CONST_PROP_ISVERTICAL: return it.isVertical;
-		case CONST_PROP_ISHORIZONTAL: return it.isHorizontal;
-		case CONST_PROP_IMMOVABLEBLOCKSOLID: return it.blockSolid && (!it.moveable || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
-		case CONST_PROP_IMMOVABLEBLOCKPATH: return it.blockPathFind && (!it.moveable || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
-		case CONST_PROP_IMMOVABLENOFIELDBLOCKPATH: return !it.isMagicField() && it.blockPathFind && (!it.moveable || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
-		case CONST_PROP_NOFIELDBLOCKPATH: return !it.isMagicField() && it.blockPathFind;
-		case CONST_PROP_SUPPORTHANGABLE: return it.isHorizontal || it.isVertical;
+		case CONST_PROP_BLOCKSOLID: return it.hasFlag(ITEMFLAG_BLOCKSOLID);
+		case CONST_PROP_MOVEABLE: return it.hasFlag(ITEMFLAG_MOVEABLE) && !hasAttribute(ITEM_ATTRIBUTE_UNIQUEID);
+		case CONST_PROP_HASHEIGHT: return it.hasFlag(ITEMFLAG_HASHEIGHT);
+		case CONST_PROP_BLOCKPROJECTILE: return it.hasFlag(ITEMFLAG_BLOCKPROJECTILE);
+		case CONST_PROP_BLOCKPATH: return it.hasFlag(ITEMFLAG_BLOCKPATHFIND);
+		case CONST_PROP_ISVERTICAL: return it.hasFlag(ITEMFLAG_VERTICAL);
+		case CONST_PROP_ISHORIZONTAL: return it.hasFlag(ITEMFLAG_HORIZONTAL);
+		case CONST_PROP_IMMOVABLEBLOCKSOLID: return it.hasFlag(ITEMFLAG_BLOCKSOLID) && (!it.hasFlag(ITEMFLAG_MOVEABLE) || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
+		case CONST_PROP_IMMOVABLEBLOCKPATH: return it.hasFlag(ITEMFLAG_BLOCKPATHFIND) && (!it.hasFlag(ITEMFLAG_MOVEABLE) || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
+		case CONST_PROP_IMMOVABLENOFIELDBLOCKPATH: return !it.hasFlag(ITEMFLAG_MAGICFIELD) && it.hasFlag(ITEMFLAG_BLOCKPATHFIND) && (!it.hasFlag(ITEMFLAG_MOVEABLE) || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
+		case CONST_PROP_NOFIELDBLOCKPATH: return !it.hasFlag(ITEMFLAG_MAGICFIELD) && it.hasFlag(ITEMFLAG_BLOCKPATHFIND);
+		case CONST_PROP_SUPPORTHANGABLE: return it.hasFlag(ITEMFLAG_HORIZONTAL) || it.hasFlag(ITEMFLAG_VERTICAL);
 		default: return false;
 	}
 }
@@ -1294,6 +1315,68 @@ std::vector<std::pair<std::string, std::string>> Item::getDescriptions(const Ite
 
 std::string Item::getDescription(const ItemType& it, int32_t lookDistance,
                                  const Item* item /*= nullptr*/, int32_t subType /*= -1*/, bool addArticle /*= true*/)
+{
+	uint64_t version = 0;
+	if (item) {
+		//containers show the weight of their contents and durations count down while the item decays
+		if (item->getContainer() || (it.showDuration && item->hasAttribute(ITEM_ATTRIBUTE_DURATION))) {
+			++descriptionCacheStats.uncached;
+			return buildDescription(it, lookDistance, item, subType, addArticle);
+		}
+
+		subType = item->getSubType();
+
+		ItemAttributes* attributes = item->attributes.get();
+		if (attributes && attributes->attributeBits != 0) {
+			if (attributes->version == 0) {
+				attributes->version = ++descriptionCacheVersion;
+			}
+			version = attributes->version;
+		}
+	}
+
+	//the description only tells apart looking from next to the item, from reading distance and from further away
+	uint64_t distanceClass = (lookDistance <= 1 ? 0 : (lookDistance <= 4 ? 1 : 2));
+	uint64_t key = static_cast<uint64_t>(it.id) | (static_cast<uint64_t>(static_cast<uint32_t>(subType)) << 16) |
+	               (distanceClass << 48) | (static_cast<uint64_t>(item != nullptr) << 50) | (static_cast<uint64_t>(addArticle) << 51);
+
+	DescriptionCacheEntry& entry = descriptionCache[((key ^ (version * 0xC2B2AE3D27D4EB4FULL)) * 0x9E3779B97F4A7C15ULL) >> (64 - DESCRIPTION_CACHE_BITS)];
+	if (entry.valid && entry.key == key && entry.version == version) {
+		++descriptionCacheStats.hits;
+		return entry.description;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	entry.description = buildDescription(it, lookDistance, item, subType, addArticle);
+	entry.key = key;
+	entry.version = version;
+	entry.valid = true;
+
+	++descriptionCacheStats.misses;
+	descriptionCacheStats.buildTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	return entry.description;
+}
+
+const DescriptionCacheStats& Item::getDescriptionCacheStats()
+{
+	return descriptionCacheStats;
+}
+
+void Item::resetDescriptionCacheStats()
+{
+	descriptionCacheStats = DescriptionCacheStats();
+}
+
+void Item::clearDescriptionCache()
+{
+	for (DescriptionCacheEntry& entry : descriptionCache) {
+		entry.valid = false;
+		entry.description.clear();
+		entry.description.shrink_to_fit();
+	}
+}
+
+std::string Item::buildDescription(const ItemType& it, int32_t lookDistance, const Item* item, int32_t subType, bool addArticle)
 {
 	const std::string* text = nullptr;
 	char buffer[24]; // Enough to contain uint64_t
@@ -2021,6 +2104,11 @@ void Item::setUniqueId(uint16_t n)
 		return;
 	}
 
+	if (deferredLoadActions) {
+		deferredLoadActions->emplace_back([this, n]() { setUniqueId(n); });
+		return;
+	}
+
 	if (g_game.addUniqueItem(n, this)) {
 		getAttributes()->setUniqueId(n);
 	}
@@ -2072,32 +2160,119 @@ int64_t ItemAttributes::emptyInt;
 double ItemAttributes::emptyDouble;
 bool ItemAttributes::emptyBool;
 
-const std::string& ItemAttributes::getStrAttr(itemAttrTypes type) const
+ItemAttributes::ItemAttributes(const ItemAttributes& other) :
+	integers(other.integers), strings(other.strings), attributeBits(other.attributeBits), version(other.version)
 {
-	if (!isStrAttrType(type)) {
-		return emptyString;
+	std::copy(std::begin(other.inlineIntegers), std::end(other.inlineIntegers), std::begin(inlineIntegers));
+	if (other.customAttributes) {
+		customAttributes.reset(new CustomAttributeMap(*other.customAttributes));
+	}
+}
+
+namespace {
+
+//points into the caller's buffer for lookups and into the pooled string for entries,
+//so a string that is already pooled is found without building a std::string
+struct StringPoolKey {
+	const char* data;
+	size_t size;
+	size_t hash;
+
+	StringPoolKey(const char* data, size_t size) : data(data), size(size), hash(0xCBF29CE484222325ULL) {
+		//FNV-1a
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ static_cast<uint8_t>(data[i])) * 0x100000001B3ULL;
+		}
+	}
+
+	bool operator==(const StringPoolKey& other) const {
+		return size == other.size && std::memcmp(data, other.data, size) == 0;
 	}
+};
 
-	const Attribute* attr = getExistingAttr(type);
-	if (!attr) {
+struct StringPoolKeyHash {
+	size_t operator()(const StringPoolKey& key) const {
+		return key.hash;
+	}
+};
+
+//split by hash so the threads that load the map rarely wait on each other
+struct StringPoolShard {
+	std::mutex lock;
+	std::unordered_map<StringPoolKey, std::weak_ptr<const std::string>, StringPoolKeyHash> strings;
+};
+
+const size_t STRING_POOL_SHARDS = 16;
+
+StringPoolShard& getStringPoolShard(size_t hash)
+{
+	//never destroyed, items still release their strings while the globals are torn down
+	static StringPoolShard* shards = new StringPoolShard[STRING_POOL_SHARDS];
+	return shards[(hash >> 8) % STRING_POOL_SHARDS];
+}
+
+}
+
+ItemAttributes::SharedString ItemAttributes::internString(const char* value, size_t size)
+{
+	const StringPoolKey key(value, size);
+	StringPoolShard& shard = getStringPoolShard(key.hash);
+
+	//items get their strings on the worker threads too while the map is loaded
+	std::lock_guard<std::mutex> lockGuard(shard.lock);
+	auto it = shard.strings.find(key);
+	if (it != shard.strings.end()) {
+		if (SharedString string = it->second.lock()) {
+			return string;
+		}
+
+		//the last owner is in its deleter, waiting for this lock to remove the entry
+		shard.strings.erase(it);
+	}
+
+	//the pool entry is keyed by the pooled string, the last item that lets go of it removes the entry
+	SharedString string(new std::string(value, size), [](const std::string* released) {
+		const StringPoolKey releasedKey(released->data(), released->size());
+		StringPoolShard& releasedShard = getStringPoolShard(releasedKey.hash);
+		{
+			std::lock_guard<std::mutex> lockGuard(releasedShard.lock);
+			auto it = releasedShard.strings.find(releasedKey);
+			if (it != releasedShard.strings.end() && it->first.data == released->data()) {
+				releasedShard.strings.erase(it);
+			}
+		}
+		delete released;
+	});
+	shard.strings.emplace(StringPoolKey(string->data(), string->size()), string);
+	return string;
+}
+
+const std::string& ItemAttributes::getStrAttr(itemAttrTypes type) const
+{
+	if (!isStrAttrType(type) || !hasAttribute(type)) {
 		return emptyString;
 	}
-	return *attr->value.string;
+	return *strings[getValueIndex(STR_ATTRIBUTES, type)];
 }
 
-void ItemAttributes::setStrAttr(itemAttrTypes type, const std::string& value)
+void ItemAttributes::setStrAttr(itemAttrTypes type, const char* value, size_t size)
 {
 	if (!isStrAttrType(type)) {
 		return;
 	}
 
-	if (value.empty()) {
+	if (size == 0) {
 		return;
 	}
 
-	Attribute& attr = getAttr(type);
-	delete attr.value.string;
-	attr.value.string = new std::string(value);
+	size_t index = getValueIndex(STR_ATTRIBUTES, type);
+	if (hasAttribute(type)) {
+		strings[index] = internString(value, size);
+	} else {
+		strings.insert(strings.begin() + index, internString(value, size));
+		attributeBits |= type;
+	}
+	version = 0;
 }
 
 void ItemAttributes::removeAttribute(itemAttrTypes type)
@@ -2106,27 +2281,23 @@ void ItemAttributes::removeAttribute(itemAttrTypes type)
 		return;
 	}
 
-	for (auto it = attributes.begin(), end = attributes.end(); it != end; ++it) {
-		if ((*it).type == type) {
-			(*it) = std::move(attributes.back());
-			attributes.pop_back();
-			break;
-		}
+	if (isIntAttrType(type)) {
+		eraseInteger(getValueIndex(INT_ATTRIBUTES, type));
+	} else if (isStrAttrType(type)) {
+		strings.erase(strings.begin() + getValueIndex(STR_ATTRIBUTES, type));
+	} else if (isCustomAttrType(type)) {
+		customAttributes.reset();
 	}
 	attributeBits &= ~type;
+	version = 0;
 }
 
 int64_t ItemAttributes::getIntAttr(itemAttrTypes type) const
 {
-	if (!isIntAttrType(type)) {
-		return 0;
-	}
-
-	const Attribute* attr = getExistingAttr(type);
-	if (!attr) {
+	if (!isIntAttrType(type) || !hasAttribute(type)) {
 		return 0;
 	}
-	return attr->value.integer;
+	return getInteger(getValueIndex(INT_ATTRIBUTES, type));
 }
 
 void ItemAttributes::setIntAttr(itemAttrTypes type, int64_t value)
@@ -2135,7 +2306,14 @@ void ItemAttributes::setIntAttr(itemAttrTypes type, int64_t value)
 		return;
 	}
 
-	getAttr(type).value.integer = value;
+	size_t index = getValueIndex(INT_ATTRIBUTES, type);
+	if (hasAttribute(type)) {
+		getInteger(index) = value;
+	} else {
+		insertInteger(index, value);
+		attributeBits |= type;
+	}
+	version = 0;
 }
 
 void ItemAttributes::increaseIntAttr(itemAttrTypes type, int64_t value)
@@ -2144,34 +2322,41 @@ void ItemAttributes::increaseIntAttr(itemAttrTypes type, int64_t value)
 		return;
 	}
 
-	getAttr(type).value.integer += value;
+	size_t index = getValueIndex(INT_ATTRIBUTES, type);
+	if (hasAttribute(type)) {
+		getInteger(index) += value;
+	} else {
+		insertInteger(index, value);
+		attributeBits |= type;
+	}
+	version = 0;
 }
 
-const ItemAttributes::Attribute* ItemAttributes::getExistingAttr(itemAttrTypes type) const
+void ItemAttributes::insertInteger(size_t index, int64_t value)
 {
-	if (hasAttribute(type)) {
-		for (const Attribute& attribute : attributes) {
-			if (attribute.type == type) {
-				return &attribute;
-			}
-		}
+	size_t count = _mm_popcount(attributeBits & INT_ATTRIBUTES);
+	if (count >= INLINE_INTEGERS) {
+		integers.push_back(0);
 	}
-	return nullptr;
+
+	for (size_t i = count; i > index; --i) {
+		getInteger(i) = getInteger(i - 1);
+	}
+	getInteger(index) = value;
 }
 
-ItemAttributes::Attribute& ItemAttributes::getAttr(itemAttrTypes type)
+void ItemAttributes::eraseInteger(size_t index)
 {
-	if (hasAttribute(type)) {
-		for (Attribute& attribute : attributes) {
-			if (attribute.type == type) {
-				return attribute;
-			}
-		}
+	size_t count = _mm_popcount(attributeBits & INT_ATTRIBUTES);
+	for (size_t i = index + 1; i < count; ++i) {
+		getInteger(i - 1) = getInteger(i);
 	}
 
-	attributeBits |= type;
-	attributes.emplace_back(type);
-	return attributes.back();
+	if (count > INLINE_INTEGERS) {
+		integers.pop_back();
+	} else {
+		inlineIntegers[count - 1] = 0;
+	}
 }
 
 void Item::startDecaying()
@@ -2190,18 +2375,20 @@ bool Item::hasMarketAttributes() const
 		return true;
 	}
 
-	for (const auto& attr : attributes->getList()) {
-		if (attr.type == ITEM_ATTRIBUTE_CHARGES) {
-			uint16_t charges = static_cast<uint16_t>(attr.value.integer);
-			if (charges != items[id].charges) {
-				return false;
-			}
-		} else if (attr.type == ITEM_ATTRIBUTE_DURATION) {
-			uint32_t duration = static_cast<uint32_t>(attr.value.integer);
-			if (duration != getDefaultDuration()) {
-				return false;
-			}
-		} else {
+	if ((attributes->attributeBits & ~(ITEM_ATTRIBUTE_CHARGES | ITEM_ATTRIBUTE_DURATION)) != 0) {
+		return false;
+	}
+
+	if (hasAttribute(ITEM_ATTRIBUTE_CHARGES)) {
+		uint16_t charges = static_cast<uint16_t>(getIntAttr(ITEM_ATTRIBUTE_CHARGES));
+		if (charges != items[id].charges) {
+			return false;
+		}
+	}
+
+	if (hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
+		uint32_t duration = static_cast<uint32_t>(getIntAttr(ITEM_ATTRIBUTE_DURATION));
+		if (duration != getDefaultDuration()) {
 			return false;
 		}
 	}
@@ -23,6 +23,7 @@
 #include "cylinder.h"
 #include "thing.h"
 #include "items.h"
+#include "itemallocator.h"
 #include "luascript.h"
 #include "tools.h"
 #include <typeinfo>
@@ -30,6 +31,7 @@
 #include <boost/variant.hpp>
 #include <boost/lexical_cast.hpp>
 #include <deque>
+#include <limits>
 
 class Creature;
 class Player;
@@ -374,7 +376,30 @@ class ItemAttributes
 			}
 		};
 
+		ItemAttributes(const ItemAttributes& other);
+
+		// non-assignable
+		ItemAttributes& operator=(const ItemAttributes&) = delete;
+
 	private:
+		typedef std::underlying_type<itemAttrTypes>::type AttributeBits;
+		//string values are interned, items with the same text share one string
+		typedef std::shared_ptr<const std::string> SharedString;
+		typedef std::vector<std::pair<SharedString, CustomAttribute>> CustomAttributeMap;
+
+		static constexpr AttributeBits INT_ATTRIBUTES = ITEM_ATTRIBUTE_ACTIONID | ITEM_ATTRIBUTE_UNIQUEID | ITEM_ATTRIBUTE_DATE |
+			ITEM_ATTRIBUTE_WEIGHT | ITEM_ATTRIBUTE_ATTACK | ITEM_ATTRIBUTE_DEFENSE | ITEM_ATTRIBUTE_EXTRADEFENSE |
+			ITEM_ATTRIBUTE_ARMOR | ITEM_ATTRIBUTE_HITCHANCE | ITEM_ATTRIBUTE_SHOOTRANGE | ITEM_ATTRIBUTE_OWNER |
+			ITEM_ATTRIBUTE_DURATION | ITEM_ATTRIBUTE_DECAYSTATE | ITEM_ATTRIBUTE_CORPSEOWNER | ITEM_ATTRIBUTE_CHARGES |
+			ITEM_ATTRIBUTE_FLUIDTYPE | ITEM_ATTRIBUTE_DOORID | ITEM_ATTRIBUTE_DURATION_TIMESTAMP;
+		static constexpr AttributeBits STR_ATTRIBUTES = ITEM_ATTRIBUTE_DESCRIPTION | ITEM_ATTRIBUTE_TEXT | ITEM_ATTRIBUTE_WRITER |
+			ITEM_ATTRIBUTE_NAME | ITEM_ATTRIBUTE_ARTICLE | ITEM_ATTRIBUTE_PLURALNAME;
+		//most items with attributes carry one or two integers, like an action id or a duration and decay state
+		static constexpr size_t INLINE_INTEGERS = 2;
+		static constexpr uint32_t INVALID_DECAY_NODE = std::numeric_limits<uint32_t>::max();
+
+		static SharedString internString(const char* value, size_t size);
+
 		bool hasAttribute(itemAttrTypes type) const {
 			return (type & static_cast<itemAttrTypes>(attributeBits)) != 0;
 		}
@@ -385,83 +410,43 @@ class ItemAttributes
 		static double emptyDouble;
 		static bool emptyBool;
 
-		typedef std::unordered_map<std::string, CustomAttribute> CustomAttributeMap;
-
-		struct Attribute
-		{
-			union {
-				int64_t integer;
-				std::string* string;
-				CustomAttributeMap* custom;
-			} value;
-			itemAttrTypes type;
-
-			//non-copyable
-			Attribute& operator=(const Attribute& other) = delete;
-
-			Attribute(itemAttrTypes type) : type(type) {
-				memset(&value, 0, sizeof(value));
-			}
-			Attribute(const Attribute& i) {
-				type = i.type;
-				if (ItemAttributes::isIntAttrType(type)) {
-					value.integer = i.value.integer;
-				} else if (ItemAttributes::isStrAttrType(type)) {
-					value.string = new std::string(*i.value.string);
-				} else if (ItemAttributes::isCustomAttrType(type)) {
-					value.custom = new CustomAttributeMap(*i.value.custom);
-				} else {
-					memset(&value, 0, sizeof(value));
-				}
-			}
-			Attribute(Attribute&& attribute) noexcept : value(attribute.value), type(attribute.type) {
-				memset(&attribute.value, 0, sizeof(value));
-				attribute.type = ITEM_ATTRIBUTE_NONE;
-			}
-			Attribute& operator=(Attribute&& other) noexcept {
-				if (this != &other) {
-					if (ItemAttributes::isStrAttrType(type)) {
-						delete value.string;
-					} else if (ItemAttributes::isCustomAttrType(type)) {
-						delete value.custom;
-					}
-
-					value = other.value;
-					type = other.type;
-
-					memset(&other.value, 0, sizeof(value));
-					other.type = ITEM_ATTRIBUTE_NONE;
-				}
-				return *this;
-			}
-			~Attribute() {
-				if (ItemAttributes::isStrAttrType(type)) {
-					delete value.string;
-				} else if (ItemAttributes::isCustomAttrType(type)) {
-					delete value.custom;
-				}
-			}
-		};
+		//the values of each kind are kept in the order of their attribute bits, so the index
+		//of a value is the number of attributes of its kind that are set below its bit
+		size_t getValueIndex(AttributeBits kind, itemAttrTypes type) const {
+			return _mm_popcount(attributeBits & kind & (type - 1));
+		}
+		int64_t& getInteger(size_t index) {
+			return index < INLINE_INTEGERS ? inlineIntegers[index] : integers[index - INLINE_INTEGERS];
+		}
+		int64_t getInteger(size_t index) const {
+			return index < INLINE_INTEGERS ? inlineIntegers[index] : integers[index - INLINE_INTEGERS];
+		}
+		void insertInteger(size_t index, int64_t value);
+		void eraseInteger(size_t index);
 
-		std::vector<Attribute> attributes;
-		std::underlying_type<itemAttrTypes>::type attributeBits = 0;
+		int64_t inlineIntegers[INLINE_INTEGERS] = {};
+		std::vector<int64_t> integers;
+		std::vector<SharedString> strings;
+		std::unique_ptr<CustomAttributeMap> customAttributes;
+		AttributeBits attributeBits = 0;
+		//the slot handle of the item in the decay wheel
+		uint32_t decayNode = INVALID_DECAY_NODE;
+		//identifies the attribute values in the description cache, every change resets it and
+		//the next cached description hands out a new one
+		uint64_t version = 0;
 
 		const std::string& getStrAttr(itemAttrTypes type) const;
-		void setStrAttr(itemAttrTypes type, const std::string& value);
+		void setStrAttr(itemAttrTypes type, const std::string& value) {
+			setStrAttr(type, value.data(), value.size());
+		}
+		void setStrAttr(itemAttrTypes type, const char* value, size_t size);
 
 		int64_t getIntAttr(itemAttrTypes type) const;
 		void setIntAttr(itemAttrTypes type, int64_t value);
 		void increaseIntAttr(itemAttrTypes type, int64_t value);
 
-		const Attribute* getExistingAttr(itemAttrTypes type) const;
-		Attribute& getAttr(itemAttrTypes type);
-
 		CustomAttributeMap* getCustomAttributeMap() {
-			if (!hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				return nullptr;
-			}
-
-			return getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom;
+			return customAttributes.get();
 		}
 
 		template<typename R>
@@ -477,23 +462,19 @@ class ItemAttributes
 
 		template<typename R>
 		void setCustomAttribute(std::string& key, R value) {
-			toLowerCaseString(key);
-			if (hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				removeCustomAttribute(key);
-			} else {
-				getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom = new CustomAttributeMap();
-			}
-			getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom->emplace(key, value);
+			CustomAttribute attribute(value);
+			setCustomAttribute(key, attribute);
 		}
 
 		void setCustomAttribute(std::string& key, CustomAttribute& value) {
 			toLowerCaseString(key);
-			if (hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
+			if (customAttributes) {
 				removeCustomAttribute(key);
 			} else {
-				getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom = new CustomAttributeMap();
+				customAttributes.reset(new CustomAttributeMap());
+				attributeBits |= ITEM_ATTRIBUTE_CUSTOM;
 			}
-			getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom->insert(std::make_pair(std::move(key), std::move(value)));
+			customAttributes->emplace_back(internString(key.data(), key.size()), std::move(value));
 		}
 
 		const CustomAttribute* getCustomAttribute(int64_t key) {
@@ -503,9 +484,11 @@ class ItemAttributes
 
 		const CustomAttribute* getCustomAttribute(const std::string& key) {
 			if (const CustomAttributeMap* customAttrMap = getCustomAttributeMap()) {
-				auto it = customAttrMap->find(asLowerCaseString(key));
-				if (it != customAttrMap->end()) {
-					return &(it->second);
+				const std::string lowerKey = asLowerCaseString(key);
+				for (const auto& entry : *customAttrMap) {
+					if (*entry.first == lowerKey) {
+						return &entry.second;
+					}
 				}
 			}
 			return nullptr;
@@ -518,10 +501,15 @@ class ItemAttributes
 
 		bool removeCustomAttribute(const std::string& key) {
 			if (CustomAttributeMap* customAttrMap = getCustomAttributeMap()) {
-				auto it = customAttrMap->find(asLowerCaseString(key));
-				if (it != customAttrMap->end()) {
-					customAttrMap->erase(it);
-					return true;
+				const std::string lowerKey = asLowerCaseString(key);
+				for (auto it = customAttrMap->begin(), end = customAttrMap->end(); it != end; ++it) {
+					if (*it->first == lowerKey) {
+						if (it + 1 != end) {
+							*it = std::move(customAttrMap->back());
+						}
+						customAttrMap->pop_back();
+						return true;
+					}
 				}
 			}
 			return false;
@@ -529,46 +517,25 @@ class ItemAttributes
 
 	public:
 		static bool isIntAttrType(itemAttrTypes type) {
-			std::underlying_type<itemAttrTypes>::type checkTypes = 0;
-			checkTypes |= ITEM_ATTRIBUTE_ACTIONID;
-			checkTypes |= ITEM_ATTRIBUTE_UNIQUEID;
-			checkTypes |= ITEM_ATTRIBUTE_DATE;
-			checkTypes |= ITEM_ATTRIBUTE_WEIGHT;
-			checkTypes |= ITEM_ATTRIBUTE_ATTACK;
-			checkTypes |= ITEM_ATTRIBUTE_DEFENSE;
-			checkTypes |= ITEM_ATTRIBUTE_EXTRADEFENSE;
-			checkTypes |= ITEM_ATTRIBUTE_ARMOR;
-			checkTypes |= ITEM_ATTRIBUTE_HITCHANCE;
-			checkTypes |= ITEM_ATTRIBUTE_SHOOTRANGE;
-			checkTypes |= ITEM_ATTRIBUTE_OWNER;
-			checkTypes |= ITEM_ATTRIBUTE_DURATION;
-			checkTypes |= ITEM_ATTRIBUTE_DECAYSTATE;
-			checkTypes |= ITEM_ATTRIBUTE_CORPSEOWNER;
-			checkTypes |= ITEM_ATTRIBUTE_CHARGES;
-			checkTypes |= ITEM_ATTRIBUTE_FLUIDTYPE;
-			checkTypes |= ITEM_ATTRIBUTE_DOORID;
-			checkTypes |= ITEM_ATTRIBUTE_DURATION_TIMESTAMP;
-			return (type & static_cast<itemAttrTypes>(checkTypes)) != 0;
+			return (type & INT_ATTRIBUTES) != 0;
 		}
 		static bool isStrAttrType(itemAttrTypes type) {
-			std::underlying_type<itemAttrTypes>::type checkTypes = 0;
-			checkTypes |= ITEM_ATTRIBUTE_DESCRIPTION;
-			checkTypes |= ITEM_ATTRIBUTE_TEXT;
-			checkTypes |= ITEM_ATTRIBUTE_WRITER;
-			checkTypes |= ITEM_ATTRIBUTE_NAME;
-			checkTypes |= ITEM_ATTRIBUTE_ARTICLE;
-			checkTypes |= ITEM_ATTRIBUTE_PLURALNAME;
-			return (type & static_cast<itemAttrTypes>(checkTypes)) != 0;
+			return (type & STR_ATTRIBUTES) != 0;
 		}
 		inline static bool isCustomAttrType(itemAttrTypes type) {
 			return (type & ITEM_ATTRIBUTE_CUSTOM) != 0;
 		}
 
-		const std::vector<Attribute>& getList() const {
-			return attributes;
-		}
-
 	friend class Item;
+	friend class Decay;
+};
+
+struct DescriptionCacheStats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t uncached = 0;
+	//time spent building the descriptions that missed, in microseconds
+	uint64_t buildTime = 0;
 };
 
 class Item : virtual public Thing
@@ -580,6 +547,9 @@ class Item : virtual public Thing
 		static Item* CreateItem(PropStream& propStream);
 		static Item* CreateItem_legacy(PropStream& propStream);
 		static Items items;
+		//set while map items are decoded on a worker thread, collects the registrations with the game
+		//the decoding would make so the map loader can run them in load order on its own thread
+		static thread_local std::vector<std::function<void()>>* deferredLoadActions;
 
 		// Constructor for items
 		Item(const uint16_t type, uint16_t count = 0);
@@ -591,6 +561,16 @@ class Item : virtual public Thing
 		// non-assignable
 		Item& operator=(const Item&) = delete;
 
+		#if GAME_FEATURE_ITEM_SLAB_ALLOCATOR > 0
+		//every item class goes through these, the size is the one of the created or deleted class
+		static void* operator new(size_t size) {
+			return ItemAllocator::allocate(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			ItemAllocator::deallocate(p, size);
+		}
+		#endif
+
 		bool equals(const Item* otherItem) const;
 
 		Item* getItem() override final {
@@ -645,6 +625,9 @@ class Item : virtual public Thing
 		void setStrAttr(itemAttrTypes type, const std::string& value) {
 			getAttributes()->setStrAttr(type, value);
 		}
+		void setStrAttr(itemAttrTypes type, const char* value, size_t size) {
+			getAttributes()->setStrAttr(type, value, size);
+		}
 
 		int64_t getIntAttr(itemAttrTypes type) const {
 			if (!attributes) {
@@ -843,6 +826,10 @@ class Item : virtual public Thing
 		std::string getNameDescription() const;
 		std::string getWeightDescription() const;
 
+		static const DescriptionCacheStats& getDescriptionCacheStats();
+		static void resetDescriptionCacheStats();
+		static void clearDescriptionCache();
+
 		//serialization
 		virtual Attr_ReadValue readAttr(AttrTypes_t attr, PropStream& propStream);
 		bool unserializeAttr(PropStream& propStream);
@@ -927,19 +914,19 @@ class Item : virtual public Thing
 
 		bool hasProperty(ITEMPROPERTY prop) const;
 		bool isBlocking() const {
-			return items[id].blockSolid;
+			return items.getPackedType(id).hasFlag(ITEMFLAG_BLOCKSOLID);
 		}
 		bool isStackable() const {
-			return items[id].stackable;
+			return items.getPackedType(id).hasFlag(ITEMFLAG_STACKABLE);
 		}
 		bool isAlwaysOnTop() const {
-			return items[id].alwaysOnTop;
+			return items.getPackedType(id).hasFlag(ITEMFLAG_ALWAYSONTOP);
 		}
 		bool isGroundTile() const {
-			return items[id].isGroundTile();
+			return items.getPackedType(id).hasFlag(ITEMFLAG_GROUND);
 		}
 		bool isMagicField() const {
-			return items[id].isMagicField();
+			return items.getPackedType(id).hasFlag(ITEMFLAG_MAGICFIELD);
 		}
 		bool isMoveable() const {
 			#if GAME_FEATURE_STORE_INBOX > 0
@@ -951,16 +938,16 @@ class Item : virtual public Thing
 				return false;
 			}
 			#endif
-			return items[id].moveable;
+			return items.getPackedType(id).hasFlag(ITEMFLAG_MOVEABLE);
 		}
 		bool isPickupable() const {
-			return items[id].pickupable;
+			return items.getPackedType(id).hasFlag(ITEMFLAG_PICKUPABLE);
 		}
 		bool isUseable() const {
-			return items[id].useable;
+			return items.getPackedType(id).hasFlag(ITEMFLAG_USEABLE);
 		}
 		bool isHangable() const {
-			return items[id].isHangable;
+			return items.getPackedType(id).hasFlag(ITEMFLAG_HANGABLE);
 		}
 		bool isRotatable() const {
 			const ItemType& it = items[id];
@@ -970,7 +957,7 @@ class Item : virtual public Thing
 			return (items[id].wrapableTo != 0);
 		}
 		bool hasWalkStack() const {
-			return items[id].walkStack;
+			return items.getPackedType(id).hasFlag(ITEMFLAG_WALKSTACK);
 		}
 
 		const std::string& getName() const {
@@ -1083,6 +1070,8 @@ class Item : virtual public Thing
 		Cylinder* parent = nullptr;
 
 	private:
+		static std::string buildDescription(const ItemType& it, int32_t lookDistance, const Item* item, int32_t subType, bool addArticle);
+
 		std::string getWeightDescription(uint32_t weight) const;
 
 		std::unique_ptr<ItemAttributes> attributes;
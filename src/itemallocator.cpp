@@ -0,0 +1,217 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "itemallocator.h"
+
+namespace {
+
+const uint32_t ITEM_LOCAL_CACHE_CAPACITY = 64;
+//objects moved between a thread cache and the shared size class at once
+const uint32_t ITEM_LOCAL_CACHE_BATCH = 32;
+
+struct SizeClass {
+	std::mutex lock;
+	//freed objects, each one holds the pointer to the next
+	void* freeList = nullptr;
+	//the unused rest of the newest slab
+	char* slabNext = nullptr;
+	char* slabEnd = nullptr;
+	std::vector<void*> slabs;
+	uint64_t capacity = 0;
+	//counted outside of the lock, objects in thread caches are not live
+	std::atomic<uint64_t> live {0};
+	std::atomic<uint64_t> allocations {0};
+};
+
+SizeClass* getSizeClasses()
+{
+	//never destroyed, items are still released while the globals are torn down
+	static SizeClass* sizeClasses = new SizeClass[ItemAllocator::SIZE_CLASS_COUNT];
+	return sizeClasses;
+}
+
+//sizes past the last class, zero included, wrap around to a too large index
+size_t getSizeClassIndex(size_t size)
+{
+	return (size + ItemAllocator::SIZE_CLASS_GRANULARITY - 1) / ItemAllocator::SIZE_CLASS_GRANULARITY - 1;
+}
+
+//takes the object from the shared freelist or the newest slab, the size class has to be locked
+void* takeObject(SizeClass& sizeClass, size_t index)
+{
+	if (void* p = sizeClass.freeList) {
+		sizeClass.freeList = *static_cast<void**>(p);
+		return p;
+	}
+
+	const size_t objectSize = (index + 1) * ItemAllocator::SIZE_CLASS_GRANULARITY;
+	if (static_cast<size_t>(sizeClass.slabEnd - sizeClass.slabNext) < objectSize) {
+		char* slab = static_cast<char*>(::operator new(ItemAllocator::SLAB_SIZE + ItemAllocator::CACHE_LINE_SIZE));
+		sizeClass.slabs.push_back(slab);
+
+		//objects of sizes that are a multiple of a cache line never straddle two lines
+		uintptr_t address = reinterpret_cast<uintptr_t>(slab);
+		sizeClass.slabNext = slab + ((ItemAllocator::CACHE_LINE_SIZE - (address % ItemAllocator::CACHE_LINE_SIZE)) % ItemAllocator::CACHE_LINE_SIZE);
+		sizeClass.slabEnd = sizeClass.slabNext + ItemAllocator::SLAB_SIZE;
+		sizeClass.capacity += ItemAllocator::SLAB_SIZE / objectSize;
+	}
+
+	void* p = sizeClass.slabNext;
+	sizeClass.slabNext += objectSize;
+	return p;
+}
+
+struct LocalSizeClass {
+	void* freeList = nullptr;
+	uint32_t count = 0;
+};
+
+//keeps freed objects of the thread so that most allocations don't lock the size class,
+//the cache goes back to the shared freelists when the thread ends
+struct ItemLocalCache
+{
+	~ItemLocalCache();
+
+	void flush(size_t index, uint32_t count) {
+		LocalSizeClass& localClass = sizeClasses[index];
+		if (count == 0) {
+			return;
+		}
+
+		//unlink the batch first so the lock is only held to splice it
+		void* first = localClass.freeList;
+		void* last = first;
+		for (uint32_t i = 1; i < count; ++i) {
+			last = *static_cast<void**>(last);
+		}
+		localClass.freeList = *static_cast<void**>(last);
+		localClass.count -= count;
+
+		SizeClass& sizeClass = getSizeClasses()[index];
+		std::lock_guard<std::mutex> lockGuard(sizeClass.lock);
+		*static_cast<void**>(last) = sizeClass.freeList;
+		sizeClass.freeList = first;
+	}
+
+	LocalSizeClass sizeClasses[ItemAllocator::SIZE_CLASS_COUNT];
+};
+
+//trivially destructible, so it can still be read while the thread cache is torn down
+thread_local bool itemLocalCacheDestroyed = false;
+thread_local ItemLocalCache itemLocalCache;
+
+ItemLocalCache::~ItemLocalCache()
+{
+	for (size_t index = 0; index < ItemAllocator::SIZE_CLASS_COUNT; ++index) {
+		flush(index, sizeClasses[index].count);
+	}
+	itemLocalCacheDestroyed = true;
+}
+
+}
+
+void* ItemAllocator::allocate(size_t size)
+{
+	size_t index = getSizeClassIndex(size);
+	if (index >= SIZE_CLASS_COUNT) {
+		return ::operator new(size);
+	}
+
+	SizeClass& sizeClass = getSizeClasses()[index];
+	sizeClass.live.fetch_add(1, std::memory_order_relaxed);
+	sizeClass.allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (itemLocalCacheDestroyed) {
+		std::lock_guard<std::mutex> lockGuard(sizeClass.lock);
+		return takeObject(sizeClass, index);
+	}
+
+	LocalSizeClass& localClass = itemLocalCache.sizeClasses[index];
+	if (localClass.count == 0) {
+		std::lock_guard<std::mutex> lockGuard(sizeClass.lock);
+		for (uint32_t i = 1; i < ITEM_LOCAL_CACHE_BATCH; ++i) {
+			void* p = takeObject(sizeClass, index);
+			*static_cast<void**>(p) = localClass.freeList;
+			localClass.freeList = p;
+			++localClass.count;
+		}
+		return takeObject(sizeClass, index);
+	}
+
+	void* p = localClass.freeList;
+	localClass.freeList = *static_cast<void**>(p);
+	--localClass.count;
+	return p;
+}
+
+void ItemAllocator::deallocate(void* p, size_t size)
+{
+	if (!p) {
+		return;
+	}
+
+	size_t index = getSizeClassIndex(size);
+	if (index >= SIZE_CLASS_COUNT) {
+		::operator delete(p);
+		return;
+	}
+
+	SizeClass& sizeClass = getSizeClasses()[index];
+	sizeClass.live.fetch_sub(1, std::memory_order_relaxed);
+
+	if (itemLocalCacheDestroyed) {
+		std::lock_guard<std::mutex> lockGuard(sizeClass.lock);
+		*static_cast<void**>(p) = sizeClass.freeList;
+		sizeClass.freeList = p;
+		return;
+	}
+
+	LocalSizeClass& localClass = itemLocalCache.sizeClasses[index];
+	*static_cast<void**>(p) = localClass.freeList;
+	localClass.freeList = p;
+	if (++localClass.count > ITEM_LOCAL_CACHE_CAPACITY) {
+		itemLocalCache.flush(index, ITEM_LOCAL_CACHE_BATCH);
+	}
+}
+
+std::vector<ItemSizeClassStats> ItemAllocator::getStats()
+{
+	std::vector<ItemSizeClassStats> stats;
+	SizeClass* sizeClasses = getSizeClasses();
+	for (size_t index = 0; index < SIZE_CLASS_COUNT; ++index) {
+		SizeClass& sizeClass = sizeClasses[index];
+		const uint64_t allocations = sizeClass.allocations.load(std::memory_order_relaxed);
+		if (allocations == 0) {
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lockGuard(sizeClass.lock);
+
+		ItemSizeClassStats sizeClassStats;
+		sizeClassStats.objectSize = (index + 1) * SIZE_CLASS_GRANULARITY;
+		sizeClassStats.live = sizeClass.live.load(std::memory_order_relaxed);
+		sizeClassStats.capacity = sizeClass.capacity;
+		sizeClassStats.slabs = sizeClass.slabs.size();
+		sizeClassStats.allocations = allocations;
+		stats.push_back(sizeClassStats);
+	}
+	return stats;
+}
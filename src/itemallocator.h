@@ -0,0 +1,49 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_ITEMALLOCATOR_H_5C0E3A7F91B24D6E8A1F2B7C9D04E6A3
+#define FS_ITEMALLOCATOR_H_5C0E3A7F91B24D6E8A1F2B7C9D04E6A3
+
+struct ItemSizeClassStats {
+	size_t objectSize = 0;
+	uint64_t live = 0;
+	uint64_t capacity = 0;
+	uint64_t slabs = 0;
+	uint64_t allocations = 0;
+};
+
+//hands out the memory of items from slabs shared by all item classes of the same size,
+//freed objects go back to a per thread cache and in batches to the freelist of their size class,
+//the slabs are kept for reuse
+class ItemAllocator
+{
+	public:
+		static constexpr size_t SIZE_CLASS_GRANULARITY = 16;
+		static constexpr size_t SIZE_CLASS_COUNT = 32;
+		static constexpr size_t SLAB_SIZE = 64 * 1024;
+		static constexpr size_t CACHE_LINE_SIZE = 64;
+
+		static void* allocate(size_t size);
+		static void deallocate(void* p, size_t size);
+
+		//size classes that have been used, live objects and slab capacity are counted in objects
+		static std::vector<ItemSizeClassStats> getStats();
+};
+
+#endif
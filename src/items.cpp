@@ -151,6 +151,8 @@ const std::unordered_map<std::string, ItemParseAttributes_t> ItemParseAttributes
 	{"allowdistread", ITEM_PARSE_ALLOWDISTREAD},
 };
 
+const PackedItemType Items::emptyPackedType = PackedItemType();
+
 Items::Items()
 {
 	items.reserve(30000);
@@ -161,6 +163,7 @@ void Items::clear()
 {
 	items.clear();
 	reverseItemMap.clear();
+	packedTypes.clear();
 }
 
 bool Items::reload()
@@ -170,6 +173,8 @@ bool Items::reload()
 	reverseItemMap.reserve(30000);
 	loadFromOtb("data/items/" + std::to_string(CLIENT_VERSION) + "/items.otb");
 	if (!loadFromXml()) {
+		//the item types from items.otb are still in use
+		packItemTypes();
 		return false;
 	}
 
@@ -966,9 +971,82 @@ bool Items::loadFromXml()
 		}
 	}
 
+	packItemTypes();
 	return true;
 }
 
+void Items::packItemTypes()
+{
+	packedTypes.assign(items.size(), PackedItemType());
+	for (size_t id = 0, size = items.size(); id < size; ++id) {
+		const ItemType& it = items[id];
+		PackedItemType& packedType = packedTypes[id];
+
+		uint32_t flags = 0;
+		if (it.blockSolid) {
+			flags |= ITEMFLAG_BLOCKSOLID;
+		}
+		if (it.hasHeight) {
+			flags |= ITEMFLAG_HASHEIGHT;
+		}
+		if (it.blockProjectile) {
+			flags |= ITEMFLAG_BLOCKPROJECTILE;
+		}
+		if (it.blockPathFind) {
+			flags |= ITEMFLAG_BLOCKPATHFIND;
+		}
+		if (it.isVertical) {
+			flags |= ITEMFLAG_VERTICAL;
+		}
+		if (it.isHorizontal) {
+			flags |= ITEMFLAG_HORIZONTAL;
+		}
+		if (it.moveable) {
+			flags |= ITEMFLAG_MOVEABLE;
+		}
+		if (it.pickupable) {
+			flags |= ITEMFLAG_PICKUPABLE;
+		}
+		if (it.allowPickupable) {
+			flags |= ITEMFLAG_ALLOWPICKUPABLE;
+		}
+		if (it.stackable) {
+			flags |= ITEMFLAG_STACKABLE;
+		}
+		if (it.alwaysOnTop) {
+			flags |= ITEMFLAG_ALWAYSONTOP;
+		}
+		if (it.useable) {
+			flags |= ITEMFLAG_USEABLE;
+		}
+		if (it.isHangable) {
+			flags |= ITEMFLAG_HANGABLE;
+		}
+		if (it.walkStack) {
+			flags |= ITEMFLAG_WALKSTACK;
+		}
+		if (it.lookThrough) {
+			flags |= ITEMFLAG_LOOKTHROUGH;
+		}
+		if (it.isGroundTile()) {
+			flags |= ITEMFLAG_GROUND;
+		}
+		if (it.isSplash()) {
+			flags |= ITEMFLAG_SPLASH;
+		}
+		if (it.isMagicField()) {
+			flags |= ITEMFLAG_MAGICFIELD;
+		}
+		if (it.isBed()) {
+			flags |= ITEMFLAG_BED;
+		}
+
+		packedType.flags = flags;
+		packedType.alwaysOnTopOrder = it.alwaysOnTopOrder;
+		packedType.floorChange = it.floorChange;
+	}
+}
+
 void Items::parseItemNode(const pugi::xml_node& itemNode, uint16_t id)
 {
 	// Auto detect fluid ids
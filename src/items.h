@@ -204,6 +204,40 @@ struct Abilities {
 
 class ConditionDamage;
 
+enum ItemTypeFlags_t : uint32_t {
+	ITEMFLAG_BLOCKSOLID = 1 << 0,
+	ITEMFLAG_HASHEIGHT = 1 << 1,
+	ITEMFLAG_BLOCKPROJECTILE = 1 << 2,
+	ITEMFLAG_BLOCKPATHFIND = 1 << 3,
+	ITEMFLAG_VERTICAL = 1 << 4,
+	ITEMFLAG_HORIZONTAL = 1 << 5,
+	ITEMFLAG_MOVEABLE = 1 << 6,
+	ITEMFLAG_PICKUPABLE = 1 << 7,
+	ITEMFLAG_ALLOWPICKUPABLE = 1 << 8,
+	ITEMFLAG_STACKABLE = 1 << 9,
+	ITEMFLAG_ALWAYSONTOP = 1 << 10,
+	ITEMFLAG_USEABLE = 1 << 11,
+	ITEMFLAG_HANGABLE = 1 << 12,
+	ITEMFLAG_WALKSTACK = 1 << 13,
+	ITEMFLAG_LOOKTHROUGH = 1 << 14,
+	ITEMFLAG_GROUND = 1 << 15,
+	ITEMFLAG_SPLASH = 1 << 16,
+	ITEMFLAG_MAGICFIELD = 1 << 17,
+	ITEMFLAG_BED = 1 << 18,
+};
+
+//the item type properties that tile and item checks read all the time, kept apart from
+//the names and abilities of ItemType so that walking a tile stack stays within a few cache lines
+struct PackedItemType {
+	bool hasFlag(ItemTypeFlags_t flag) const {
+		return (flags & flag) != 0;
+	}
+
+	uint32_t flags = 0;
+	uint8_t alwaysOnTopOrder = 0;
+	uint8_t floorChange = 0;
+};
+
 class ItemType
 {
 	public:
@@ -407,6 +441,14 @@ class Items
 		ItemType& getItemType(size_t id);
 		const ItemType& getItemIdByClientId(uint16_t spriteId) const;
 
+		const PackedItemType& getPackedType(size_t id) const {
+			if (id < packedTypes.size()) {
+				return packedTypes[id];
+			}
+			//the table is empty until the items are loaded, or after a reload failed before packing them
+			return emptyPackedType;
+		}
+
 		uint16_t getItemIdByName(const std::string& name);
 
 		uint32_t majorVersion = 0;
@@ -421,7 +463,12 @@ class Items
 		}
 
 	private:
+		void packItemTypes();
+
+		static const PackedItemType emptyPackedType;
+
 		std::vector<uint16_t> reverseItemMap;
 		std::vector<ItemType> items;
+		std::vector<PackedItemType> packedTypes;
 };
 #endif
@@ -39,6 +39,7 @@
 #include "globalevent.h"
 #include "script.h"
 #include "weapons.h"
+#include "decay.h"
 
 extern Chat* g_chat;
 extern Game g_game;
@@ -1066,7 +1067,7 @@ void LuaScriptInterface::registerFunctions()
 	//saveServer()
 	lua_register(luaState, "saveServer", LuaScriptInterface::luaSaveServer);
 
-	//cleanMap()
+	//cleanMap([background = false])
 	lua_register(luaState, "cleanMap", LuaScriptInterface::luaCleanMap);
 
 	//debugPrint(text)
@@ -1959,6 +1960,15 @@ void LuaScriptInterface::registerFunctions()
 	registerEnumIn("configKeys", ConfigManager::CONVERT_UNSAFE_SCRIPTS)
 	registerEnumIn("configKeys", ConfigManager::CLASSIC_EQUIPMENT_SLOTS)
 	registerEnumIn("configKeys", ConfigManager::CLASSIC_ATTACK_SPEED)
+	registerEnumIn("configKeys", ConfigManager::PARALLEL_CREATURE_THINK)
+	registerEnumIn("configKeys", ConfigManager::HIERARCHICAL_PATHFINDING)
+	registerEnumIn("configKeys", ConfigManager::JUMP_POINT_SEARCH)
+	registerEnumIn("configKeys", ConfigManager::ASYNC_PATHFINDING)
+	registerEnumIn("configKeys", ConfigManager::SHARED_FLOW_FIELDS)
+	registerEnumIn("configKeys", ConfigManager::PARALLEL_MAP_LOADING)
+	registerEnumIn("configKeys", ConfigManager::MAP_CHECKSUM)
+	registerEnumIn("configKeys", ConfigManager::MAP_CACHE)
+	registerEnumIn("configKeys", ConfigManager::MAP_CACHE_VERIFY)
 
 	registerEnumIn("configKeys", ConfigManager::MAP_NAME)
 	registerEnumIn("configKeys", ConfigManager::HOUSE_RENT_PERIOD)
@@ -2012,6 +2022,10 @@ void LuaScriptInterface::registerFunctions()
 	registerEnumIn("configKeys", ConfigManager::MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER)
 	registerEnumIn("configKeys", ConfigManager::EXP_FROM_PLAYERS_LEVEL_RANGE)
 	registerEnumIn("configKeys", ConfigManager::MAX_PACKETS_PER_SECOND)
+	registerEnumIn("configKeys", ConfigManager::DISPATCHER_TASK_BUDGET)
+	registerEnumIn("configKeys", ConfigManager::DISPATCHER_STATS_INTERVAL)
+	registerEnumIn("configKeys", ConfigManager::WORKER_THREADS)
+	registerEnumIn("configKeys", ConfigManager::ACTIVITY_ZONE_RADIUS)
 	#if GAME_FEATURE_STORE > 0
 	registerEnumIn("configKeys", ConfigManager::STORE_COIN_PACKAGES)
 	#endif
@@ -2065,6 +2079,19 @@ void LuaScriptInterface::registerFunctions()
 	registerMethod("Game", "startRaid", LuaScriptInterface::luaGameStartRaid);
 
 	registerMethod("Game", "getClientVersion", LuaScriptInterface::luaGameGetClientVersion);
+	registerMethod("Game", "getTaskHeapFallbacks", LuaScriptInterface::luaGameGetTaskHeapFallbacks);
+	registerMethod("Game", "getDispatcherStats", LuaScriptInterface::luaGameGetDispatcherStats);
+	registerMethod("Game", "resetDispatcherStats", LuaScriptInterface::luaGameResetDispatcherStats);
+	registerMethod("Game", "getDispatcherLanes", LuaScriptInterface::luaGameGetDispatcherLanes);
+	registerMethod("Game", "getSpectatorCacheStats", LuaScriptInterface::luaGameGetSpectatorCacheStats);
+	registerMethod("Game", "resetSpectatorCacheStats", LuaScriptInterface::luaGameResetSpectatorCacheStats);
+	registerMethod("Game", "getFlowFieldStats", LuaScriptInterface::luaGameGetFlowFieldStats);
+	registerMethod("Game", "resetFlowFieldStats", LuaScriptInterface::luaGameResetFlowFieldStats);
+	registerMethod("Game", "getItemAllocatorStats", LuaScriptInterface::luaGameGetItemAllocatorStats);
+	registerMethod("Game", "getDecayStats", LuaScriptInterface::luaGameGetDecayStats);
+	registerMethod("Game", "resetDecayStats", LuaScriptInterface::luaGameResetDecayStats);
+	registerMethod("Game", "getDescriptionCacheStats", LuaScriptInterface::luaGameGetDescriptionCacheStats);
+	registerMethod("Game", "resetDescriptionCacheStats", LuaScriptInterface::luaGameResetDescriptionCacheStats);
 
 	registerMethod("Game", "reload", LuaScriptInterface::luaGameReload);
 
@@ -3940,7 +3967,7 @@ int LuaScriptInterface::luaAddEvent(lua_State* L)
 
 	auto& lastTimerEventId = g_luaEnvironment.lastEventTimerId;
 	eventDesc.eventId = g_scheduler.addEvent(createSchedulerTask(
-		delay, std::bind(&LuaEnvironment::executeTimerEvent, &g_luaEnvironment, lastTimerEventId)
+		delay, std::bind(&LuaEnvironment::executeTimerEvent, &g_luaEnvironment, lastTimerEventId), makeTaskTag(TASK_KIND_LUA)
 	));
 
 	g_luaEnvironment.timerEvents.emplace(lastTimerEventId, std::move(eventDesc));
@@ -3990,7 +4017,12 @@ int LuaScriptInterface::luaSaveServer(lua_State* L)
 
 int LuaScriptInterface::luaCleanMap(lua_State* L)
 {
-	lua_pushnumber(L, g_game.map.clean());
+	//cleanMap([background = false])
+	if (getBoolean(L, 1, false)) {
+		pushBoolean(L, g_game.startMapClean());
+	} else {
+		lua_pushnumber(L, g_game.map.clean());
+	}
 	return 1;
 }
 
@@ -4865,6 +4897,182 @@ int LuaScriptInterface::luaGameGetClientVersion(lua_State* L)
 	return 1;
 }
 
+int LuaScriptInterface::luaGameGetTaskHeapFallbacks(lua_State* L)
+{
+	// Game.getTaskHeapFallbacks()
+	const auto sites = TaskFunction::getHeapFallbackSites();
+	lua_createtable(L, 0, 2);
+	setField(L, "total", TaskFunction::getHeapFallbacks());
+
+	lua_createtable(L, 0, sites.size());
+	for (const auto& it : sites) {
+		setField(L, it.first.c_str(), it.second);
+	}
+	lua_setfield(L, -2, "sites");
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetDispatcherStats(lua_State* L)
+{
+	// Game.getDispatcherStats()
+	const DispatcherStats& stats = g_dispatcher.getStats();
+	lua_newtable(L);
+
+	int index = 0;
+	for (uint32_t tag = 0; tag < DispatcherStats::TAG_COUNT; ++tag) {
+		const TaskTagStatistics* statistics = stats.getTagStatistics(tag);
+		if (!statistics || statistics->execution.getCount() == 0) {
+			continue;
+		}
+
+		lua_createtable(L, 0, 11);
+		setField(L, "tag", tag);
+		setField(L, "name", getTaskTagName(tag));
+		setField(L, "count", statistics->execution.getCount());
+		setField(L, "executionTotal", statistics->execution.getTotal());
+		setField(L, "executionP50", statistics->execution.getPercentile(50));
+		setField(L, "executionP99", statistics->execution.getPercentile(99));
+		setField(L, "executionMax", statistics->execution.getMax());
+		setField(L, "waitP50", statistics->wait.getPercentile(50));
+		setField(L, "waitP99", statistics->wait.getPercentile(99));
+		setField(L, "waitMax", statistics->wait.getMax());
+		setField(L, "overBudget", statistics->overBudget.load(std::memory_order_relaxed));
+		lua_rawseti(L, -2, ++index);
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameResetDispatcherStats(lua_State* L)
+{
+	// Game.resetDispatcherStats()
+	g_dispatcher.getStats().reset();
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetDispatcherLanes(lua_State* L)
+{
+	// Game.getDispatcherLanes()
+	lua_createtable(L, 0, DISPATCHER_LANE_LAST);
+	for (uint8_t lane = DISPATCHER_LANE_INPUT; lane < DISPATCHER_LANE_LAST; ++lane) {
+		const DispatcherLaneStats& laneStats = g_dispatcher.getLaneStats(static_cast<DispatcherLane_t>(lane));
+		lua_createtable(L, 0, 4);
+		setField(L, "depth", laneStats.depth.load(std::memory_order_relaxed));
+		setField(L, "maxDepth", laneStats.maxDepth.load(std::memory_order_relaxed));
+		setField(L, "executed", laneStats.executed.load(std::memory_order_relaxed));
+		setField(L, "expired", laneStats.expired.load(std::memory_order_relaxed));
+		lua_setfield(L, -2, getDispatcherLaneName(static_cast<DispatcherLane_t>(lane)));
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetSpectatorCacheStats(lua_State* L)
+{
+	// Game.getSpectatorCacheStats()
+	lua_createtable(L, 0, 3);
+	for (bool players : {false, true}) {
+		const SpectatorCacheStats& stats = g_game.map.getSpectatorCacheStats(players);
+		lua_createtable(L, 0, 3);
+		setField(L, "hits", stats.hits);
+		setField(L, "misses", stats.misses);
+		setField(L, "stale", stats.stale);
+		lua_setfield(L, -2, players ? "players" : "creatures");
+	}
+	setField(L, "scansAvoided", g_game.map.getSpectatorScansAvoided());
+	return 1;
+}
+
+int LuaScriptInterface::luaGameResetSpectatorCacheStats(lua_State* L)
+{
+	// Game.resetSpectatorCacheStats()
+	g_game.map.resetSpectatorCacheStats();
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetFlowFieldStats(lua_State* L)
+{
+	// Game.getFlowFieldStats()
+	const FlowFieldStats& stats = g_game.map.getFlowFieldStats();
+	lua_createtable(L, 0, 4);
+	setField(L, "requests", stats.requests);
+	setField(L, "served", stats.served);
+	setField(L, "built", stats.built);
+	setField(L, "evicted", stats.evicted);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameResetFlowFieldStats(lua_State* L)
+{
+	// Game.resetFlowFieldStats()
+	g_game.map.resetFlowFieldStats();
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetItemAllocatorStats(lua_State* L)
+{
+	// Game.getItemAllocatorStats()
+	lua_newtable(L);
+	#if GAME_FEATURE_ITEM_SLAB_ALLOCATOR > 0
+	int index = 0;
+	for (const ItemSizeClassStats& stats : ItemAllocator::getStats()) {
+		lua_createtable(L, 0, 6);
+		setField(L, "objectSize", stats.objectSize);
+		setField(L, "live", stats.live);
+		setField(L, "capacity", stats.capacity);
+		setField(L, "slabs", stats.slabs);
+		setField(L, "bytes", stats.slabs * ItemAllocator::SLAB_SIZE);
+		setField(L, "allocations", stats.allocations);
+		lua_rawseti(L, -2, ++index);
+	}
+	#endif
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetDecayStats(lua_State* L)
+{
+	// Game.getDecayStats()
+	const DecayStats& stats = g_decay.getStats();
+	lua_createtable(L, 0, 5);
+	setField(L, "active", g_decay.getActiveCount());
+	setField(L, "ticks", stats.ticks);
+	setField(L, "expired", stats.expired);
+	setField(L, "processingTotal", stats.processingTotal);
+	setField(L, "processingMax", stats.processingMax);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameResetDecayStats(lua_State* L)
+{
+	// Game.resetDecayStats()
+	g_decay.resetStats();
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetDescriptionCacheStats(lua_State* L)
+{
+	// Game.getDescriptionCacheStats()
+	const DescriptionCacheStats& stats = Item::getDescriptionCacheStats();
+	lua_createtable(L, 0, 5);
+	setField(L, "hits", stats.hits);
+	setField(L, "misses", stats.misses);
+	setField(L, "uncached", stats.uncached);
+	setField(L, "buildTime", stats.buildTime);
+	//the hits are estimated to have cost as much as the average miss
+	setField(L, "timeSaved", stats.misses != 0 ? stats.buildTime * stats.hits / stats.misses : 0);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameResetDescriptionCacheStats(lua_State* L)
+{
+	// Game.resetDescriptionCacheStats()
+	Item::resetDescriptionCacheStats();
+	pushBoolean(L, true);
+	return 1;
+}
+
 int LuaScriptInterface::luaGameReload(lua_State* L)
 {
 	// Game.reload(reloadType)
@@ -563,6 +563,19 @@ class LuaScriptInterface
 		static int luaGameStartRaid(lua_State* L);
 
 		static int luaGameGetClientVersion(lua_State* L);
+		static int luaGameGetTaskHeapFallbacks(lua_State* L);
+		static int luaGameGetDispatcherStats(lua_State* L);
+		static int luaGameResetDispatcherStats(lua_State* L);
+		static int luaGameGetDispatcherLanes(lua_State* L);
+		static int luaGameGetSpectatorCacheStats(lua_State* L);
+		static int luaGameResetSpectatorCacheStats(lua_State* L);
+		static int luaGameGetFlowFieldStats(lua_State* L);
+		static int luaGameResetFlowFieldStats(lua_State* L);
+		static int luaGameGetItemAllocatorStats(lua_State* L);
+		static int luaGameGetDecayStats(lua_State* L);
+		static int luaGameResetDecayStats(lua_State* L);
+		static int luaGameGetDescriptionCacheStats(lua_State* L);
+		static int luaGameResetDescriptionCacheStats(lua_State* L);
 
 		static int luaGameReload(lua_State* L);
 
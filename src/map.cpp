@@ -25,8 +25,31 @@
 #include "creature.h"
 #include "monster.h"
 #include "game.h"
+#include "configmanager.h"
+#include "pathservice.h"
 
 extern Game g_game;
+extern ConfigManager g_config;
+
+namespace {
+
+struct SightCacheEntry {
+	uint64_t key = 0;
+	uint32_t version = 0;
+	uint8_t z = MAP_MAX_LAYERS;
+	bool clear = false;
+};
+
+constexpr uint32_t SIGHT_CACHE_BITS = 12;
+
+//path searches on the worker threads check the sight too, so every thread keeps its own entries,
+//the versions they are validated against only change while the workers are idle
+thread_local SightCacheEntry sightCache[1 << SIGHT_CACHE_BITS];
+
+//nodes taken off the open list by the path searches of this thread
+thread_local uint64_t expandedPathNodes = 0;
+
+}
 
 bool Map::loadMap(const std::string& identifier, bool loadHouses)
 {
@@ -75,6 +98,27 @@ bool Map::save()
 	return saved;
 }
 
+#if GAME_FEATURE_FLAT_SECTOR_GRID > 0
+MapSector* Map::createMapSector(uint32_t x, uint32_t y)
+{
+	bool created = false;
+	MapSector* sector = mapSectors.create(x / SECTOR_SIZE, y / SECTOR_SIZE, created);
+	if (created) {
+		MapSector::newSector = true;
+	}
+	return sector;
+}
+
+MapSector* Map::getMapSector(uint32_t x, uint32_t y)
+{
+	return mapSectors.find(x / SECTOR_SIZE, y / SECTOR_SIZE);
+}
+
+const MapSector* Map::getMapSector(uint32_t x, uint32_t y) const
+{
+	return mapSectors.find(x / SECTOR_SIZE, y / SECTOR_SIZE);
+}
+#else
 MapSector* Map::createMapSector(uint32_t x, uint32_t y)
 {
 	uint32_t index = (x / SECTOR_SIZE) | ((y / SECTOR_SIZE) << 16);
@@ -104,6 +148,7 @@ const MapSector* Map::getMapSector(uint32_t x, uint32_t y) const
 	}
 	return nullptr;
 }
+#endif
 
 Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
 {
@@ -130,6 +175,9 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 	MapSector* sector = createMapSector(x, y);
 
 	if (MapSector::newSector) {
+		//cached spectators never looked at this sector
+		++sectorEpoch;
+
 		//update north sector
 		MapSector* northSector = getMapSector(x, y - SECTOR_SIZE);
 		if (northSector) {
@@ -174,7 +222,86 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 		delete newTile;
 	} else {
 		tile = newTile;
+		updateWalkability(*newTile);
+		updateSightBlock(*newTile);
+	}
+}
+
+void Map::updateWalkability(const Tile& tile)
+{
+	const Position& pos = tile.getPosition();
+	pathGraph.invalidate(pos);
+
+	MapSector* sector = getMapSector(pos.x, pos.y);
+	if (sector) {
+		sector->walkVersion = ++walkVersion;
+	}
+
+	if (g_pathService.isRunning()) {
+		g_pathService.updateTile(tile, walkVersion);
+	}
+}
+
+void Map::updateFields(const Tile& tile)
+{
+	//fields only change what a step costs, paths through the tile stay valid
+	if (g_pathService.isRunning()) {
+		g_pathService.updateTile(tile, walkVersion);
+	}
+}
+
+void Map::updateSightBlock(const Tile& tile)
+{
+	const Position& pos = tile.getPosition();
+	MapSector* sector = getMapSector(pos.x, pos.y);
+	if (!sector || pos.z >= MAP_MAX_LAYERS) {
+		return;
+	}
+
+	uint16_t& row = sector->projectileBlock[pos.z][pos.y & SECTOR_MASK];
+	const uint16_t bit = 1 << (pos.x & SECTOR_MASK);
+	const uint16_t newRow = (tile.hasFlag(TILESTATE_BLOCKPROJECTILE) ? (row | bit) : (row & ~bit));
+	if (newRow != row) {
+		row = newRow;
+		sector->sightVersion = ++sightVersion;
+	}
+}
+
+bool Map::blocksProjectile(uint16_t x, uint16_t y, uint8_t z) const
+{
+	if (z >= MAP_MAX_LAYERS) {
+		return false;
+	}
+
+	const MapSector* sector = getMapSector(x, y);
+	return sector && (sector->projectileBlock[z][y & SECTOR_MASK] & (1 << (x & SECTOR_MASK))) != 0;
+}
+
+bool Map::isSightCacheValid(const Position& fromPos, const Position& toPos, uint32_t version) const
+{
+	if (version == sightVersion) {
+		return true;
+	}
+
+	const uint32_t minX = std::min(fromPos.x, toPos.x) & ~SECTOR_MASK;
+	const uint32_t maxX = std::max(fromPos.x, toPos.x);
+	const uint32_t minY = std::min(fromPos.y, toPos.y) & ~SECTOR_MASK;
+	const uint32_t maxY = std::max(fromPos.y, toPos.y);
+	for (uint32_t y = minY; y <= maxY; y += SECTOR_SIZE) {
+		for (uint32_t x = minX; x <= maxX; x += SECTOR_SIZE) {
+			const MapSector* sector = getMapSector(x, y);
+			if (sector && sector->sightVersion > version) {
+				return false;
+			}
+		}
 	}
+	return true;
+}
+
+uint32_t Map::getWalkVersion(const Position& pos) const
+{
+	const MapSector* sector = getMapSector(pos.x, pos.y);
+	return sector ? sector->walkVersion : 0;
 }
 
 bool Map::placeCreature(const Position& centerPos, Creature* creature, bool extendedPos/* = false*/, bool forceLogin/* = false*/)
@@ -245,7 +372,8 @@ bool Map::placeCreature(const Position& centerPos, Creature* creature, bool exte
 	toCylinder->internalAddThing(creature);
 
 	const Position& dest = toCylinder->getPosition();
-	getMapSector(dest.x, dest.y)->addCreature(creature);
+	getMapSector(dest.x, dest.y)->addCreature(creature, dest);
+	addObservers(creature, dest);
 	return true;
 }
 
@@ -303,8 +431,12 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 
 	// Switch the node ownership
 	if (old_sector != new_sector) {
+		removeObservers(&creature, oldPos);
 		old_sector->removeCreature(&creature);
-		new_sector->addCreature(&creature);
+		new_sector->addCreature(&creature, newPos);
+		addObservers(&creature, newPos);
+	} else {
+		old_sector->moveCreature(&creature, newPos);
 	}
 
 	//add the creature
@@ -396,7 +528,7 @@ std::vector<Tile*> Map::getFloorTiles(int32_t x, int32_t y, int32_t width, int32
 	return tileVector;
 }
 
-void Map::getSpectatorsInternal(SpectatorVector& spectators, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const
+void Map::getSpectatorsInternal(SpectatorVector& spectators, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers, SpectatorCache::Entry* cacheEntry/* = nullptr*/) const
 {
 	int32_t min_y = centerPos.y - minRangeY;
 	int32_t min_x = centerPos.x - minRangeX;
@@ -407,6 +539,10 @@ void Map::getSpectatorsInternal(SpectatorVector& spectators, const Position& cen
 	uint32_t height = static_cast<uint32_t>(max_y - min_y);
 	uint32_t depth = static_cast<uint32_t>(maxRangeZ - minRangeZ);
 
+	//x - (centerPos.z - z) - min_x folded into x + z - bias
+	int32_t biasX = centerPos.getZ() + min_x;
+	int32_t biasY = centerPos.getZ() + min_y;
+
 	int32_t minoffset = centerPos.getZ() - maxRangeZ;
 	int32_t x1 = std::min<int32_t>(0xFFFF, std::max<int32_t>(0, (min_x + minoffset)));
 	int32_t y1 = std::min<int32_t>(0xFFFF, std::max<int32_t>(0, (min_y + minoffset)));
@@ -427,18 +563,12 @@ void Map::getSpectatorsInternal(SpectatorVector& spectators, const Position& cen
 		sectorE = sectorS;
 		for (int32_t nx = startx1; nx <= endx2; nx += SECTOR_SIZE) {
 			if (sectorE) {
-				const CreatureVector& node_list = (onlyPlayers ? sectorE->player_list : sectorE->creature_list);
-				for (auto it = node_list.begin(), end = node_list.end(); it != end; ++it) {
-					Creature* creature = (*it);
-
-					const Position& cpos = creature->getPosition();
-					if (static_cast<uint32_t>(static_cast<int32_t>(cpos.z) - minRangeZ) <= depth) {
-						int_fast16_t offsetZ = Position::getOffsetZ(centerPos, cpos);
-						if (static_cast<uint32_t>(static_cast<int32_t>(cpos.x - offsetZ) - min_x) <= width && static_cast<uint32_t>(static_cast<int32_t>(cpos.y - offsetZ) - min_y) <= height) {
-							spectators.push_back(creature);
-						}
-					}
+				if (cacheEntry) {
+					cacheEntry->addSector(sectorE, onlyPlayers ? sectorE->playerVersion : sectorE->creatureVersion);
 				}
+
+				const SectorCreatureList& node_list = (onlyPlayers ? sectorE->player_list : sectorE->creature_list);
+				node_list.getSpectators(spectators, biasX, biasY, minRangeZ, width, height, depth);
 				sectorE = sectorE->sectorE;
 			} else {
 				sectorE = getMapSector(nx + SECTOR_SIZE, ny);
@@ -460,7 +590,7 @@ void Map::getSpectators(SpectatorVector& spectators, const Position& centerPos,
 	}
 
 	bool foundCache = false;
-	bool cacheResult = false;
+	SpectatorCache::Entry* cacheEntry = nullptr;
 
 	minRangeX = (minRangeX == 0 ? maxViewportX : minRangeX);
 	maxRangeX = (maxRangeX == 0 ? maxViewportX : maxRangeX);
@@ -468,31 +598,36 @@ void Map::getSpectators(SpectatorVector& spectators, const Position& centerPos,
 	maxRangeY = (maxRangeY == 0 ? maxViewportY : maxRangeY);
 	if (minRangeX == maxViewportX && maxRangeX == maxViewportX && minRangeY == maxViewportY && maxRangeY == maxViewportY && multifloor) {
 		if (onlyPlayers) {
-			auto it = playersSpectatorCache.find(centerPos);
-			if (it != playersSpectatorCache.end()) {
+			SpectatorCache::Entry* entry = playersSpectatorCache.find(centerPos);
+			if (entry && isSpectatorCacheValid(*entry, true)) {
 				if (!spectators.empty()) {
-					const SpectatorVector& cachedSpectators = it->second;
+					const SpectatorVector& cachedSpectators = entry->spectators;
 					spectators.insert(spectators.end(), cachedSpectators.begin(), cachedSpectators.end());
 				} else {
-					spectators = it->second;
+					spectators = entry->spectators;
 				}
 
+				++playersSpectatorCache.getStats().hits;
 				foundCache = true;
+			} else if (entry) {
+				++playersSpectatorCache.getStats().stale;
+			} else {
+				++playersSpectatorCache.getStats().misses;
 			}
 		}
 
 		if (!foundCache) {
-			auto it = spectatorCache.find(centerPos);
-			if (it != spectatorCache.end()) {
+			SpectatorCache::Entry* entry = spectatorCache.find(centerPos);
+			if (entry && isSpectatorCacheValid(*entry, false)) {
 				if (!onlyPlayers) {
 					if (!spectators.empty()) {
-						const SpectatorVector& cachedSpectators = it->second;
+						const SpectatorVector& cachedSpectators = entry->spectators;
 						spectators.insert(spectators.end(), cachedSpectators.begin(), cachedSpectators.end());
 					} else {
-						spectators = it->second;
+						spectators = entry->spectators;
 					}
 				} else {
-					const SpectatorVector& cachedSpectators = it->second;
+					const SpectatorVector& cachedSpectators = entry->spectators;
 					for (Creature* spectator : cachedSpectators) {
 						if (spectator->getPlayer()) {
 							spectators.emplace_back(spectator);
@@ -500,9 +635,18 @@ void Map::getSpectators(SpectatorVector& spectators, const Position& centerPos,
 					}
 				}
 
+				++spectatorCache.getStats().hits;
 				foundCache = true;
 			} else {
-				cacheResult = true;
+				if (entry) {
+					++spectatorCache.getStats().stale;
+				} else {
+					++spectatorCache.getStats().misses;
+				}
+
+				SpectatorCache& cache = (onlyPlayers ? playersSpectatorCache : spectatorCache);
+				cacheEntry = &cache.insert(centerPos);
+				cacheEntry->sectorEpoch = sectorEpoch;
 			}
 		}
 	}
@@ -510,48 +654,206 @@ void Map::getSpectators(SpectatorVector& spectators, const Position& centerPos,
 	if (!foundCache) {
 		int32_t minRangeZ;
 		int32_t maxRangeZ;
-		if (multifloor) {
-			if (centerPos.z > 7) {
-				//underground
-
-				//8->15
-				minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
-				maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
-			} else if (centerPos.z == 6) {
-				minRangeZ = 0;
-				maxRangeZ = 8;
-			} else if (centerPos.z == 7) {
-				minRangeZ = 0;
-				maxRangeZ = 9;
-			} else {
-				minRangeZ = 0;
-				maxRangeZ = 7;
-			}
-		} else {
-			minRangeZ = centerPos.z;
-			maxRangeZ = centerPos.z;
-		}
+		getSpectatorFloorRange(centerPos, multifloor, minRangeZ, maxRangeZ);
 		if (spectators.capacity() < 32) {
 			spectators.reserve(32);
 		}
 
-		getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
-		if (cacheResult) {
-			if (onlyPlayers) {
-				playersSpectatorCache[centerPos] = spectators;
-			} else {
-				spectatorCache[centerPos] = spectators;
+		size_t first = spectators.size();
+		getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers, cacheEntry);
+		if (cacheEntry) {
+			cacheEntry->spectators.assign(spectators.begin() + first, spectators.end());
+		}
+	}
+}
+
+void Map::getSpectatorFloorRange(const Position& centerPos, bool multifloor, int32_t& minRangeZ, int32_t& maxRangeZ)
+{
+	if (multifloor) {
+		if (centerPos.z > 7) {
+			//underground
+
+			//8->15
+			minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
+			maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
+		} else if (centerPos.z == 6) {
+			minRangeZ = 0;
+			maxRangeZ = 8;
+		} else if (centerPos.z == 7) {
+			minRangeZ = 0;
+			maxRangeZ = 9;
+		} else {
+			minRangeZ = 0;
+			maxRangeZ = 7;
+		}
+	} else {
+		minRangeZ = centerPos.z;
+		maxRangeZ = centerPos.z;
+	}
+}
+
+bool Map::isInSpectatorRange(const Position& centerPos, const Position& pos, bool multifloor)
+{
+	if (centerPos.z >= MAP_MAX_LAYERS) {
+		return false;
+	}
+
+	int32_t minRangeZ;
+	int32_t maxRangeZ;
+	getSpectatorFloorRange(centerPos, multifloor, minRangeZ, maxRangeZ);
+
+	//same test as getSpectatorsInternal with the default viewport
+	int32_t offsetZ = centerPos.getZ() - pos.getZ();
+	return static_cast<uint32_t>(pos.getZ() - minRangeZ) <= static_cast<uint32_t>(maxRangeZ - minRangeZ) &&
+	       static_cast<uint32_t>(pos.getX() - offsetZ - (centerPos.getX() - maxViewportX)) <= static_cast<uint32_t>(maxViewportX * 2) &&
+	       static_cast<uint32_t>(pos.getY() - offsetZ - (centerPos.getY() - maxViewportY)) <= static_cast<uint32_t>(maxViewportY * 2);
+}
+
+void Map::getObservers(SpectatorVector& spectators, const Creature* creature, bool multifloor/* = false*/)
+{
+	if (creature->isRemoved()) {
+		getSpectators(spectators, creature->getPosition(), multifloor, true);
+		return;
+	}
+
+	const Position& centerPos = creature->getPosition();
+	for (Player* player : creature->getObservers()) {
+		if (isInSpectatorRange(centerPos, player->getPosition(), multifloor)) {
+			spectators.emplace_back(player);
+		}
+	}
+	++spectatorScansAvoided;
+}
+
+template <typename F>
+void Map::forEachObserverSector(const Position& pos, F&& f)
+{
+	int32_t startx = std::max<int32_t>(0, pos.x - observerSectorRange * SECTOR_SIZE) & ~SECTOR_MASK;
+	int32_t starty = std::max<int32_t>(0, pos.y - observerSectorRange * SECTOR_SIZE) & ~SECTOR_MASK;
+	int32_t endx = std::min<int32_t>(0xFFFF, pos.x + observerSectorRange * SECTOR_SIZE);
+	int32_t endy = std::min<int32_t>(0xFFFF, pos.y + observerSectorRange * SECTOR_SIZE);
+	for (int32_t ny = starty; ny <= endy; ny += SECTOR_SIZE) {
+		for (int32_t nx = startx; nx <= endx; nx += SECTOR_SIZE) {
+			if (MapSector* sector = getMapSector(nx, ny)) {
+				f(*sector);
 			}
 		}
 	}
 }
 
-void Map::clearSpectatorCache(bool clearPlayer)
+void Map::addObservers(Creature* creature, const Position& pos)
+{
+	//observing is symmetric on sector distance, so a player also becomes an observer of everything around it
+	Player* player = creature->getPlayer();
+	creature->observers.clear();
+	forEachObserverSector(pos, [&](MapSector& sector) {
+		for (Creature* observer : sector.player_list) {
+			creature->observers.push_back(observer->getPlayer());
+		}
+
+		if (player) {
+			for (Creature* other : sector.creature_list) {
+				if (other != creature) {
+					other->observers.push_back(player);
+				}
+			}
+		}
+	});
+}
+
+void Map::removeObservers(Creature* creature, const Position& pos)
+{
+	creature->observers.clear();
+
+	Player* player = creature->getPlayer();
+	if (!player) {
+		return;
+	}
+
+	forEachObserverSector(pos, [&](MapSector& sector) {
+		for (Creature* other : sector.creature_list) {
+			if (other == creature) {
+				continue;
+			}
+
+			std::vector<Player*>& observers = other->observers;
+			auto it = std::find(observers.begin(), observers.end(), player);
+			if (it != observers.end()) {
+				*it = observers.back();
+				observers.pop_back();
+			}
+		}
+	});
+}
+
+bool Map::isSpectatorCacheValid(const SpectatorCache::Entry& entry, bool players) const
+{
+	if (entry.sectorEpoch != sectorEpoch || entry.sectorCount > SpectatorCache::MAX_SECTORS) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < entry.sectorCount; ++i) {
+		const MapSector* sector = entry.sectors[i];
+		if ((players ? sector->playerVersion : sector->creatureVersion) != entry.versions[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Map::clearSpectatorCache(const Position& pos, bool clearPlayer)
+{
+	MapSector* sector = getMapSector(pos.x, pos.y);
+	if (sector) {
+		++sector->creatureVersion;
+		if (clearPlayer) {
+			++sector->playerVersion;
+		}
+	}
+}
+
+void Map::resetSpectatorCacheStats()
+{
+	spectatorCache.getStats() = SpectatorCacheStats();
+	playersSpectatorCache.getStats() = SpectatorCacheStats();
+	spectatorScansAvoided = 0;
+}
+
+// SpectatorCache
+SpectatorCache::Entry* SpectatorCache::find(const Position& pos)
+{
+	uint64_t key = getKey(pos);
+	size_t slot = getSlot(key);
+	for (size_t probe = 0; probe < MAX_PROBES; ++probe) {
+		Entry& entry = entries[(slot + probe) & (CAPACITY - 1)];
+		if (entry.key == key) {
+			return &entry;
+		} else if (entry.key == 0) {
+			break;
+		}
+	}
+	return nullptr;
+}
+
+SpectatorCache::Entry& SpectatorCache::insert(const Position& pos)
 {
-	spectatorCache.clear();
-	if (clearPlayer) {
-		playersSpectatorCache.clear();
+	uint64_t key = getKey(pos);
+	size_t slot = getSlot(key);
+
+	//a full probe window evicts the home slot, entries are never emptied again so probing stays intact
+	Entry* entry = &entries[slot];
+	for (size_t probe = 0; probe < MAX_PROBES; ++probe) {
+		Entry& candidate = entries[(slot + probe) & (CAPACITY - 1)];
+		if (candidate.key == key || candidate.key == 0) {
+			entry = &candidate;
+			break;
+		}
 	}
+
+	entry->key = key;
+	entry->sectorCount = 0;
+	entry->spectators.clear();
+	return *entry;
 }
 
 bool Map::canThrowObjectTo(const Position& fromPos, const Position& toPos, bool checkLineOfSight /*= true*/,
@@ -602,8 +904,7 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 		while (--distanceX) {
 			start.x += delta;
 
-			const Tile* tile = getTile(start.x, start.y, start.z);
-			if (tile && tile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+			if (blocksProjectile(start.x, start.y, start.z)) {
 				return false;
 			}
 		}
@@ -613,8 +914,7 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 		while (--distanceY){
 			start.y += delta;
 
-			const Tile* tile = getTile(start.x, start.y, start.z);
-			if (tile && tile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+			if (blocksProjectile(start.x, start.y, start.z)) {
 				return false;
 			}
 		}
@@ -626,8 +926,7 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 			start.x += deltaX;
 			start.y += deltaY;
 
-			const Tile* tile = getTile(start.x, start.y, start.z);
-			if (tile && tile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+			if (blocksProjectile(start.x, start.y, start.z)) {
 				return false;
 			}
 		}
@@ -649,8 +948,7 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 					xIncrease = deltaX;
 				}
 
-				const Tile* tile = getTile(start.x + xIncrease, start.y + deltaY, start.z);
-				if (tile && tile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+				if (blocksProjectile(start.x + xIncrease, start.y + deltaY, start.z)) {
 					if (Position::areInRange<1, 1>(start, destination)) {
 						break;
 					} else {
@@ -671,8 +969,7 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 					yIncrease = deltaY;
 				}
 
-				const Tile* tile = getTile(start.x + deltaX, start.y + yIncrease, start.z);
-				if (tile && tile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+				if (blocksProjectile(start.x + deltaX, start.y + yIncrease, start.z)) {
 					if (Position::areInRange<1, 1>(start, destination)) {
 						break;
 					} else {
@@ -722,8 +1019,7 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 				yIncrease = y2Increase;
 			}
 
-			const Tile* tile = getTile(start.x + xIncrease, start.y + yIncrease, start.z);
-			if (tile && tile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+			if (blocksProjectile(start.x + xIncrease, start.y + yIncrease, start.z)) {
 				if (Position::areInRange<1, 1>(start, destination)) {
 					break;
 				} else {
@@ -758,8 +1054,7 @@ bool Map::isSightClear(const Position& fromPos, const Position& toPos, bool floo
 	}
 
 	// Perform checking destination first
-	const Tile* tile = getTile(toPos.x, toPos.y, (fromPos.z > toPos.z ? toPos.z : fromPos.z));
-	if (tile && tile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+	if (blocksProjectile(toPos.x, toPos.y, (fromPos.z > toPos.z ? toPos.z : fromPos.z))) {
 		return false;
 	} else {
 		// Check if we even need to perform line checking
@@ -768,8 +1063,24 @@ bool Map::isSightClear(const Position& fromPos, const Position& toPos, bool floo
 		}
 	}
 
+	// The jump between floors looks at more than the projectile blocking, only lines on one floor are cached
+	if (fromPos.z != toPos.z || Position::getDistanceX(fromPos, toPos) > SECTOR_SIZE || Position::getDistanceY(fromPos, toPos) > SECTOR_SIZE) {
+		return checkSightLine(fromPos, toPos) || checkSightLine(toPos, fromPos);
+	}
+
+	const uint64_t key = static_cast<uint64_t>(fromPos.x) | (static_cast<uint64_t>(fromPos.y) << 16) |
+	                     (static_cast<uint64_t>(toPos.x) << 32) | (static_cast<uint64_t>(toPos.y) << 48);
+	SightCacheEntry& entry = sightCache[(key * 0x9E3779B97F4A7C15ULL) >> (64 - SIGHT_CACHE_BITS)];
+	if (entry.key == key && entry.z == fromPos.z && isSightCacheValid(fromPos, toPos, entry.version)) {
+		return entry.clear;
+	}
+
 	// Cast two converging rays and see if either yields a result.
-	return checkSightLine(fromPos, toPos) || checkSightLine(toPos, fromPos);
+	entry.key = key;
+	entry.z = fromPos.z;
+	entry.version = sightVersion;
+	entry.clear = checkSightLine(fromPos, toPos) || checkSightLine(toPos, fromPos);
+	return entry.clear;
 }
 
 const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
@@ -789,6 +1100,60 @@ const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
 	return tile;
 }
 
+bool Map::isUniformTile(const Creature& creature, const Position& pos) const
+{
+	const Tile* tile = canWalkTo(creature, pos);
+	return tile && AStarNodes::getTileWalkCost(creature, tile) == 0;
+}
+
+int_fast32_t Map::getJumpLength(const Creature& creature, const Position& startPos, Position& pos, int_fast32_t fromX, int_fast32_t fromY,
+	const Position& targetPos, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
+{
+	const int_fast32_t stepX = pos.x - fromX;
+	const int_fast32_t stepY = pos.y - fromY;
+
+	Position jumpPos = pos;
+	int_fast32_t length = 0;
+	while (length < MAX_JUMP_LENGTH) {
+		if (fpp.maxSearchDist != 0 && (Position::getDistanceX(startPos, jumpPos) > fpp.maxSearchDist || Position::getDistanceY(startPos, jumpPos) > fpp.maxSearchDist)) {
+			break;
+		}
+
+		if (!isUniformTile(creature, jumpPos)) {
+			break;
+		}
+
+		++length;
+
+		//the path may have to turn here
+		if (jumpPos.x == targetPos.x || jumpPos.y == targetPos.y || pathCondition.isInRange(startPos, jumpPos, fpp)) {
+			break;
+		}
+
+		//anything next to the line can make a different path cheaper
+		if (!isUniformTile(creature, Position(jumpPos.x + stepY, jumpPos.y + stepX, jumpPos.z)) ||
+		        !isUniformTile(creature, Position(jumpPos.x - stepY, jumpPos.y - stepX, jumpPos.z))) {
+			break;
+		}
+
+		jumpPos.x += stepX;
+		jumpPos.y += stepY;
+	}
+
+	if (length <= 1) {
+		return 1;
+	}
+
+	pos.x = fromX + stepX * length;
+	pos.y = fromY + stepY * length;
+	return length;
+}
+
+uint64_t Map::getExpandedPathNodes()
+{
+	return expandedPathNodes;
+}
+
 bool Map::getPathMatching(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
 {
 	Position pos = creature.getPosition();
@@ -817,6 +1182,9 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
 	const int_fast32_t sX = std::abs(targetPos.getX() - pos.getX());
 	const int_fast32_t sY = std::abs(targetPos.getY() - pos.getY());
 
+	//fleeing searches filter every tile on their own, jumps would step over them
+	const bool jumpPoints = g_config.getBoolean(ConfigManager::JUMP_POINT_SEARCH) && !fpp.keepDistance;
+
 	AStarNode* found = nullptr;
 	while (fpp.maxSearchDist != 0 || nodes.getClosedNodes() < 100) {
 		AStarNode* n = nodes.getBestNode();
@@ -827,6 +1195,8 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
 			return false;
 		}
 
+		++expandedPathNodes;
+
 		const int_fast32_t x = n->x;
 		const int_fast32_t y = n->y;
 		pos.x = x;
@@ -842,8 +1212,9 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
 		uint_fast32_t dirCount;
 		int_fast32_t* neighbors;
 		if (n->parent) {
-			const int_fast32_t offset_x = n->parent->x - x;
-			const int_fast32_t offset_y = n->parent->y - y;
+			//jump points can be several tiles away from their parent
+			const int_fast32_t offset_x = (n->parent->x > x) - (n->parent->x < x);
+			const int_fast32_t offset_y = (n->parent->y > y) - (n->parent->y < y);
 			if (offset_y == 0) {
 				if (offset_x == -1) {
 					neighbors = *dirNeighbors[DIRECTION_WEST];
@@ -878,6 +1249,11 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
 			pos.x = x + *neighbors++;
 			pos.y = y + *neighbors++;
 
+			int_fast32_t jumpLength = 1;
+			if (jumpPoints && (pos.x == x || pos.y == y)) {
+				jumpLength = getJumpLength(creature, startPos, pos, x, y, targetPos, pathCondition, fpp);
+			}
+
 			const Tile* tile;
 			int_fast32_t extraCost;
 			AStarNode* neighborNode = nodes.getNodeByPosition(pos.x, pos.y);
@@ -893,7 +1269,7 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
 			}
 
 			//The cost (g) for this neighbor
-			const int_fast32_t cost = AStarNodes::getMapWalkCost(n, pos);
+			const int_fast32_t cost = (jumpLength > 1 ? jumpLength * MAP_NORMALWALKCOST : AStarNodes::getMapWalkCost(n, pos));
 			const int_fast32_t newf = f + cost + extraCost;
 			if (neighborNode) {
 				if (neighborNode->f <= newf) {
@@ -932,34 +1308,67 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
 		int_fast32_t dx = pos.getX() - prevx;
 		int_fast32_t dy = pos.getY() - prevy;
 
+		//jumps move in a straight line
+		const int_fast32_t steps = std::max<int_fast32_t>(std::abs(dx), std::abs(dy));
+		dx /= steps;
+		dy /= steps;
+
 		prevx = pos.x;
 		prevy = pos.y;
 		if (dx == 1) {
 			if (dy == 1) {
-				dirList.emplace_back(DIRECTION_NORTHWEST);
+				dirList.insert(dirList.end(), steps, DIRECTION_NORTHWEST);
 			} else if (dy == -1) {
-				dirList.emplace_back(DIRECTION_SOUTHWEST);
+				dirList.insert(dirList.end(), steps, DIRECTION_SOUTHWEST);
 			} else {
-				dirList.emplace_back(DIRECTION_WEST);
+				dirList.insert(dirList.end(), steps, DIRECTION_WEST);
 			}
 		} else if (dx == -1) {
 			if (dy == 1) {
-				dirList.emplace_back(DIRECTION_NORTHEAST);
+				dirList.insert(dirList.end(), steps, DIRECTION_NORTHEAST);
 			} else if (dy == -1) {
-				dirList.emplace_back(DIRECTION_SOUTHEAST);
+				dirList.insert(dirList.end(), steps, DIRECTION_SOUTHEAST);
 			} else {
-				dirList.emplace_back(DIRECTION_EAST);
+				dirList.insert(dirList.end(), steps, DIRECTION_EAST);
 			}
 		} else if (dy == 1) {
-			dirList.emplace_back(DIRECTION_NORTH);
+			dirList.insert(dirList.end(), steps, DIRECTION_NORTH);
 		} else if (dy == -1) {
-			dirList.emplace_back(DIRECTION_SOUTH);
+			dirList.insert(dirList.end(), steps, DIRECTION_SOUTH);
 		}
 		found = found->parent;
 	}
 	return true;
 }
 
+bool Map::getHierarchicalPath(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp, bool& partial)
+{
+	const Position& startPos = creature.getPosition();
+
+	Position waypoint;
+	if (!pathGraph.getNextWaypoint(startPos, targetPos, waypoint)) {
+		return false;
+	}
+
+	//the leg never leaves the start cluster by more than a tile, so bound the search to it
+	//instead of the closed nodes limit the regular search gave up on
+	partial = waypoint != targetPos;
+	if (!partial) {
+		FindPathParams legFpp = fpp;
+		legFpp.maxSearchDist = PathGraph::CLUSTER_SIZE;
+		return getPathMatchingCond(creature, targetPos, dirList, FrozenPathingConditionCall(targetPos), legFpp);
+	}
+
+	FindPathParams legFpp;
+	legFpp.fullPathSearch = true;
+	legFpp.clearSight = false;
+	legFpp.allowDiagonal = fpp.allowDiagonal;
+	legFpp.maxSearchDist = PathGraph::CLUSTER_SIZE;
+	legFpp.minTargetDist = 0;
+	legFpp.maxTargetDist = 0;
+	return getPathMatchingCond(creature, waypoint, dirList, FrozenPathingConditionCall(waypoint), legFpp);
+}
+
 bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
 {
 	Position pos = creature.getPosition();
@@ -988,6 +1397,9 @@ bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPo
 	const int_fast32_t sX = std::abs(targetPos.getX() - pos.getX());
 	const int_fast32_t sY = std::abs(targetPos.getY() - pos.getY());
 
+	//fleeing searches filter every tile on their own, jumps would step over them
+	const bool jumpPoints = g_config.getBoolean(ConfigManager::JUMP_POINT_SEARCH) && !fpp.keepDistance;
+
 	AStarNode* found = nullptr;
 	while (fpp.maxSearchDist != 0 || nodes.getClosedNodes() < 100) {
 		AStarNode* n = nodes.getBestNode();
@@ -998,6 +1410,8 @@ bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPo
 			return false;
 		}
 
+		++expandedPathNodes;
+
 		const int_fast32_t x = n->x;
 		const int_fast32_t y = n->y;
 		pos.x = x;
@@ -1013,8 +1427,9 @@ bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPo
 		uint_fast32_t dirCount;
 		int_fast32_t* neighbors;
 		if (n->parent) {
-			const int_fast32_t offset_x = n->parent->x - x;
-			const int_fast32_t offset_y = n->parent->y - y;
+			//jump points can be several tiles away from their parent
+			const int_fast32_t offset_x = (n->parent->x > x) - (n->parent->x < x);
+			const int_fast32_t offset_y = (n->parent->y > y) - (n->parent->y < y);
 			if (offset_y == 0) {
 				if (offset_x == -1) {
 					neighbors = *dirNeighbors[DIRECTION_WEST];
@@ -1056,6 +1471,11 @@ bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPo
 				continue;
 			}
 
+			int_fast32_t jumpLength = 1;
+			if (jumpPoints && (pos.x == x || pos.y == y)) {
+				jumpLength = getJumpLength(creature, startPos, pos, x, y, targetPos, pathCondition, fpp);
+			}
+
 			const Tile* tile;
 			int_fast32_t extraCost;
 			AStarNode* neighborNode = nodes.getNodeByPosition(pos.x, pos.y);
@@ -1071,7 +1491,7 @@ bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPo
 			}
 
 			//The cost (g) for this neighbor
-			const int_fast32_t cost = AStarNodes::getMapWalkCost(n, pos);
+			const int_fast32_t cost = (jumpLength > 1 ? jumpLength * MAP_NORMALWALKCOST : AStarNodes::getMapWalkCost(n, pos));
 			const int_fast32_t newf = f + cost + extraCost;
 			if (neighborNode) {
 				if (neighborNode->f <= newf) {
@@ -1111,28 +1531,33 @@ bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPo
 		int_fast32_t dx = pos.getX() - prevx;
 		int_fast32_t dy = pos.getY() - prevy;
 
+		//jumps move in a straight line
+		const int_fast32_t steps = std::max<int_fast32_t>(std::abs(dx), std::abs(dy));
+		dx /= steps;
+		dy /= steps;
+
 		prevx = pos.x;
 		prevy = pos.y;
 		if (dx == 1) {
 			if (dy == 1) {
-				dirList.emplace_back(DIRECTION_NORTHWEST);
+				dirList.insert(dirList.end(), steps, DIRECTION_NORTHWEST);
 			} else if (dy == -1) {
-				dirList.emplace_back(DIRECTION_SOUTHWEST);
+				dirList.insert(dirList.end(), steps, DIRECTION_SOUTHWEST);
 			} else {
-				dirList.emplace_back(DIRECTION_WEST);
+				dirList.insert(dirList.end(), steps, DIRECTION_WEST);
 			}
 		} else if (dx == -1) {
 			if (dy == 1) {
-				dirList.emplace_back(DIRECTION_NORTHEAST);
+				dirList.insert(dirList.end(), steps, DIRECTION_NORTHEAST);
 			} else if (dy == -1) {
-				dirList.emplace_back(DIRECTION_SOUTHEAST);
+				dirList.insert(dirList.end(), steps, DIRECTION_SOUTHEAST);
 			} else {
-				dirList.emplace_back(DIRECTION_EAST);
+				dirList.insert(dirList.end(), steps, DIRECTION_EAST);
 			}
 		} else if (dy == 1) {
-			dirList.emplace_back(DIRECTION_NORTH);
+			dirList.insert(dirList.end(), steps, DIRECTION_NORTH);
 		} else if (dy == -1) {
-			dirList.emplace_back(DIRECTION_SOUTH);
+			dirList.insert(dirList.end(), steps, DIRECTION_SOUTH);
 		}
 		found = found->parent;
 	}
@@ -1397,7 +1822,7 @@ inline int_fast32_t AStarNodes::getMapWalkCost(AStarNode* node, const Position&
 	return (((std::abs(node->x - neighborPos.x) + std::abs(node->y - neighborPos.y)) - 1) * MAP_DIAGONALWALKCOST) + MAP_NORMALWALKCOST;
 }
 
-inline int_fast32_t AStarNodes::getTileWalkCost(const Creature& creature, const Tile* tile)
+int_fast32_t AStarNodes::getTileWalkCost(const Creature& creature, const Tile* tile)
 {
 	int_fast32_t cost = 0;
 	if (tile->getTopVisibleCreature(&creature) != nullptr) {
@@ -1441,65 +1866,333 @@ bool MapSector::getFloor(uint8_t z) const
 	}
 }
 
-void MapSector::addCreature(Creature* c)
+void MapSector::addCreature(Creature* c, const Position& pos)
 {
-	creature_list.push_back(c);
+	++creatureVersion;
+	creature_list.add(c, pos);
 	if (c->getPlayer()) {
-		player_list.push_back(c);
+		++playerVersion;
+		player_list.add(c, pos);
 	}
 }
 
 void MapSector::removeCreature(Creature* c)
 {
-	auto iter = std::find(creature_list.begin(), creature_list.end(), c);
-	assert(iter != creature_list.end());
-	*iter = creature_list.back();
-	creature_list.pop_back();
+	++creatureVersion;
+	creature_list.remove(c);
 	if (c->getPlayer()) {
-		iter = std::find(player_list.begin(), player_list.end(), c);
-		assert(iter != player_list.end());
-		*iter = player_list.back();
-		player_list.pop_back();
+		++playerVersion;
+		player_list.remove(c);
 	}
 }
 
-uint32_t Map::clean() const
+void MapSector::moveCreature(Creature* c, const Position& pos)
 {
-	uint64_t start = OTSYS_TIME();
-	size_t tiles = 0;
+	creature_list.move(c, pos);
+	if (c->getPlayer()) {
+		player_list.move(c, pos);
+	}
+}
 
-	if (g_game.getGameState() == GAME_STATE_NORMAL) {
-		g_game.setGameState(GAME_STATE_MAINTAIN);
+// SectorCreatureList
+void SectorCreatureList::add(Creature* creature, const Position& pos)
+{
+	creatures.push_back(creature);
+	positionsX.push_back(pos.x);
+	positionsY.push_back(pos.y);
+	positionsZ.push_back(pos.z);
+}
+
+void SectorCreatureList::remove(Creature* creature)
+{
+	auto it = std::find(creatures.begin(), creatures.end(), creature);
+	assert(it != creatures.end());
+
+	size_t index = std::distance(creatures.begin(), it);
+	*it = creatures.back();
+	creatures.pop_back();
+	positionsX[index] = positionsX.back();
+	positionsX.pop_back();
+	positionsY[index] = positionsY.back();
+	positionsY.pop_back();
+	positionsZ[index] = positionsZ.back();
+	positionsZ.pop_back();
+}
+
+void SectorCreatureList::move(Creature* creature, const Position& pos)
+{
+	auto it = std::find(creatures.begin(), creatures.end(), creature);
+	assert(it != creatures.end());
+
+	size_t index = std::distance(creatures.begin(), it);
+	positionsX[index] = pos.x;
+	positionsY[index] = pos.y;
+	positionsZ[index] = pos.z;
+}
+
+void SectorCreatureList::getSpectators(SpectatorVector& spectators, int32_t biasX, int32_t biasY, int32_t minRangeZ,
+                                       uint32_t width, uint32_t height, uint32_t depth) const
+{
+	const int32_t* xs = positionsX.data();
+	const int32_t* ys = positionsY.data();
+	const int32_t* zs = positionsZ.data();
+
+	size_t i = 0, size = creatures.size();
+	#if defined(__AVX2__)
+	//unsigned compare through signed compare with flipped sign bits
+	const __m256i signBit = _mm256_set1_epi32(static_cast<int32_t>(0x80000000));
+	const __m256i vbiasX = _mm256_set1_epi32(biasX);
+	const __m256i vbiasY = _mm256_set1_epi32(biasY);
+	const __m256i vminZ = _mm256_set1_epi32(minRangeZ);
+	const __m256i vwidth = _mm256_set1_epi32(static_cast<int32_t>(width ^ 0x80000000));
+	const __m256i vheight = _mm256_set1_epi32(static_cast<int32_t>(height ^ 0x80000000));
+	const __m256i vdepth = _mm256_set1_epi32(static_cast<int32_t>(depth ^ 0x80000000));
+	for (; i + 8 <= size; i += 8) {
+		const __m256i z = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(zs + i));
+		const __m256i dx = _mm256_xor_si256(_mm256_sub_epi32(_mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + i)), z), vbiasX), signBit);
+		const __m256i dy = _mm256_xor_si256(_mm256_sub_epi32(_mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + i)), z), vbiasY), signBit);
+		const __m256i dz = _mm256_xor_si256(_mm256_sub_epi32(z, vminZ), signBit);
+		const __m256i outside = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(dx, vwidth), _mm256_cmpgt_epi32(dy, vheight)), _mm256_cmpgt_epi32(dz, vdepth));
+
+		uint32_t mask = static_cast<uint32_t>(~_mm256_movemask_ps(_mm256_castsi256_ps(outside))) & 0xFF;
+		while (mask != 0) {
+			spectators.push_back(creatures[i + _mm_ctz(mask)]);
+			mask &= mask - 1;
+		}
 	}
+	#elif defined(__SSE2__)
+	//unsigned compare through signed compare with flipped sign bits
+	const __m128i signBit = _mm_set1_epi32(static_cast<int32_t>(0x80000000));
+	const __m128i vbiasX = _mm_set1_epi32(biasX);
+	const __m128i vbiasY = _mm_set1_epi32(biasY);
+	const __m128i vminZ = _mm_set1_epi32(minRangeZ);
+	const __m128i vwidth = _mm_set1_epi32(static_cast<int32_t>(width ^ 0x80000000));
+	const __m128i vheight = _mm_set1_epi32(static_cast<int32_t>(height ^ 0x80000000));
+	const __m128i vdepth = _mm_set1_epi32(static_cast<int32_t>(depth ^ 0x80000000));
+	for (; i + 4 <= size; i += 4) {
+		const __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(zs + i));
+		const __m128i dx = _mm_xor_si128(_mm_sub_epi32(_mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i)), z), vbiasX), signBit);
+		const __m128i dy = _mm_xor_si128(_mm_sub_epi32(_mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i)), z), vbiasY), signBit);
+		const __m128i dz = _mm_xor_si128(_mm_sub_epi32(z, vminZ), signBit);
+		const __m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(dx, vwidth), _mm_cmpgt_epi32(dy, vheight)), _mm_cmpgt_epi32(dz, vdepth));
+
+		uint32_t mask = static_cast<uint32_t>(~_mm_movemask_ps(_mm_castsi128_ps(outside))) & 0x0F;
+		while (mask != 0) {
+			spectators.push_back(creatures[i + _mm_ctz(mask)]);
+			mask &= mask - 1;
+		}
+	}
+	#endif
+	for (; i < size; ++i) {
+		if (static_cast<uint32_t>(zs[i] - minRangeZ) <= depth && static_cast<uint32_t>(xs[i] + zs[i] - biasX) <= width && static_cast<uint32_t>(ys[i] + zs[i] - biasY) <= height) {
+			spectators.push_back(creatures[i]);
+		}
+	}
+}
 
-	std::vector<Item*> toRemove;
-	toRemove.reserve(128);
-	for (const auto& mit : mapSectors) {
-		for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
-			if (mit.second.getFloor(z)) {
-				for (auto& row : mit.second.tiles[z]) {
-					for (auto tile : row) {
-						if (!tile || tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
-							continue;
-						}
+void Map::updateActivityZones(const std::vector<Position>& centers, int32_t radius,
+                              std::vector<Creature*>& activeCreatures, std::vector<Creature*>& inactiveCreatures)
+{
+	//sectors hold every floor, so the zones ignore z
+	++activityEpoch;
+
+	std::vector<MapSector*> sectors;
+	sectors.reserve(activeSectors.size());
+	for (const Position& center : centers) {
+		int32_t startx = std::max<int32_t>(0, center.x - radius) & ~SECTOR_MASK;
+		int32_t starty = std::max<int32_t>(0, center.y - radius) & ~SECTOR_MASK;
+		int32_t endx = std::min<int32_t>(0xFFFF, center.x + radius);
+		int32_t endy = std::min<int32_t>(0xFFFF, center.y + radius);
+
+		for (int32_t ny = starty; ny <= endy; ny += SECTOR_SIZE) {
+			for (int32_t nx = startx; nx <= endx; nx += SECTOR_SIZE) {
+				MapSector* sector = getMapSector(nx, ny);
+				if (sector && sector->activityEpoch != activityEpoch) {
+					sector->activityEpoch = activityEpoch;
+					sectors.push_back(sector);
+				}
+			}
+		}
+	}
 
-						TileItemVector* itemList = tile->getItemList();
-						if (!itemList) {
-							continue;
-						}
+	for (MapSector* sector : activeSectors) {
+		if (sector->activityEpoch == activityEpoch) {
+			continue;
+		}
 
-						++tiles;
-						for (auto it = ItemVector::const_reverse_iterator(itemList->getEndDownItem()), end = ItemVector::const_reverse_iterator(itemList->getBeginDownItem()); it != end; ++it) {
-							Item* item = (*it);
-							if (item->isCleanable()) {
-								toRemove.push_back(item);
-							}
+		for (Creature* creature : sector->creature_list) {
+			if (!creature->getPlayer()) {
+				inactiveCreatures.push_back(creature);
+			}
+		}
+	}
+
+	for (MapSector* sector : sectors) {
+		for (Creature* creature : sector->creature_list) {
+			if (!creature->getPlayer()) {
+				activeCreatures.push_back(creature);
+			}
+		}
+	}
+	activeSectors = std::move(sectors);
+}
+
+bool Map::isSectorActive(const Position& pos) const
+{
+	const MapSector* sector = getMapSector(pos.x, pos.y);
+	return sector && sector->activityEpoch == activityEpoch;
+}
+
+#if GAME_FEATURE_FLAT_SECTOR_GRID > 0
+// MapSectorGrid
+MapSector* MapSectorGrid::create(uint32_t x, uint32_t y, bool& created)
+{
+	std::unique_ptr<MapSector>& sector = getChunk(x, y).sectors[y & SECTOR_CHUNK_MASK][x & SECTOR_CHUNK_MASK];
+	if (!sector) {
+		sector.reset(new MapSector());
+		created = true;
+	}
+	return sector.get();
+}
+
+void MapSectorGrid::reserve(uint32_t width, uint32_t height)
+{
+	uint32_t endx = std::min<uint32_t>(width / SECTOR_SIZE, SECTOR_GRID_SIZE - 1);
+	uint32_t endy = std::min<uint32_t>(height / SECTOR_SIZE, SECTOR_GRID_SIZE - 1);
+	for (uint32_t y = 0; y <= endy; y += SECTOR_CHUNK_SIZE) {
+		for (uint32_t x = 0; x <= endx; x += SECTOR_CHUNK_SIZE) {
+			getChunk(x, y);
+		}
+	}
+}
+
+MapSectorGrid::SectorChunk& MapSectorGrid::getChunk(uint32_t x, uint32_t y)
+{
+	std::unique_ptr<SectorChunk>& chunk = chunks[(y >> SECTOR_CHUNK_BITS) * SECTOR_GRID_CHUNKS + (x >> SECTOR_CHUNK_BITS)];
+	if (!chunk) {
+		chunk.reset(new SectorChunk());
+	}
+	return *chunk;
+}
+#endif
+
+namespace {
+
+void hashBytes(uint64_t& hash, const char* data, size_t size)
+{
+	//FNV-1a
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ static_cast<uint8_t>(data[i])) * 0x100000001B3ULL;
+	}
+}
+
+template <typename T>
+void hashValue(uint64_t& hash, T value)
+{
+	hashBytes(hash, reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void hashItem(uint64_t& hash, const Item* item)
+{
+	hashValue(hash, item->getID());
+	hashValue(hash, item->getSubType());
+
+	PropWriteStream propWriteStream;
+	item->serializeAttr(propWriteStream);
+	size_t size;
+	const char* attributes = propWriteStream.getStream(size);
+	hashBytes(hash, attributes, size);
+
+	if (const Container* container = item->getContainer()) {
+		hashValue(hash, container->size());
+		for (const Item* containerItem : container->getItemList()) {
+			hashItem(hash, containerItem);
+		}
+	}
+}
+
+}
+
+uint64_t Map::getChecksum() const
+{
+	uint64_t checksum = 0;
+	forEachTile([&checksum](const Tile& tile) {
+		uint64_t hash = 0xCBF29CE484222325ULL;
+		const Position& pos = tile.getPosition();
+		hashValue(hash, pos.x);
+		hashValue(hash, pos.y);
+		hashValue(hash, pos.z);
+		hashValue(hash, tile.getFlags());
+
+		if (const Item* ground = tile.getGround()) {
+			hashItem(hash, ground);
+		}
+
+		if (const TileItemVector* items = tile.getItemList()) {
+			hashValue(hash, items->size());
+			for (const Item* item : *items) {
+				hashItem(hash, item);
+			}
+		}
+
+		//summed up so the sector order does not matter
+		checksum += hash;
+	});
+	return checksum;
+}
+
+size_t Map::getCleanableItems(const MapSector& sector, std::vector<Item*>& toRemove)
+{
+	size_t tiles = 0;
+	for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
+		if (sector.getFloor(z)) {
+			for (auto& row : sector.tiles[z]) {
+				for (auto tile : row) {
+					if (!tile || tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
+						continue;
+					}
+
+					TileItemVector* itemList = tile->getItemList();
+					if (!itemList) {
+						continue;
+					}
+
+					++tiles;
+					for (auto it = ItemVector::const_reverse_iterator(itemList->getEndDownItem()), end = ItemVector::const_reverse_iterator(itemList->getBeginDownItem()); it != end; ++it) {
+						Item* item = (*it);
+						if (item->isCleanable()) {
+							toRemove.push_back(item);
 						}
 					}
 				}
 			}
 		}
 	}
+	return tiles;
+}
+
+uint32_t Map::clean()
+{
+	uint64_t start = OTSYS_TIME();
+	size_t tiles = 0;
+
+	if (g_game.getGameState() == GAME_STATE_NORMAL) {
+		g_game.setGameState(GAME_STATE_MAINTAIN);
+	}
+
+	std::vector<Item*> toRemove;
+	toRemove.reserve(128);
+	auto cleanSector = [&](const MapSector& sector) {
+		tiles += getCleanableItems(sector, toRemove);
+	};
+
+	#if GAME_FEATURE_FLAT_SECTOR_GRID > 0
+	mapSectors.forEach(cleanSector);
+	#else
+	for (const auto& mit : mapSectors) {
+		cleanSector(mit.second);
+	}
+	#endif
 
 	size_t count = toRemove.size();
 	for (Item* item : toRemove) {
@@ -1507,6 +2200,16 @@ uint32_t Map::clean() const
 	}
 	toRemove.clear();
 
+	//a running background pass has nothing left to do and finishes on its next slice
+	for (MapSector* sector : cleanMarkedSectors) {
+		sector->cleanMarked = false;
+	}
+	cleanMarkedSectors.clear();
+	for (MapSector* sector : backgroundClean.sectors) {
+		sector->cleanMarked = false;
+	}
+	backgroundClean.sectors.clear();
+
 	if (g_game.getGameState() == GAME_STATE_MAINTAIN) {
 		g_game.setGameState(GAME_STATE_NORMAL);
 	}
@@ -1516,3 +2219,64 @@ uint32_t Map::clean() const
 	          << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
 	return count;
 }
+
+void Map::markCleanable(const Position& pos)
+{
+	MapSector* sector = getMapSector(pos.x, pos.y);
+	if (sector && !sector->cleanMarked) {
+		sector->cleanMarked = true;
+		cleanMarkedSectors.push_back(sector);
+	}
+}
+
+bool Map::startBackgroundClean()
+{
+	if (backgroundClean.running) {
+		return false;
+	}
+
+	//sectors marked while the pass runs are left for the next one
+	backgroundClean = BackgroundClean();
+	backgroundClean.sectors.swap(cleanMarkedSectors);
+	backgroundClean.start = OTSYS_TIME();
+	backgroundClean.running = true;
+	return true;
+}
+
+bool Map::backgroundCleanSlice(int64_t budget)
+{
+	if (!backgroundClean.running) {
+		return true;
+	}
+
+	const int64_t start = OTSYS_TIME();
+	std::vector<Item*> toRemove;
+	std::vector<MapSector*>& sectors = backgroundClean.sectors;
+	while (!sectors.empty() && OTSYS_TIME() - start < budget) {
+		MapSector* sector = sectors.back();
+		sectors.pop_back();
+		sector->cleanMarked = false;
+
+		toRemove.clear();
+		backgroundClean.tiles += getCleanableItems(*sector, toRemove);
+		backgroundClean.count += toRemove.size();
+		for (Item* item : toRemove) {
+			g_game.internalRemoveItem(item, -1);
+		}
+	}
+	backgroundClean.time += OTSYS_TIME() - start;
+
+	if (!sectors.empty()) {
+		return false;
+	}
+
+	backgroundClean.running = false;
+
+	const uint32_t count = backgroundClean.count;
+	const size_t tiles = backgroundClean.tiles;
+	std::cout << "> CLEAN: Removed " << count << " item" << (count != 1 ? "s" : "")
+	          << " from " << tiles << " tile" << (tiles != 1 ? "s" : "") << " in "
+	          << backgroundClean.time / (1000.) << " seconds, spread over "
+	          << (OTSYS_TIME() - backgroundClean.start) / (1000.) << " seconds." << std::endl;
+	return true;
+}
@@ -29,6 +29,8 @@
 #include "town.h"
 #include "house.h"
 #include "spawn.h"
+#include "pathgraph.h"
+#include "flowfield.h"
 
 class Creature;
 class Player;
@@ -46,6 +48,8 @@ struct AStarNode {
 };
 
 static constexpr int32_t MAX_NODES = 512;
+//longest straight run of uniform cost tiles a single jump point covers
+static constexpr int32_t MAX_JUMP_LENGTH = 16;
 
 static constexpr int32_t MAP_NORMALWALKCOST = 10;
 static constexpr int32_t MAP_DIAGONALWALKCOST = 25;
@@ -63,7 +67,7 @@ class AStarNodes
 		AStarNode* getNodeByPosition(uint32_t x, uint32_t y);
 
 		static inline int_fast32_t getMapWalkCost(AStarNode* node, const Position& neighborPos);
-		static inline int_fast32_t getTileWalkCost(const Creature& creature, const Tile* tile);
+		static int_fast32_t getTileWalkCost(const Creature& creature, const Tile* tile);
 
 	private:
 		#if defined(__SSE2__)
@@ -79,7 +83,64 @@ class AStarNodes
 		bool openNodes[MAX_NODES];
 };
 
-using SpectatorCache = std::map<Position, SpectatorVector>;
+class MapSector;
+
+struct SpectatorCacheStats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t stale = 0;
+};
+
+//Open addressed cache of the spectators around a position, every entry keeps the versions of
+//the sectors it was built from and stays valid until a creature enters or leaves one of them
+class SpectatorCache
+{
+	public:
+		static constexpr size_t CAPACITY = 4096;
+		static constexpr size_t MAX_PROBES = 8;
+		static constexpr size_t MAX_SECTORS = 16;
+
+		struct Entry {
+			void addSector(const MapSector* sector, uint32_t version) {
+				if (sectorCount < MAX_SECTORS) {
+					sectors[sectorCount] = sector;
+					versions[sectorCount] = version;
+				}
+				++sectorCount;
+			}
+
+			SpectatorVector spectators;
+			const MapSector* sectors[MAX_SECTORS];
+			uint32_t versions[MAX_SECTORS];
+			uint64_t key = 0;
+			uint32_t sectorEpoch = 0;
+			uint32_t sectorCount = 0;
+		};
+
+		SpectatorCache() : entries(CAPACITY) {}
+
+		Entry* find(const Position& pos);
+		Entry& insert(const Position& pos);
+
+		SpectatorCacheStats& getStats() {
+			return stats;
+		}
+		const SpectatorCacheStats& getStats() const {
+			return stats;
+		}
+
+	private:
+		static uint64_t getKey(const Position& pos) {
+			//0 marks an empty slot
+			return (static_cast<uint64_t>(pos.z) << 32 | static_cast<uint64_t>(pos.y) << 16 | pos.x) + 1;
+		}
+		static size_t getSlot(uint64_t key) {
+			return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 52) & (CAPACITY - 1);
+		}
+
+		std::vector<Entry> entries;
+		SpectatorCacheStats stats;
+};
 
 //SECTOR_SIZE must be power of 2 value
 //The bigger the SECTOR_SIZE is the less hash map collision there should be but it'll consume more memory
@@ -88,6 +149,37 @@ static constexpr int32_t SECTOR_MASK = (SECTOR_SIZE - 1);
 
 class FrozenPathingConditionCall;
 
+//Creatures of a sector with their coordinates kept alongside in structure of arrays form,
+//the spectator scan filters the coordinates without touching the creatures themselves
+class SectorCreatureList
+{
+	public:
+		void add(Creature* creature, const Position& pos);
+		void remove(Creature* creature);
+		void move(Creature* creature, const Position& pos);
+
+		//appends every creature with (x + z - biasX) <= width, (y + z - biasY) <= height
+		//and (z - minRangeZ) <= depth compared as unsigned values
+		void getSpectators(SpectatorVector& spectators, int32_t biasX, int32_t biasY, int32_t minRangeZ,
+		                   uint32_t width, uint32_t height, uint32_t depth) const;
+
+		CreatureVector::const_iterator begin() const {
+			return creatures.begin();
+		}
+		CreatureVector::const_iterator end() const {
+			return creatures.end();
+		}
+		size_t size() const {
+			return creatures.size();
+		}
+
+	private:
+		CreatureVector creatures;
+		std::vector<int32_t> positionsX;
+		std::vector<int32_t> positionsY;
+		std::vector<int32_t> positionsZ;
+};
+
 class MapSector
 {
 	public:
@@ -105,21 +197,93 @@ class MapSector
 		void createFloor(uint8_t z);
 		bool getFloor(uint8_t z) const;
 
-		void addCreature(Creature* c);
+		void addCreature(Creature* c, const Position& pos);
 		void removeCreature(Creature* c);
+		void moveCreature(Creature* c, const Position& pos);
 
 	private:
 		static bool newSector;
 		MapSector* sectorS = nullptr;
 		MapSector* sectorE = nullptr;
-		CreatureVector creature_list;
-		CreatureVector player_list;
+		SectorCreatureList creature_list;
+		SectorCreatureList player_list;
 		Tile* tiles[MAP_MAX_LAYERS][SECTOR_SIZE][SECTOR_SIZE] = {};
 		uint32_t floorBits = 0;
+		uint32_t activityEpoch = 0;
+		bool cleanMarked = false;
+		uint32_t creatureVersion = 0;
+		uint32_t playerVersion = 0;
+		uint32_t walkVersion = 0;
+		uint32_t sightVersion = 0;
+		//tiles blocking projectiles, one row of bits per floor and y
+		uint16_t projectileBlock[MAP_MAX_LAYERS][SECTOR_SIZE] = {};
 
 		friend class Map;
 };
 
+#if GAME_FEATURE_FLAT_SECTOR_GRID > 0
+//Sectors are kept in chunks of SECTOR_CHUNK_SIZE x SECTOR_CHUNK_SIZE pointers,
+//the top level covers the whole 16-bit coordinate range so no lookup needs hashing
+static constexpr uint32_t SECTOR_CHUNK_BITS = 6;
+static constexpr uint32_t SECTOR_CHUNK_SIZE = (1 << SECTOR_CHUNK_BITS);
+static constexpr uint32_t SECTOR_CHUNK_MASK = (SECTOR_CHUNK_SIZE - 1);
+static constexpr uint32_t SECTOR_GRID_SIZE = (0x10000 / SECTOR_SIZE);
+static constexpr uint32_t SECTOR_GRID_CHUNKS = (SECTOR_GRID_SIZE / SECTOR_CHUNK_SIZE);
+
+class MapSectorGrid
+{
+	public:
+		MapSectorGrid() = default;
+
+		// non-copyable
+		MapSectorGrid(const MapSectorGrid&) = delete;
+		MapSectorGrid& operator=(const MapSectorGrid&) = delete;
+
+		//sector coordinates, i.e. tile coordinates / SECTOR_SIZE
+		MapSector* find(uint32_t x, uint32_t y) const {
+			if (x >= SECTOR_GRID_SIZE || y >= SECTOR_GRID_SIZE) {
+				return nullptr;
+			}
+
+			const SectorChunk* chunk = chunks[(y >> SECTOR_CHUNK_BITS) * SECTOR_GRID_CHUNKS + (x >> SECTOR_CHUNK_BITS)].get();
+			if (!chunk) {
+				return nullptr;
+			}
+			return chunk->sectors[y & SECTOR_CHUNK_MASK][x & SECTOR_CHUNK_MASK].get();
+		}
+		MapSector* create(uint32_t x, uint32_t y, bool& created);
+
+		//allocates the chunks covering the map size from the OTBM header up front
+		void reserve(uint32_t width, uint32_t height);
+
+		template <typename F>
+		void forEach(F&& f) const {
+			for (const auto& chunk : chunks) {
+				if (!chunk) {
+					continue;
+				}
+
+				for (const auto& row : chunk->sectors) {
+					for (const auto& sector : row) {
+						if (sector) {
+							f(*sector);
+						}
+					}
+				}
+			}
+		}
+
+	private:
+		struct SectorChunk {
+			std::unique_ptr<MapSector> sectors[SECTOR_CHUNK_SIZE][SECTOR_CHUNK_SIZE];
+		};
+
+		SectorChunk& getChunk(uint32_t x, uint32_t y);
+
+		std::unique_ptr<SectorChunk> chunks[SECTOR_GRID_CHUNKS * SECTOR_GRID_CHUNKS];
+};
+#endif
+
 /**
   * Map class.
   * Holds all the actual map-data
@@ -132,8 +296,21 @@ class Map
 		static constexpr int32_t maxClientViewportY = (CLIENT_MAP_HEIGHT_OFFFSET - 1);
 		static constexpr int32_t maxViewportX = (CLIENT_MAP_WIDTH_OFFSET + 1); //min value: maxClientViewportX + 1(needs to be at least + 1 from Monster::canSee)
 		static constexpr int32_t maxViewportY = (CLIENT_MAP_HEIGHT_OFFFSET + 1); //min value: maxClientViewportY + 1(needs to be at least + 1 from Monster::canSee)
-
-		uint32_t clean() const;
+		//multifloor spectator queries shift the viewport by up to 7 tiles (surface seen from floor 0)
+		static constexpr int32_t maxSpectatorReach = (maxViewportX > maxViewportY ? maxViewportX : maxViewportY) + 7;
+		static constexpr int32_t observerSectorRange = (maxSpectatorReach + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+		//also drops the marks of the background clean, every sector is clean afterwards
+		uint32_t clean();
+		//hash of the tiles and items of the map, independent of the order they were loaded in
+		uint64_t getChecksum() const;
+
+		//called when an item that may be cleaned was added to the tile at pos
+		void markCleanable(const Position& pos);
+		//starts a pass over the sectors marked since the last one, false if a pass is running already
+		bool startBackgroundClean();
+		//cleans marked sectors of the running pass for up to budget milliseconds, true once the pass is done
+		bool backgroundCleanSlice(int64_t budget);
 
 		/**
 		  * Load a map.
@@ -195,7 +372,25 @@ class Map
 		                   int32_t minRangeX = 0, int32_t maxRangeX = 0,
 		                   int32_t minRangeY = 0, int32_t maxRangeY = 0);
 
-		void clearSpectatorCache(bool clearPlayer);
+		void clearSpectatorCache(const Position& pos, bool clearPlayer);
+		const SpectatorCacheStats& getSpectatorCacheStats(bool players) const {
+			return players ? playersSpectatorCache.getStats() : spectatorCache.getStats();
+		}
+		void resetSpectatorCacheStats();
+
+		/**
+		  * Gets the players getSpectators(spectators, creature position, multifloor, true) would return,
+		  * filtered from the observers the creature keeps instead of scanning the sectors.
+		  */
+		void getObservers(SpectatorVector& spectators, const Creature* creature, bool multifloor = false);
+		uint64_t getSpectatorScansAvoided() const {
+			return spectatorScansAvoided;
+		}
+		static bool isInSpectatorRange(const Position& centerPos, const Position& pos, bool multifloor);
+
+		//keeps the creature's observers and its place in the observers of the creatures around it
+		void addObservers(Creature* creature, const Position& pos);
+		void removeObservers(Creature* creature, const Position& pos);
 
 		/**
 		  * Checks if you can throw an object to that position
@@ -226,6 +421,75 @@ class Map
 			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
 		bool getPathMatchingCond(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList,
 			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
+		//path nodes expanded so far by the searches of the calling thread
+		static uint64_t getExpandedPathNodes();
+
+		/**
+		  * Routes the creature over the path graph and searches the tile path of the first leg only,
+		  * used by follow walking when the regular path search can not reach targetPos.
+		  *	\param partial is set if the leg ends at a waypoint instead of targetPos
+		  *	\returns true if the first leg was found
+		  */
+		bool getHierarchicalPath(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList,
+			const FindPathParams& fpp, bool& partial);
+
+		//follow path of a monster chasing target, walked down from the flow field shared by all its chasers
+		bool getFlowFieldPath(const Creature& creature, const Creature& target, const FindPathParams& fpp, std::vector<Direction>& dirList) {
+			return flowFields.getPath(creature, target, fpp, dirList);
+		}
+		const FlowFieldStats& getFlowFieldStats() const {
+			return flowFields.getStats();
+		}
+		void resetFlowFieldStats() {
+			flowFields.resetStats();
+		}
+
+		//called whenever the walkability of a tile may have changed
+		void updateWalkability(const Tile& tile);
+		void updateFields(const Tile& tile);
+		//called whenever an item blocking projectiles was added to or removed from the tile
+		void updateSightBlock(const Tile& tile);
+		uint32_t getWalkVersion() const {
+			return walkVersion;
+		}
+		//version of the last walkability change in the sector of pos
+		uint32_t getWalkVersion(const Position& pos) const;
+
+		template <typename F>
+		void forEachTile(F&& f) const {
+			auto sectorTiles = [&f](const MapSector& sector) {
+				for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
+					if (!sector.getFloor(z)) {
+						continue;
+					}
+
+					for (const auto& row : sector.tiles[z]) {
+						for (const Tile* tile : row) {
+							if (tile) {
+								f(*tile);
+							}
+						}
+					}
+				}
+			};
+
+			#if GAME_FEATURE_FLAT_SECTOR_GRID > 0
+			mapSectors.forEach(sectorTiles);
+			#else
+			for (const auto& it : mapSectors) {
+				sectorTiles(it.second);
+			}
+			#endif
+		}
+
+		/**
+		  * Marks every sector within radius tiles of one of the centers as active.
+		  *	\param activeCreatures receives the non-player creatures of the active sectors
+		  *	\param inactiveCreatures receives the non-player creatures of sectors that are no longer active
+		  */
+		void updateActivityZones(const std::vector<Position>& centers, int32_t radius,
+		                         std::vector<Creature*>& activeCreatures, std::vector<Creature*>& inactiveCreatures);
+		bool isSectorActive(const Position& pos) const;
 
 		std::map<std::string, Position> waypoints;
 
@@ -234,10 +498,33 @@ class Map
 		Houses houses;
 
 	private:
+		PathGraph pathGraph{*this};
+		FlowFieldCache flowFields{*this};
 		SpectatorCache spectatorCache;
 		SpectatorCache playersSpectatorCache;
-
-		#if GAME_FEATURE_ROBINHOOD_HASH_MAP > 0
+		uint32_t sectorEpoch = 0;
+		uint32_t walkVersion = 0;
+		uint32_t sightVersion = 0;
+		uint64_t spectatorScansAvoided = 0;
+
+		std::vector<MapSector*> activeSectors;
+		uint32_t activityEpoch = 0;
+
+		struct BackgroundClean {
+			std::vector<MapSector*> sectors;
+			int64_t start = 0;
+			int64_t time = 0;
+			size_t tiles = 0;
+			uint32_t count = 0;
+			bool running = false;
+		};
+
+		std::vector<MapSector*> cleanMarkedSectors;
+		BackgroundClean backgroundClean;
+
+		#if GAME_FEATURE_FLAT_SECTOR_GRID > 0
+		MapSectorGrid mapSectors;
+		#elif GAME_FEATURE_ROBINHOOD_HASH_MAP > 0
 		robin_hood::unordered_map<uint32_t, MapSector> mapSectors;
 		#else
 		std::unordered_map<uint32_t, MapSector> mapSectors;
@@ -253,7 +540,23 @@ class Map
 		void getSpectatorsInternal(SpectatorVector& spectators, const Position& centerPos,
 		                           int32_t minRangeX, int32_t maxRangeX,
 		                           int32_t minRangeY, int32_t maxRangeY,
-		                           int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const;
+		                           int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers,
+		                           SpectatorCache::Entry* cacheEntry = nullptr) const;
+		bool isSpectatorCacheValid(const SpectatorCache::Entry& entry, bool players) const;
+		//collects the items clean removes from the sector, returns the number of tiles looked at
+		static size_t getCleanableItems(const MapSector& sector, std::vector<Item*>& toRemove);
+		bool blocksProjectile(uint16_t x, uint16_t y, uint8_t z) const;
+		//true if no sector around the line between the positions changed its projectile blocking after version
+		bool isSightCacheValid(const Position& fromPos, const Position& toPos, uint32_t version) const;
+		//tiles the path search can enter without any extra walk cost
+		bool isUniformTile(const Creature& creature, const Position& pos) const;
+		//number of uniform tiles the search can skip from (fromX, fromY) in the direction of pos,
+		//pos is moved to the last of them when the jump covers more than one tile
+		int_fast32_t getJumpLength(const Creature& creature, const Position& startPos, Position& pos, int_fast32_t fromX, int_fast32_t fromY,
+		                           const Position& targetPos, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
+		static void getSpectatorFloorRange(const Position& centerPos, bool multifloor, int32_t& minRangeZ, int32_t& maxRangeZ);
+		template <typename F>
+		void forEachObserverSector(const Position& pos, F&& f);
 
 		friend class Game;
 		friend class IOMap;
@@ -62,6 +62,16 @@ class NetworkMessage
 			return buffer[--info.position];
 		}
 
+		// reads the byte at the read position without consuming it, false when the message has none left
+		bool peekByte(uint8_t& value) const {
+			if ((info.position + 1) > (info.length + 8) || info.position + 1 >= NETWORKMESSAGE_MAXSIZE) {
+				return false;
+			}
+
+			value = buffer[info.position];
+			return true;
+		}
+
 		template<typename T>
 		T get() {
 			if (!canRead(sizeof(T))) {
@@ -35,6 +35,8 @@
 #include "databasemanager.h"
 #include "scheduler.h"
 #include "databasetasks.h"
+#include "workerpool.h"
+#include "pathservice.h"
 #include "script.h"
 #include <fstream>
 
@@ -42,6 +44,8 @@ Database g_database;
 DatabaseTasks g_databaseTasks;
 Dispatcher g_dispatcher;
 Scheduler g_scheduler;
+WorkerPool g_workerPool;
+PathService g_pathService;
 
 Game g_game;
 ConfigManager g_config;
@@ -166,6 +170,11 @@ void mainLoader(int, char*[], ServiceManager* services)
 	}
 #endif
 
+	int32_t workerThreads = g_config.getNumber(ConfigManager::WORKER_THREADS);
+	if (workerThreads > 0) {
+		g_workerPool.start(workerThreads);
+	}
+
 	//set RSA key
 	const char* n("109120132967399429278860960508995541528237502902798129123468757937266291492576446330739696001110603907230888610072655818825358503429057592827629436413108566029093628212635953836686562675849720620786279431090218017681061521755056710823876476444260558147179707119674283982419152118103759076030616683978566631413");
 	const char* d("46730330223584118622160180015036832148732986808519344675210555262940258739805766860224610646919605860206328024326703361630109888417839241959507572247284807035235569619173792292786907845791904955103601652822519121908367187885509270025388641700821735345222087940578381210879116823013776808975766851829020659073");
@@ -277,6 +286,10 @@ void mainLoader(int, char*[], ServiceManager* services)
 		return;
 	}
 
+	if (g_config.getBoolean(ConfigManager::ASYNC_PATHFINDING)) {
+		g_pathService.start(g_game.map);
+	}
+
 	std::cout << ">> Initializing gamestate" << std::endl;
 	g_game.setGameState(GAME_STATE_INIT);
 
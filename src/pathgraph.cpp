@@ -0,0 +1,376 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "pathgraph.h"
+#include "map.h"
+
+#include <queue>
+
+static_assert(PathGraph::CLUSTER_SIZE == SECTOR_SIZE, "Path graph clusters have to match the map sectors");
+static_assert(PathGraph::CLUSTER_SIZE <= 16, "Cluster rows are kept as 16-bit masks");
+
+constexpr int32_t PathGraph::UNREACHABLE;
+constexpr uint8_t PathGraph::NO_ENTRANCE;
+
+namespace {
+
+bool isStaticWalkable(const Tile* tile)
+{
+	//creatures and the creature dependent rules are left to the tile path search
+	return tile && tile->getGround() && !tile->hasFlag(TILESTATE_BLOCKSOLID | TILESTATE_BLOCKPATH | TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT);
+}
+
+int32_t getEstimatedCost(int32_t x, int32_t y, const Position& targetPos)
+{
+	//every step moves at most one tile on both axes
+	return std::max<int32_t>(std::abs(targetPos.x - x), std::abs(targetPos.y - y)) * MAP_NORMALWALKCOST;
+}
+
+}
+
+bool PathGraph::getNextWaypoint(const Position& startPos, const Position& targetPos, Position& waypoint)
+{
+	if (startPos.z != targetPos.z) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lockClass(graphLock);
+
+	const Cluster& startCluster = getCluster(startPos.x, startPos.y, startPos.z);
+	const Cluster& targetCluster = getCluster(targetPos.x, targetPos.y, targetPos.z);
+
+	CostTable startCosts;
+	getCosts(startCluster, startPos.x & CLUSTER_MASK, startPos.y & CLUSTER_MASK, startCosts);
+	if (&startCluster == &targetCluster && startCosts[targetPos.y & CLUSTER_MASK][targetPos.x & CLUSTER_MASK] != UNREACHABLE) {
+		waypoint = targetPos;
+		return true;
+	}
+
+	CostTable targetCosts;
+	getCosts(targetCluster, targetPos.x & CLUSTER_MASK, targetPos.y & CLUSTER_MASK, targetCosts);
+
+	struct SearchNode {
+		uint64_t parent = 0;
+		int32_t g = UNREACHABLE;
+		bool closed = false;
+	};
+
+	static constexpr uint64_t START_NODE = std::numeric_limits<uint64_t>::max();
+
+	const uint8_t z = startPos.z;
+	const uint64_t targetKey = getNodeKey(targetPos.x, targetPos.y, z);
+
+	std::unordered_map<uint64_t, SearchNode> nodes;
+	std::priority_queue<std::pair<int32_t, uint64_t>, std::vector<std::pair<int32_t, uint64_t>>, std::greater<std::pair<int32_t, uint64_t>>> openNodes;
+
+	auto relax = [&](int32_t x, int32_t y, int32_t g, uint64_t parent) {
+		if (x < 0 || y < 0 || x > 0xFFFF || y > 0xFFFF) {
+			return;
+		}
+
+		const uint64_t key = getNodeKey(x, y, z);
+		SearchNode& node = nodes[key];
+		if (node.closed || g >= node.g) {
+			return;
+		}
+
+		node.g = g;
+		node.parent = parent;
+		openNodes.emplace(g + getEstimatedCost(x, y, targetPos), key);
+	};
+
+	const int32_t startBaseX = startPos.x & ~CLUSTER_MASK;
+	const int32_t startBaseY = startPos.y & ~CLUSTER_MASK;
+	for (const Entrance& entrance : startCluster.entrances) {
+		const int32_t cost = startCosts[entrance.y][entrance.x];
+		if (cost != UNREACHABLE) {
+			relax(startBaseX + entrance.x, startBaseY + entrance.y, cost, START_NODE);
+		}
+	}
+
+	bool found = false;
+	size_t expandedNodes = 0;
+	while (!openNodes.empty() && expandedNodes < MAX_EXPANDED_NODES) {
+		const uint64_t key = openNodes.top().second;
+		openNodes.pop();
+
+		SearchNode& node = nodes[key];
+		if (node.closed) {
+			continue;
+		}
+
+		node.closed = true;
+		++expandedNodes;
+
+		if (key == targetKey) {
+			found = true;
+			break;
+		}
+
+		const int32_t g = node.g;
+		const int32_t x = static_cast<int32_t>(key & 0xFFFF);
+		const int32_t y = static_cast<int32_t>((key >> 16) & 0xFFFF);
+
+		const Cluster& cluster = getCluster(x, y, z);
+		const uint8_t index = cluster.entranceIndex[y & CLUSTER_MASK][x & CLUSTER_MASK];
+		if (index == NO_ENTRANCE) {
+			continue;
+		}
+
+		if (&cluster == &targetCluster) {
+			const int32_t cost = targetCosts[y & CLUSTER_MASK][x & CLUSTER_MASK];
+			if (cost != UNREACHABLE) {
+				relax(targetPos.x, targetPos.y, g + cost, key);
+			}
+		}
+
+		const int32_t baseX = x & ~CLUSTER_MASK;
+		const int32_t baseY = y & ~CLUSTER_MASK;
+		const size_t entranceCount = cluster.entrances.size();
+		const int32_t* costs = &cluster.costs[index * entranceCount];
+		for (size_t i = 0; i < entranceCount; ++i) {
+			if (i != index && costs[i] != UNREACHABLE) {
+				const Entrance& entrance = cluster.entrances[i];
+				relax(baseX + entrance.x, baseY + entrance.y, g + costs[i], key);
+			}
+		}
+
+		const uint8_t links = cluster.entrances[index].links;
+		if (links & LINK_NORTH) {
+			relax(x, y - 1, g + MAP_NORMALWALKCOST, key);
+		}
+		if (links & LINK_EAST) {
+			relax(x + 1, y, g + MAP_NORMALWALKCOST, key);
+		}
+		if (links & LINK_SOUTH) {
+			relax(x, y + 1, g + MAP_NORMALWALKCOST, key);
+		}
+		if (links & LINK_WEST) {
+			relax(x - 1, y, g + MAP_NORMALWALKCOST, key);
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	//the leg into the first cluster after the start one is all the caller refines
+	waypoint = targetPos;
+	const uint64_t startClusterKey = getClusterKey(startPos.x, startPos.y, z);
+	for (uint64_t key = nodes[targetKey].parent; key != START_NODE; key = nodes[key].parent) {
+		const uint16_t x = static_cast<uint16_t>(key & 0xFFFF);
+		const uint16_t y = static_cast<uint16_t>((key >> 16) & 0xFFFF);
+		if (getClusterKey(x, y, z) != startClusterKey) {
+			waypoint = Position(x, y, z);
+		}
+	}
+	return true;
+}
+
+void PathGraph::invalidate(const Position& pos)
+{
+	std::lock_guard<std::mutex> lockClass(graphLock);
+	if (clusters.empty()) {
+		return;
+	}
+
+	clusters.erase(getClusterKey(pos.x, pos.y, pos.z));
+
+	//tiles on the border also decide the entrances of the neighbour
+	const int32_t x = pos.x & CLUSTER_MASK;
+	const int32_t y = pos.y & CLUSTER_MASK;
+	if (x == 0 && pos.x >= CLUSTER_SIZE) {
+		clusters.erase(getClusterKey(pos.x - CLUSTER_SIZE, pos.y, pos.z));
+	} else if (x == CLUSTER_MASK && pos.x < 0x10000 - CLUSTER_SIZE) {
+		clusters.erase(getClusterKey(pos.x + CLUSTER_SIZE, pos.y, pos.z));
+	}
+
+	if (y == 0 && pos.y >= CLUSTER_SIZE) {
+		clusters.erase(getClusterKey(pos.x, pos.y - CLUSTER_SIZE, pos.z));
+	} else if (y == CLUSTER_MASK && pos.y < 0x10000 - CLUSTER_SIZE) {
+		clusters.erase(getClusterKey(pos.x, pos.y + CLUSTER_SIZE, pos.z));
+	}
+}
+
+void PathGraph::clear()
+{
+	std::lock_guard<std::mutex> lockClass(graphLock);
+	clusters.clear();
+}
+
+size_t PathGraph::getClusterCount() const
+{
+	std::lock_guard<std::mutex> lockClass(graphLock);
+	return clusters.size();
+}
+
+const PathGraph::Cluster& PathGraph::getCluster(uint16_t x, uint16_t y, uint8_t z)
+{
+	const uint64_t key = getClusterKey(x, y, z);
+	auto it = clusters.find(key);
+	if (it != clusters.end()) {
+		return it->second;
+	}
+
+	Cluster& cluster = clusters[key];
+	buildCluster(cluster, x & ~CLUSTER_MASK, y & ~CLUSTER_MASK, z);
+	return cluster;
+}
+
+void PathGraph::buildCluster(Cluster& cluster, int32_t baseX, int32_t baseY, uint8_t z) const
+{
+	//walkability of the cluster with a one tile ring of its neighbours
+	bool walkable[CLUSTER_SIZE + 2][CLUSTER_SIZE + 2];
+	for (int32_t y = -1; y <= CLUSTER_SIZE; ++y) {
+		for (int32_t x = -1; x <= CLUSTER_SIZE; ++x) {
+			const int32_t tileX = baseX + x;
+			const int32_t tileY = baseY + y;
+			bool isWalkable = false;
+			if (tileX >= 0 && tileY >= 0 && tileX <= 0xFFFF && tileY <= 0xFFFF) {
+				isWalkable = isStaticWalkable(map.getTile(tileX, tileY, z));
+			}
+			walkable[y + 1][x + 1] = isWalkable;
+		}
+	}
+
+	for (int32_t y = 0; y < CLUSTER_SIZE; ++y) {
+		uint16_t row = 0;
+		for (int32_t x = 0; x < CLUSTER_SIZE; ++x) {
+			if (walkable[y + 1][x + 1]) {
+				row |= (1 << x);
+			}
+		}
+		cluster.walkable[y] = row;
+	}
+
+	std::fill(&cluster.entranceIndex[0][0], &cluster.entranceIndex[0][0] + CLUSTER_SIZE * CLUSTER_SIZE, NO_ENTRANCE);
+
+	auto addEntrance = [&cluster](int32_t x, int32_t y, uint8_t link) {
+		uint8_t& index = cluster.entranceIndex[y][x];
+		if (index == NO_ENTRANCE) {
+			index = static_cast<uint8_t>(cluster.entrances.size());
+			cluster.entrances.push_back({static_cast<uint8_t>(x), static_cast<uint8_t>(y), 0});
+		}
+		cluster.entrances[index].links |= link;
+	};
+
+	//both clusters of a border see the same runs, so their entrances always face each other
+	struct BorderSide {
+		int32_t x, y;
+		int32_t stepX, stepY;
+		int32_t outsideX, outsideY;
+		uint8_t link;
+	};
+
+	static constexpr BorderSide sides[] = {
+		{0, 0, 1, 0, 0, -1, LINK_NORTH},
+		{CLUSTER_MASK, 0, 0, 1, 1, 0, LINK_EAST},
+		{0, CLUSTER_MASK, 1, 0, 0, 1, LINK_SOUTH},
+		{0, 0, 0, 1, -1, 0, LINK_WEST},
+	};
+
+	for (const BorderSide& side : sides) {
+		int32_t runStart = -1;
+		for (int32_t i = 0; i <= CLUSTER_SIZE; ++i) {
+			bool open = false;
+			if (i < CLUSTER_SIZE) {
+				const int32_t x = side.x + side.stepX * i;
+				const int32_t y = side.y + side.stepY * i;
+				open = walkable[y + 1][x + 1] && walkable[y + side.outsideY + 1][x + side.outsideX + 1];
+			}
+
+			if (open) {
+				if (runStart == -1) {
+					runStart = i;
+				}
+				continue;
+			}
+
+			if (runStart == -1) {
+				continue;
+			}
+
+			const int32_t runEnd = i - 1;
+			if (runEnd - runStart + 1 >= ENTRANCE_SPLIT_LENGTH) {
+				addEntrance(side.x + side.stepX * runStart, side.y + side.stepY * runStart, side.link);
+				addEntrance(side.x + side.stepX * runEnd, side.y + side.stepY * runEnd, side.link);
+			} else {
+				const int32_t middle = (runStart + runEnd) / 2;
+				addEntrance(side.x + side.stepX * middle, side.y + side.stepY * middle, side.link);
+			}
+			runStart = -1;
+		}
+	}
+
+	const size_t entranceCount = cluster.entrances.size();
+	cluster.costs.resize(entranceCount * entranceCount);
+
+	CostTable costs;
+	for (size_t i = 0; i < entranceCount; ++i) {
+		const Entrance& from = cluster.entrances[i];
+		getCosts(cluster, from.x, from.y, costs);
+		for (size_t j = 0; j < entranceCount; ++j) {
+			const Entrance& to = cluster.entrances[j];
+			cluster.costs[i * entranceCount + j] = costs[to.y][to.x];
+		}
+	}
+}
+
+void PathGraph::getCosts(const Cluster& cluster, int32_t x, int32_t y, CostTable& costs)
+{
+	static constexpr int32_t neighbors[8][3] = {
+		{-1, 0, MAP_NORMALWALKCOST}, {0, 1, MAP_NORMALWALKCOST}, {1, 0, MAP_NORMALWALKCOST}, {0, -1, MAP_NORMALWALKCOST},
+		{-1, -1, MAP_DIAGONALWALKCOST}, {1, -1, MAP_DIAGONALWALKCOST}, {1, 1, MAP_DIAGONALWALKCOST}, {-1, 1, MAP_DIAGONALWALKCOST}
+	};
+
+	std::fill(&costs[0][0], &costs[0][0] + CLUSTER_SIZE * CLUSTER_SIZE, UNREACHABLE);
+	costs[y][x] = 0;
+
+	std::priority_queue<std::pair<int32_t, int32_t>, std::vector<std::pair<int32_t, int32_t>>, std::greater<std::pair<int32_t, int32_t>>> openTiles;
+	openTiles.emplace(0, y * CLUSTER_SIZE + x);
+	while (!openTiles.empty()) {
+		const int32_t cost = openTiles.top().first;
+		const int32_t tileX = openTiles.top().second % CLUSTER_SIZE;
+		const int32_t tileY = openTiles.top().second / CLUSTER_SIZE;
+		openTiles.pop();
+		if (cost > costs[tileY][tileX]) {
+			continue;
+		}
+
+		for (const auto& neighbor : neighbors) {
+			const int32_t nextX = tileX + neighbor[0];
+			const int32_t nextY = tileY + neighbor[1];
+			if (nextX < 0 || nextY < 0 || nextX >= CLUSTER_SIZE || nextY >= CLUSTER_SIZE) {
+				continue;
+			}
+
+			if (!(cluster.walkable[nextY] & (1 << nextX))) {
+				continue;
+			}
+
+			const int32_t nextCost = cost + neighbor[2];
+			if (nextCost < costs[nextY][nextX]) {
+				costs[nextY][nextX] = nextCost;
+				openTiles.emplace(nextCost, nextY * CLUSTER_SIZE + nextX);
+			}
+		}
+	}
+}
@@ -0,0 +1,105 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_PATHGRAPH_H_5C1E0A9D7B3F4E2A8D6C4B1F0E9A7D35
+#define FS_PATHGRAPH_H_5C1E0A9D7B3F4E2A8D6C4B1F0E9A7D35
+
+#include "position.h"
+
+#include <limits>
+
+class Map;
+
+//Abstract graph above the tile path search: every floor of a cluster keeps the tiles it can be
+//entered through from the neighbouring clusters and the walking costs between them, built from
+//the static walkability of the tiles the first time a search passes through
+class PathGraph
+{
+	public:
+		static constexpr int32_t CLUSTER_SIZE = 16;
+		static constexpr int32_t CLUSTER_MASK = (CLUSTER_SIZE - 1);
+		//border runs at least this long get an entrance at both ends instead of one in the middle
+		static constexpr int32_t ENTRANCE_SPLIT_LENGTH = 6;
+		static constexpr size_t MAX_EXPANDED_NODES = 4096;
+
+		explicit PathGraph(const Map& map) : map(map) {}
+
+		// non-copyable
+		PathGraph(const PathGraph&) = delete;
+		PathGraph& operator=(const PathGraph&) = delete;
+
+		/**
+		  * Searches a route from startPos to targetPos over the abstract graph.
+		  *	\param waypoint receives the first tile of the route outside the cluster of startPos,
+		  *	or targetPos when the route stays inside of it
+		  *	\returns true if a route was found
+		  */
+		bool getNextWaypoint(const Position& startPos, const Position& targetPos, Position& waypoint);
+
+		//drops the clusters whose entrances or costs depend on the walkability of pos
+		void invalidate(const Position& pos);
+		void clear();
+
+		size_t getClusterCount() const;
+
+	private:
+		static constexpr int32_t UNREACHABLE = std::numeric_limits<int32_t>::max();
+		static constexpr uint8_t NO_ENTRANCE = 0xFF;
+
+		enum EntranceLink_t : uint8_t {
+			LINK_NORTH = 1 << 0,
+			LINK_EAST = 1 << 1,
+			LINK_SOUTH = 1 << 2,
+			LINK_WEST = 1 << 3,
+		};
+
+		struct Entrance {
+			uint8_t x;
+			uint8_t y;
+			uint8_t links;
+		};
+
+		struct Cluster {
+			std::vector<Entrance> entrances;
+			//entrances.size() x entrances.size() walking costs inside the cluster
+			std::vector<int32_t> costs;
+			uint16_t walkable[CLUSTER_SIZE] = {};
+			uint8_t entranceIndex[CLUSTER_SIZE][CLUSTER_SIZE];
+		};
+
+		using CostTable = int32_t[CLUSTER_SIZE][CLUSTER_SIZE];
+
+		static uint64_t getClusterKey(uint32_t x, uint32_t y, uint32_t z) {
+			return static_cast<uint64_t>(z) << 32 | static_cast<uint64_t>(y / CLUSTER_SIZE) << 16 | (x / CLUSTER_SIZE);
+		}
+		static uint64_t getNodeKey(uint32_t x, uint32_t y, uint32_t z) {
+			return static_cast<uint64_t>(z) << 32 | static_cast<uint64_t>(y) << 16 | x;
+		}
+
+		const Cluster& getCluster(uint16_t x, uint16_t y, uint8_t z);
+		void buildCluster(Cluster& cluster, int32_t baseX, int32_t baseY, uint8_t z) const;
+		//walking costs from (x, y) to every tile of the cluster, (x, y) itself counts as walkable
+		static void getCosts(const Cluster& cluster, int32_t x, int32_t y, CostTable& costs);
+
+		const Map& map;
+		std::unordered_map<uint64_t, Cluster> clusters;
+		mutable std::mutex graphLock;
+};
+
+#endif
@@ -0,0 +1,371 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "pathservice.h"
+#include "combat.h"
+#include "game.h"
+#include "housetile.h"
+#include "monster.h"
+#include "tasks.h"
+
+#include <queue>
+
+extern Dispatcher g_dispatcher;
+extern Game g_game;
+
+void PathService::start(const Map& map)
+{
+	map.forEachTile([this](const Tile& tile) {
+		setWalkFlags(tile.getPosition(), getWalkFlags(tile), getFieldType(tile));
+	});
+	snapshotVersion = map.getWalkVersion();
+
+	ThreadHolder<PathService>::start();
+}
+
+void PathService::shutdown()
+{
+	requestLock.lock();
+	setState(THREAD_STATE_TERMINATED);
+	requestLock.unlock();
+	requestSignal.notify_one();
+	join();
+}
+
+bool PathService::canRequestPath(const Creature& creature, const Position& targetPos, const FindPathParams& fpp) const
+{
+	if (!isRunning()) {
+		return false;
+	}
+
+	//the snapshot knows nothing about creatures, sight or the rules of distance keeping
+	const Monster* monster = creature.getMonster();
+	if (!monster || fpp.keepDistance || fpp.maxTargetDist > 1) {
+		return false;
+	}
+	return creature.getPosition().z == targetPos.z;
+}
+
+void PathService::requestPath(Creature& creature, const Position& targetPos, const FindPathParams& fpp)
+{
+	if (creature.hasPendingPath) {
+		return;
+	}
+
+	PathRequest request;
+	request.startPos = creature.getPosition();
+	request.targetPos = targetPos;
+	request.fpp = fpp;
+	request.creatureId = creature.getID();
+	request.followId = creature.getFollowCreature() ? creature.getFollowCreature()->getID() : 0;
+	request.requestId = ++creature.pathRequestId;
+	request.avoidProtection = true;
+
+	//the same fields AStarNodes::getTileWalkCost charges for, canRequestPath only lets monsters through
+	const Monster* monster = creature.getMonster();
+	for (size_t i = 0; i < COMBAT_COUNT; ++i) {
+		CombatType_t combatType = indexToCombatType(i);
+		if (!creature.isImmune(combatType) && !creature.hasCondition(Combat::DamageToConditionType(combatType)) && !monster->canWalkOnFieldType(combatType)) {
+			request.avoidFields |= combatType;
+		}
+	}
+
+	bool signal = false;
+	requestLock.lock();
+	if (getState() == THREAD_STATE_RUNNING) {
+		signal = requests.empty();
+		requests.push_back(std::move(request));
+		//a dropped request would never get a result to clear it
+		creature.hasPendingPath = true;
+	}
+	requestLock.unlock();
+
+	if (signal) {
+		requestSignal.notify_one();
+	}
+}
+
+void PathService::updateTile(const Tile& tile, uint32_t walkVersion)
+{
+	std::lock_guard<std::mutex> lockClass(updateLock);
+	pendingUpdates.push_back({tile.getPosition(), walkVersion, getFieldType(tile), getWalkFlags(tile)});
+}
+
+void PathService::threadMain()
+{
+	std::vector<PathRequest> batch;
+	std::unique_lock<std::mutex> requestLockUnique(requestLock, std::defer_lock);
+	while (getState() != THREAD_STATE_TERMINATED) {
+		requestLockUnique.lock();
+		//shutdown sets the state under the lock, so it can't slip in between the check and the wait
+		requestSignal.wait(requestLockUnique, [this]() {
+			return !requests.empty() || getState() == THREAD_STATE_TERMINATED;
+		});
+		batch.swap(requests);
+		requestLockUnique.unlock();
+
+		if (batch.empty()) {
+			continue;
+		}
+
+		applyUpdates();
+
+		for (PathRequest& request : batch) {
+			auto result = std::make_shared<PathResult>();
+			result->request = std::move(request);
+			findPath(*result);
+			g_dispatcher.addTask(std::bind(&PathService::onPathResult, this, std::move(result)), makeTaskTag(TASK_KIND_PATH));
+		}
+		batch.clear();
+	}
+}
+
+uint8_t PathService::getWalkFlags(const Tile& tile)
+{
+	uint8_t flags = 0;
+	if (tile.getGround() && !tile.hasFlag(TILESTATE_BLOCKSOLID | TILESTATE_IMMOVABLEBLOCKSOLID | TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT |
+	        TILESTATE_NOFIELDBLOCKPATH | TILESTATE_IMMOVABLENOFIELDBLOCKPATH)) {
+		flags |= WALK_OPEN;
+	}
+
+	if (tile.hasFlag(TILESTATE_PROTECTIONZONE) || dynamic_cast<const HouseTile*>(&tile)) {
+		flags |= WALK_PROTECTED;
+	}
+	return flags;
+}
+
+CombatType_t PathService::getFieldType(const Tile& tile)
+{
+	if (const MagicField* field = tile.getFieldItem()) {
+		return field->getCombatType();
+	}
+	return COMBAT_NONE;
+}
+
+void PathService::setWalkFlags(const Position& pos, uint8_t flags, CombatType_t fieldType)
+{
+	SnapshotSector& sector = snapshot[getSectorKey(pos.x, pos.y, pos.z)];
+	const uint16_t bit = 1 << (pos.x & SECTOR_MASK);
+	uint16_t& open = sector.open[pos.y & SECTOR_MASK];
+	uint16_t& protection = sector.protection[pos.y & SECTOR_MASK];
+	uint16_t& field = sector.field[pos.y & SECTOR_MASK];
+	open = (flags & WALK_OPEN) ? (open | bit) : (open & ~bit);
+	protection = (flags & WALK_PROTECTED) ? (protection | bit) : (protection & ~bit);
+
+	if (fieldType != COMBAT_NONE) {
+		field |= bit;
+		fieldTypes[getTileKey(pos.x, pos.y, pos.z)] = fieldType;
+	} else if (field & bit) {
+		field &= ~bit;
+		fieldTypes.erase(getTileKey(pos.x, pos.y, pos.z));
+	}
+}
+
+int32_t PathService::getWalkCost(uint16_t x, uint16_t y, uint8_t z, const PathRequest& request) const
+{
+	auto it = snapshot.find(getSectorKey(x, y, z));
+	if (it == snapshot.end()) {
+		return -1;
+	}
+
+	const SnapshotSector& sector = it->second;
+	const uint16_t bit = 1 << (x & SECTOR_MASK);
+	if (!(sector.open[y & SECTOR_MASK] & bit)) {
+		return -1;
+	}
+
+	if (request.avoidProtection && (sector.protection[y & SECTOR_MASK] & bit)) {
+		return -1;
+	}
+
+	if (request.avoidFields != COMBAT_NONE && (sector.field[y & SECTOR_MASK] & bit)) {
+		auto fieldIt = fieldTypes.find(getTileKey(x, y, z));
+		if (fieldIt != fieldTypes.end() && (request.avoidFields & fieldIt->second)) {
+			return MAP_NORMALWALKCOST * 18;
+		}
+	}
+	return 0;
+}
+
+void PathService::applyUpdates()
+{
+	updateLock.lock();
+	appliedUpdates.swap(pendingUpdates);
+	updateLock.unlock();
+
+	for (const TileUpdate& update : appliedUpdates) {
+		setWalkFlags(update.pos, update.flags, update.fieldType);
+		snapshotVersion = update.walkVersion;
+	}
+	appliedUpdates.clear();
+}
+
+void PathService::findPath(PathResult& result) const
+{
+	const PathRequest& request = result.request;
+	const Position& startPos = request.startPos;
+	const Position& targetPos = request.targetPos;
+	const FindPathParams& fpp = request.fpp;
+
+	result.walkVersion = snapshotVersion;
+
+	struct SearchNode {
+		uint32_t parent = 0;
+		int32_t g = std::numeric_limits<int32_t>::max();
+		bool closed = false;
+	};
+
+	static constexpr int_fast32_t neighbors[8][2] = {
+		{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
+	};
+
+	const int32_t searchDist = (fpp.maxSearchDist != 0 ? fpp.maxSearchDist : Map::maxViewportX * 2);
+	const int32_t minTargetDist = std::max<int32_t>(0, fpp.minTargetDist);
+	const int32_t maxTargetDist = std::max<int32_t>(minTargetDist, fpp.maxTargetDist);
+
+	auto getTargetDist = [&targetPos](int32_t x, int32_t y) {
+		return std::max<int32_t>(std::abs(x - targetPos.x), std::abs(y - targetPos.y));
+	};
+
+	std::unordered_map<uint32_t, SearchNode> nodes;
+	std::priority_queue<std::pair<int32_t, uint32_t>, std::vector<std::pair<int32_t, uint32_t>>, std::greater<std::pair<int32_t, uint32_t>>> openNodes;
+
+	const uint32_t startKey = (static_cast<uint32_t>(startPos.x) << 16) | startPos.y;
+	nodes[startKey].g = 0;
+	openNodes.emplace(0, startKey);
+
+	uint32_t foundKey = 0;
+	size_t expandedNodes = 0;
+	while (!openNodes.empty() && expandedNodes < MAX_SEARCH_NODES) {
+		const uint32_t key = openNodes.top().second;
+		openNodes.pop();
+
+		SearchNode& node = nodes[key];
+		if (node.closed) {
+			continue;
+		}
+
+		node.closed = true;
+		++expandedNodes;
+
+		const int32_t x = key >> 16;
+		const int32_t y = key & 0xFFFF;
+		const int32_t targetDist = getTargetDist(x, y);
+		if (targetDist >= minTargetDist && targetDist <= maxTargetDist) {
+			foundKey = key;
+			result.found = true;
+			break;
+		}
+
+		const int32_t g = node.g;
+		for (const auto& neighbor : neighbors) {
+			const int32_t nextX = x + neighbor[0];
+			const int32_t nextY = y + neighbor[1];
+			if (nextX < 0 || nextY < 0 || nextX > 0xFFFF || nextY > 0xFFFF) {
+				continue;
+			}
+
+			if (std::abs(nextX - startPos.x) > searchDist || std::abs(nextY - startPos.y) > searchDist) {
+				continue;
+			}
+
+			const int32_t walkCost = getWalkCost(nextX, nextY, startPos.z, request);
+			if (walkCost < 0) {
+				continue;
+			}
+
+			//same costs as Map::getPathMatching, diagonal steps pay the extra cost
+			const int32_t cost = walkCost + (neighbor[0] != 0 && neighbor[1] != 0 ? MAP_NORMALWALKCOST + MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+			const uint32_t nextKey = (static_cast<uint32_t>(nextX) << 16) | nextY;
+			SearchNode& nextNode = nodes[nextKey];
+			if (nextNode.closed || g + cost >= nextNode.g) {
+				continue;
+			}
+
+			nextNode.g = g + cost;
+			nextNode.parent = key;
+
+			const int32_t remaining = std::max<int32_t>(0, getTargetDist(nextX, nextY) - maxTargetDist);
+			openNodes.emplace(nextNode.g + remaining * MAP_NORMALWALKCOST, nextKey);
+		}
+	}
+
+	if (!result.found) {
+		return;
+	}
+
+	//the same order Map::getPathMatching returns, the last step first
+	for (uint32_t key = foundKey; key != startKey; key = nodes[key].parent) {
+		const uint32_t parent = nodes[key].parent;
+		const int32_t dx = static_cast<int32_t>(key >> 16) - static_cast<int32_t>(parent >> 16);
+		const int32_t dy = static_cast<int32_t>(key & 0xFFFF) - static_cast<int32_t>(parent & 0xFFFF);
+		if (dx == 1) {
+			result.dirList.push_back(dy == 1 ? DIRECTION_SOUTHEAST : (dy == -1 ? DIRECTION_NORTHEAST : DIRECTION_EAST));
+		} else if (dx == -1) {
+			result.dirList.push_back(dy == 1 ? DIRECTION_SOUTHWEST : (dy == -1 ? DIRECTION_NORTHWEST : DIRECTION_WEST));
+		} else {
+			result.dirList.push_back(dy == 1 ? DIRECTION_SOUTH : DIRECTION_NORTH);
+		}
+	}
+}
+
+void PathService::onPathResult(const std::shared_ptr<PathResult>& result)
+{
+	const PathRequest& request = result->request;
+	Creature* creature = g_game.getCreatureByID(request.creatureId);
+	if (!creature || creature->isRemoved() || creature->pathRequestId != request.requestId) {
+		return;
+	}
+
+	creature->hasPendingPath = false;
+
+	const Creature* followCreature = creature->getFollowCreature();
+	if (!followCreature || followCreature->getID() != request.followId || creature->getPosition() != request.startPos) {
+		return;
+	}
+
+	//a tile changed along the path after the snapshot was taken
+	const Map& map = g_game.map;
+	Position pos = request.startPos;
+	for (auto it = result->dirList.rbegin(), end = result->dirList.rend(); it != end; ++it) {
+		pos = getNextPosition(*it, pos);
+		if (map.getWalkVersion(pos) > result->walkVersion) {
+			return;
+		}
+	}
+
+	//the snapshot knows nothing about creatures, when one stands on the first steps
+	//the path is searched again on the live map like a follow path without the path thread
+	pos = request.startPos;
+	size_t steps = 0;
+	for (auto it = result->dirList.rbegin(), end = result->dirList.rend(); it != end && steps < PATH_CREATURE_CHECK_STEPS; ++it, ++steps) {
+		pos = getNextPosition(*it, pos);
+		if (!map.canWalkTo(*creature, pos)) {
+			std::vector<Direction> dirList;
+			bool partial;
+			bool found = creature->getFollowPath(followCreature->getPosition(), dirList, request.fpp, partial);
+			creature->onFollowPathResult(dirList, found, partial);
+			return;
+		}
+	}
+
+	creature->onFollowPathResult(result->dirList, result->found);
+}
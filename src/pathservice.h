@@ -0,0 +1,135 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_PATHSERVICE_H_8E2B4D61A0C94F7B93D5E1A6C2F08B47
+#define FS_PATHSERVICE_H_8E2B4D61A0C94F7B93D5E1A6C2F08B47
+
+#include <condition_variable>
+#include "thread_holder_base.h"
+#include "creature.h"
+
+class Map;
+class Tile;
+
+struct PathRequest {
+	Position startPos;
+	Position targetPos;
+	FindPathParams fpp;
+	uint32_t creatureId = 0;
+	uint32_t followId = 0;
+	uint32_t requestId = 0;
+	//the field combat types the creature won't step on, they cost as much as in Map::getPathMatching
+	uint16_t avoidFields = COMBAT_NONE;
+	bool avoidProtection = false;
+};
+
+struct PathResult {
+	PathRequest request;
+	std::vector<Direction> dirList;
+	uint32_t walkVersion = 0;
+	bool found = false;
+};
+
+//Searches follow paths on its own thread over a walkability snapshot of the map, results come
+//back as dispatcher tasks and are dropped when a tile along the path changed in the meantime
+class PathService : public ThreadHolder<PathService>
+{
+	public:
+		static constexpr size_t MAX_SEARCH_NODES = 4096;
+		//steps of a result checked against the creatures on the live map
+		static constexpr size_t PATH_CREATURE_CHECK_STEPS = 2;
+
+		PathService() = default;
+
+		// non-copyable
+		PathService(const PathService&) = delete;
+		PathService& operator=(const PathService&) = delete;
+
+		//builds the snapshot from the loaded map and starts the search thread
+		void start(const Map& map);
+		void shutdown();
+
+		bool isRunning() const {
+			return getState() == THREAD_STATE_RUNNING;
+		}
+
+		enum WalkFlags_t : uint8_t {
+			WALK_OPEN = 1 << 0,
+			WALK_PROTECTED = 1 << 1,
+		};
+
+		//walkability of the tile for monsters, creatures left out
+		static uint8_t getWalkFlags(const Tile& tile);
+		static CombatType_t getFieldType(const Tile& tile);
+
+		bool canRequestPath(const Creature& creature, const Position& targetPos, const FindPathParams& fpp) const;
+		//queues a follow path search, the creature keeps walking its current path until the result arrives
+		void requestPath(Creature& creature, const Position& targetPos, const FindPathParams& fpp);
+
+		void updateTile(const Tile& tile, uint32_t walkVersion);
+
+		void threadMain();
+
+	private:
+		struct SnapshotSector {
+			uint16_t open[SECTOR_SIZE] = {};
+			uint16_t protection[SECTOR_SIZE] = {};
+			uint16_t field[SECTOR_SIZE] = {};
+		};
+
+		struct TileUpdate {
+			Position pos;
+			uint32_t walkVersion;
+			CombatType_t fieldType;
+			uint8_t flags;
+		};
+
+		static uint64_t getSectorKey(uint32_t x, uint32_t y, uint32_t z) {
+			return static_cast<uint64_t>(z) << 32 | static_cast<uint64_t>(y / SECTOR_SIZE) << 16 | (x / SECTOR_SIZE);
+		}
+		static uint64_t getTileKey(uint32_t x, uint32_t y, uint32_t z) {
+			return static_cast<uint64_t>(z) << 32 | static_cast<uint64_t>(y) << 16 | x;
+		}
+
+		void setWalkFlags(const Position& pos, uint8_t flags, CombatType_t fieldType);
+		//the extra cost of stepping on the tile, -1 if it can't be walked
+		int32_t getWalkCost(uint16_t x, uint16_t y, uint8_t z, const PathRequest& request) const;
+		void applyUpdates();
+		void findPath(PathResult& result) const;
+		void onPathResult(const std::shared_ptr<PathResult>& result);
+
+		//only touched by the search thread once it runs
+		std::unordered_map<uint64_t, SnapshotSector> snapshot;
+		//the combat type of every field in the snapshot, fields are few and looked up only where the sector has one
+		std::unordered_map<uint64_t, CombatType_t> fieldTypes;
+		uint32_t snapshotVersion = 0;
+
+		//tile changes are collected by the dispatcher and swapped over to the search thread
+		std::vector<TileUpdate> pendingUpdates;
+		std::vector<TileUpdate> appliedUpdates;
+		std::mutex updateLock;
+
+		std::vector<PathRequest> requests;
+		std::mutex requestLock;
+		std::condition_variable requestSignal;
+};
+
+extern PathService g_pathService;
+
+#endif
@@ -1533,6 +1533,9 @@ void Player::setNextWalkActionTask(SchedulerTask* task)
 
 	delete walkTask;
 	walkTask = task;
+	if (walkTask && walkTask->getTag() == makeTaskTag(TASK_KIND_GENERIC)) {
+		walkTask->setTag(makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_PLAYER_ACTION));
+	}
 }
 
 void Player::setNextWalkTask(SchedulerTask* task)
@@ -1543,6 +1546,9 @@ void Player::setNextWalkTask(SchedulerTask* task)
 	}
 
 	if (task) {
+		if (task->getTag() == makeTaskTag(TASK_KIND_GENERIC)) {
+			task->setTag(makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_PLAYER_ACTION));
+		}
 		nextStepEvent = g_scheduler.addEvent(task);
 		resetIdleTime();
 	}
@@ -1556,6 +1562,10 @@ void Player::setNextActionTask(SchedulerTask* task)
 	}
 
 	if (task) {
+		// keep the tag of tasks that already have one, e.g. creature attack
+		if (task->getTag() == makeTaskTag(TASK_KIND_GENERIC)) {
+			task->setTag(makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_PLAYER_ACTION));
+		}
 		actionTaskEvent = g_scheduler.addEvent(task);
 		resetIdleTime();
 	}
@@ -3400,7 +3410,7 @@ void Player::doAttacking(uint32_t)
 			result = Weapon::useFist(this, attackedCreature);
 		}
 
-		SchedulerTask* task = createSchedulerTask(std::max<uint32_t>(SCHEDULER_MINTICKS, delay), std::bind(&Game::checkCreatureAttack, &g_game, getID()));
+		SchedulerTask* task = createSchedulerTask(std::max<uint32_t>(SCHEDULER_MINTICKS, delay), std::bind(&Game::checkCreatureAttack, &g_game, getID()), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_CREATURE_ATTACK));
 		if (!classicSpeed) {
 			setNextActionTask(task);
 		} else {
@@ -106,15 +106,30 @@ bool Protocol::onRecvMessage(NetworkMessage& msg)
 	using ProtocolWeak_ptr = std::weak_ptr<Protocol>;
 	ProtocolWeak_ptr protocolWeak = std::weak_ptr<Protocol>(shared_from_this());
 
-	std::function<void (void)> callback = [protocolWeak, &msg]() {
+	// peek the opcode so the dispatcher statistics can tell packets apart,
+	// an empty packet has none and is never expirable
+	uint8_t opcode = 0;
+	const bool hasOpcode = msg.peekByte(opcode);
+
+	// stale packets are skipped but the connection still has to resume reading
+	std::chrono::steady_clock::time_point expiration;
+	if (hasOpcode && isExpirablePacket(opcode)) {
+		expiration = std::chrono::steady_clock::now() + std::chrono::milliseconds(DISPATCHER_TASK_EXPIRATION);
+	}
+
+	g_dispatcher.addTask([protocolWeak, &msg, opcode, expiration]() {
 		if (auto protocol = protocolWeak.lock()) {
 			if (auto connection = protocol->getConnection()) {
-				protocol->parsePacket(msg);
+				if (expiration.time_since_epoch().count() != 0 && std::chrono::steady_clock::now() > expiration) {
+					g_dispatcher.addExpiredTask(DISPATCHER_LANE_INPUT);
+					protocol->onPacketExpired(opcode);
+				} else {
+					protocol->parsePacket(msg);
+				}
 				connection->resumeWork();
 			}
 		}
-	};
-	g_dispatcher.addTask(callback);
+	}, makeTaskTag(TASK_KIND_PACKET, opcode));
 	return true;
 }
 
@@ -42,6 +42,12 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 
 		virtual void parsePacket(NetworkMessage&) {}
 
+		// packets that are worthless once they waited too long in the dispatcher, e.g. movement
+		virtual bool isExpirablePacket(uint8_t) const {
+			return false;
+		}
+		virtual void onPacketExpired(uint8_t) {}
+
 		virtual void onSendMessage(const OutputMessage_ptr& msg);
 		bool onRecvMessage(NetworkMessage& msg);
 		virtual void onRecvFirstMessage(NetworkMessage& msg) = 0;
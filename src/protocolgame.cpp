@@ -425,9 +425,9 @@ void ProtocolGame::onRecvFirstMessage(NetworkMessage& msg)
 	}
 	
 	#if GAME_FEATURE_SESSIONKEY > 0
-	g_dispatcher.addTask(std::bind(&ProtocolGame::login, getThis(), std::move(accountName), std::move(password), std::move(characterName), std::move(token), tokenTime, operatingSystem, TFCoperatingSystem));
+	g_dispatcher.addTask(std::bind(&ProtocolGame::login, getThis(), std::move(accountName), std::move(password), std::move(characterName), std::move(token), tokenTime, operatingSystem, TFCoperatingSystem), makeTaskTag(TASK_KIND_CONNECTION, CONNECTION_TASK_LOGIN));
 	#else
-	g_dispatcher.addTask(std::bind(&ProtocolGame::login, getThis(), std::move(accountName), std::move(password), std::move(characterName), operatingSystem, TFCoperatingSystem));
+	g_dispatcher.addTask(std::bind(&ProtocolGame::login, getThis(), std::move(accountName), std::move(password), std::move(characterName), operatingSystem, TFCoperatingSystem), makeTaskTag(TASK_KIND_CONNECTION, CONNECTION_TASK_LOGIN));
 	#endif
 }
 
@@ -474,6 +474,35 @@ void ProtocolGame::writeToOutputBuffer(const NetworkMessage& msg)
 	out->append(msg);
 }
 
+bool ProtocolGame::isExpirablePacket(uint8_t recvbyte) const
+{
+	switch (recvbyte) {
+		case 0x64: // autowalk
+		case 0x65: case 0x66: case 0x67: case 0x68: // walk
+		case 0x6A: case 0x6B: case 0x6C: case 0x6D: // diagonal walk
+		case 0xA1: // attack
+		case 0xA2: // follow
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+void ProtocolGame::onPacketExpired(uint8_t recvbyte)
+{
+	if (!player) {
+		return;
+	}
+
+	// the client already predicted the step or target, bring it back in sync
+	if (recvbyte == 0xA1 || recvbyte == 0xA2) {
+		player->sendCancelTarget();
+	} else {
+		player->sendCancelWalk();
+	}
+}
+
 void ProtocolGame::parsePacket(NetworkMessage& msg)
 {
 	if (!acceptPackets || g_game.getGameState() == GAME_STATE_SHUTDOWN || msg.getLength() <= 0) {
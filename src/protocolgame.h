@@ -109,6 +109,8 @@ class ProtocolGame final : public Protocol
 
 		// we have all the parse methods
 		void parsePacket(NetworkMessage& msg) override;
+		bool isExpirablePacket(uint8_t recvbyte) const override;
+		void onPacketExpired(uint8_t recvbyte) override;
 		void onRecvFirstMessage(NetworkMessage& msg) override;
 		void onConnect() override;
 
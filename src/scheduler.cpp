@@ -21,6 +21,217 @@
 
 #include "scheduler.h"
 
+#if GAME_FEATURE_SCHEDULER_TIMING_WHEEL > 0
+Scheduler::Scheduler() : startTime(std::chrono::steady_clock::now()) {}
+
+void Scheduler::threadMain()
+{
+	const auto tickDuration = std::chrono::milliseconds(SCHEDULER_WHEEL_RESOLUTION);
+	std::vector<SchedulerTask*> expired;
+
+	std::unique_lock<std::mutex> eventLockUnique(eventLock);
+	auto nextTick = startTime + tickDuration * (currentTick + 1);
+	while (getState() != THREAD_STATE_TERMINATED) {
+		eventSignal.wait_until(eventLockUnique, nextTick);
+		if (getState() == THREAD_STATE_TERMINATED) {
+			break;
+		}
+
+		// catch up on every tick that elapsed, a late wakeup must not reorder events
+		const auto now = std::chrono::steady_clock::now();
+		while (nextTick <= now) {
+			advance(expired);
+			nextTick += tickDuration;
+		}
+
+		if (!expired.empty()) {
+			eventLockUnique.unlock();
+			for (SchedulerTask* task : expired) {
+				g_dispatcher.addTask(task);
+			}
+			expired.clear();
+			eventLockUnique.lock();
+		}
+	}
+
+	clearWheel();
+}
+
+uint64_t Scheduler::addEvent(SchedulerTask* task)
+{
+	std::lock_guard<std::mutex> lockClass(eventLock);
+
+	// the wheel has been cleared or is about to be, nothing would ever run or delete the task
+	if (getState() == THREAD_STATE_TERMINATED) {
+		delete task;
+		return 0;
+	}
+
+	uint32_t index = allocateSlot();
+	if (index == INVALID_SLOT) {
+		std::cout << "[Error - Scheduler::addEvent] Too many scheduled events." << std::endl;
+		delete task;
+		return 0;
+	}
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+	const uint64_t expiration = static_cast<uint64_t>((elapsed + task->getDelay() + SCHEDULER_WHEEL_RESOLUTION - 1) / SCHEDULER_WHEEL_RESOLUTION);
+
+	EventSlot& slot = getSlot(index);
+	slot.task = task;
+	slot.expiration = std::max<uint64_t>(expiration, currentTick + 1);
+	insertSlot(index);
+
+	const uint64_t eventId = (static_cast<uint64_t>(slot.tag.load(std::memory_order_relaxed) >> 1) << 32) | index;
+	task->setEventId(eventId);
+	return eventId;
+}
+
+void Scheduler::stopEvent(uint64_t eventId)
+{
+	const uint32_t index = static_cast<uint32_t>(eventId);
+	if (eventId == 0 || index >= slotCount.load(std::memory_order_acquire)) {
+		return;
+	}
+
+	// the event either fires or gets cancelled, whichever swaps the tag first
+	uint32_t tag = static_cast<uint32_t>(eventId >> 32) << 1;
+	getSlot(index).tag.compare_exchange_strong(tag, tag | 1, std::memory_order_acq_rel);
+}
+
+void Scheduler::shutdown()
+{
+	std::lock_guard<std::mutex> lockClass(eventLock);
+	setState(THREAD_STATE_TERMINATED);
+	eventSignal.notify_one();
+}
+
+uint32_t Scheduler::allocateSlot()
+{
+	if (freeSlot != INVALID_SLOT) {
+		uint32_t index = freeSlot;
+		freeSlot = getSlot(index).next;
+		return index;
+	}
+
+	uint32_t index = slotCount.load(std::memory_order_relaxed);
+	if ((index & (SLOT_CHUNK_SIZE - 1)) == 0) {
+		if ((index >> SLOT_CHUNK_BITS) >= SLOT_MAX_CHUNKS) {
+			return INVALID_SLOT;
+		}
+		slotChunks[index >> SLOT_CHUNK_BITS].reset(new EventSlot[SLOT_CHUNK_SIZE]);
+	}
+
+	slotCount.store(index + 1, std::memory_order_release);
+	return index;
+}
+
+void Scheduler::releaseSlot(uint32_t index)
+{
+	EventSlot& slot = getSlot(index);
+	slot.task = nullptr;
+
+	// generation 0 is skipped so an event id is never 0
+	uint32_t generation = (slot.tag.load(std::memory_order_relaxed) >> 1) + 1;
+	if ((generation & 0x7FFFFFFF) == 0) {
+		generation = 1;
+	}
+	slot.tag.store(generation << 1, std::memory_order_release);
+
+	slot.next = freeSlot;
+	freeSlot = index;
+}
+
+void Scheduler::insertSlot(uint32_t index)
+{
+	EventSlot& slot = getSlot(index);
+
+	// events beyond the range of the top level are parked in its farthest bucket and re-cascaded
+	const uint64_t delta = std::min<uint64_t>(slot.expiration - currentTick, (UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1);
+	const uint64_t bucketTick = currentTick + delta;
+
+	uint32_t level = 0;
+	while (level + 1 < WHEEL_LEVELS && delta >= (UINT64_C(1) << (WHEEL_BITS * (level + 1)))) {
+		++level;
+	}
+
+	Bucket& bucket = wheel[level][(bucketTick >> (WHEEL_BITS * level)) & WHEEL_MASK];
+	slot.next = INVALID_SLOT;
+	if (bucket.tail == INVALID_SLOT) {
+		bucket.head = index;
+	} else {
+		getSlot(bucket.tail).next = index;
+	}
+	bucket.tail = index;
+}
+
+void Scheduler::cascade(uint32_t level)
+{
+	Bucket& bucket = wheel[level][(currentTick >> (WHEEL_BITS * level)) & WHEEL_MASK];
+	uint32_t index = bucket.head;
+	bucket = Bucket();
+
+	while (index != INVALID_SLOT) {
+		uint32_t next = getSlot(index).next;
+		insertSlot(index);
+		index = next;
+	}
+}
+
+void Scheduler::advance(std::vector<SchedulerTask*>& expired)
+{
+	++currentTick;
+
+	for (uint32_t level = 1; level < WHEEL_LEVELS; ++level) {
+		if (((currentTick >> (WHEEL_BITS * (level - 1))) & WHEEL_MASK) != 0) {
+			break;
+		}
+		cascade(level);
+	}
+
+	Bucket& bucket = wheel[0][currentTick & WHEEL_MASK];
+	uint32_t index = bucket.head;
+	bucket = Bucket();
+
+	while (index != INVALID_SLOT) {
+		EventSlot& slot = getSlot(index);
+		uint32_t next = slot.next;
+		if (slot.expiration > currentTick) {
+			// parked event that still lies beyond the wheel range
+			insertSlot(index);
+			index = next;
+			continue;
+		}
+
+		uint32_t tag = slot.tag.load(std::memory_order_acquire) & ~1u;
+		if (slot.tag.compare_exchange_strong(tag, tag | 1, std::memory_order_acq_rel)) {
+			expired.push_back(slot.task);
+		} else {
+			delete slot.task;
+		}
+
+		releaseSlot(index);
+		index = next;
+	}
+}
+
+void Scheduler::clearWheel()
+{
+	for (auto& level : wheel) {
+		for (Bucket& bucket : level) {
+			uint32_t index = bucket.head;
+			while (index != INVALID_SLOT) {
+				EventSlot& slot = getSlot(index);
+				uint32_t next = slot.next;
+				delete slot.task;
+				releaseSlot(index);
+				index = next;
+			}
+			bucket = Bucket();
+		}
+	}
+}
+#else
 void Scheduler::threadMain()
 {
 	io_service.run();
@@ -28,6 +239,12 @@ void Scheduler::threadMain()
 
 uint64_t Scheduler::addEvent(SchedulerTask* task)
 {
+	// the io_service may already be stopped, nothing would ever run or delete the task
+	if (getState() == THREAD_STATE_TERMINATED) {
+		delete task;
+		return 0;
+	}
+
 	if (task->getEventId() == 0) {
 		task->setEventId(++lastEventId);
 	}
@@ -89,7 +306,4 @@ void Scheduler::shutdown()
 	});
 }
 
-SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f)
-{
-	return new SchedulerTask(delay, std::move(f));
-}
+#endif
@@ -23,11 +23,18 @@
 #include "tasks.h"
 #include <unordered_map>
 #include <atomic>
+#include <array>
+#include <limits>
 
 #include "thread_holder_base.h"
 
 static constexpr int32_t SCHEDULER_MINTICKS = 50;
 
+class SchedulerTask;
+
+template <typename F>
+SchedulerTask* createSchedulerTask(uint32_t delay, F&& f, uint16_t tag = makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_GENERIC));
+
 class SchedulerTask : public Task
 {
 	public:
@@ -42,16 +49,90 @@ class SchedulerTask : public Task
 		}
 
 	private:
-		SchedulerTask(uint32_t delay, std::function<void (void)>&& f) : Task(std::move(f)), delay(delay) {}
+		SchedulerTask(uint32_t delay, TaskFunction&& f, uint16_t tag) : Task(std::move(f), tag), delay(delay) {}
 
 		uint64_t eventId = 0;
 		uint32_t delay = 0;
 
-		friend SchedulerTask* createSchedulerTask(uint32_t, std::function<void (void)>);
+		template <typename F>
+		friend SchedulerTask* createSchedulerTask(uint32_t, F&&, uint16_t);
 };
 
-SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f);
+template <typename F>
+SchedulerTask* createSchedulerTask(uint32_t delay, F&& f, uint16_t tag)
+{
+	return new SchedulerTask(delay, TaskFunction(std::forward<F>(f)), tag);
+}
+
+#if GAME_FEATURE_SCHEDULER_TIMING_WHEEL > 0
+static constexpr int64_t SCHEDULER_WHEEL_RESOLUTION = 5;
+
+class Scheduler : public ThreadHolder<Scheduler>
+{
+	public:
+		Scheduler();
+
+		// non-copyable
+		Scheduler(const Scheduler&) = delete;
+		Scheduler& operator=(const Scheduler&) = delete;
+
+		uint64_t addEvent(SchedulerTask* task);
+		void stopEvent(uint64_t eventId);
+
+		void shutdown();
+
+		void threadMain();
+
+	private:
+		static constexpr uint32_t WHEEL_BITS = 8;
+		static constexpr uint32_t WHEEL_SIZE = 1 << WHEEL_BITS;
+		static constexpr uint32_t WHEEL_MASK = WHEEL_SIZE - 1;
+		static constexpr uint32_t WHEEL_LEVELS = 4;
+		static constexpr uint32_t SLOT_CHUNK_BITS = 12;
+		static constexpr uint32_t SLOT_CHUNK_SIZE = 1 << SLOT_CHUNK_BITS;
+		static constexpr uint32_t SLOT_MAX_CHUNKS = 4096;
+		static constexpr uint32_t INVALID_SLOT = std::numeric_limits<uint32_t>::max();
+
+		// tag holds the generation of the slot shifted left by one and the
+		// cancelled flag in the lowest bit, so the event id of a recycled
+		// slot never matches and stopEvent is a single compare-and-swap
+		struct EventSlot {
+			SchedulerTask* task = nullptr;
+			uint64_t expiration = 0;
+			uint32_t next = INVALID_SLOT;
+			std::atomic<uint32_t> tag {1 << 1};
+		};
+
+		// events are appended at the tail, so the ones due in the same tick fire in the order they were added
+		struct Bucket {
+			uint32_t head = INVALID_SLOT;
+			uint32_t tail = INVALID_SLOT;
+		};
+
+		EventSlot& getSlot(uint32_t index) const {
+			return slotChunks[index >> SLOT_CHUNK_BITS][index & (SLOT_CHUNK_SIZE - 1)];
+		}
+
+		uint32_t allocateSlot();
+		void releaseSlot(uint32_t index);
+		void insertSlot(uint32_t index);
+		void cascade(uint32_t level);
+		void advance(std::vector<SchedulerTask*>& expired);
+		void clearWheel();
+
+		std::thread thread;
+		std::mutex eventLock;
+		std::condition_variable eventSignal;
 
+		std::array<std::unique_ptr<EventSlot[]>, SLOT_MAX_CHUNKS> slotChunks;
+		std::atomic<uint32_t> slotCount {0};
+		uint32_t freeSlot = INVALID_SLOT;
+
+		std::array<std::array<Bucket, WHEEL_SIZE>, WHEEL_LEVELS> wheel;
+		uint64_t currentTick = 0;
+		std::chrono::steady_clock::time_point startTime;
+};
+#else
 class Scheduler : public ThreadHolder<Scheduler>
 {
 	public:
@@ -69,6 +150,7 @@ class Scheduler : public ThreadHolder<Scheduler>
 		boost::asio::io_service io_service;
 		boost::asio::io_service::work work{ io_service };
 };
+#endif
 
 extern Scheduler g_scheduler;
 
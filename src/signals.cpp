@@ -182,6 +182,8 @@ void Signals::sighupHandler()
 	g_weapons->loadDefaults();
 	std::cout << "Reloaded weapons." << std::endl;
 
+	Item::clearDescriptionCache();
+
 	g_game.quests.reload();
 	std::cout << "Reloaded quests." << std::endl;
 
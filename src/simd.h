@@ -73,8 +73,22 @@ __forceinline unsigned int _mm_ctz(unsigned int value)
 	_BitScanForward(&i, value);
 	return static_cast<unsigned int>(i);
 }
+__forceinline unsigned int _mm_msb(unsigned int value)
+{
+	unsigned long i = 0;
+	_BitScanReverse(&i, value);
+	return static_cast<unsigned int>(i);
+}
+__forceinline unsigned int _mm_popcount(unsigned int value)
+{
+	value = value - ((value >> 1) & 0x55555555);
+	value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+	return (((value + (value >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
 #else
 #define _mm_ctz __builtin_ctz
+#define _mm_msb(value) (31 ^ __builtin_clz(value))
+#define _mm_popcount __builtin_popcount
 #endif
 
 #endif
@@ -170,7 +170,7 @@ bool Spawns::isInZone(const Position& centerPos, int32_t radius, const Position&
 void Spawn::startSpawnCheck()
 {
 	if (checkSpawnEvent == 0) {
-		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), std::bind(&Spawn::checkSpawn, this)));
+		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), std::bind(&Spawn::checkSpawn, this), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_SPAWN)));
 	}
 }
 
@@ -274,7 +274,7 @@ void Spawn::checkSpawn()
 	}
 
 	if (spawnedCount < spawnMap.size()) {
-		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), std::bind(&Spawn::checkSpawn, this)));
+		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), std::bind(&Spawn::checkSpawn, this), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_SPAWN)));
 	}
 }
 
@@ -292,7 +292,7 @@ void Spawn::scheduleSpawn(uint32_t spawnId, int32_t interval)
 		}
 	} else {
 		g_game.addMagicEffect(sb.pos, CONST_ME_TELEPORT);
-		g_scheduler.addEvent(createSchedulerTask(1500, std::bind(&Spawn::scheduleSpawn, this, spawnId, interval - 1500)));
+		g_scheduler.addEvent(createSchedulerTask(1500, std::bind(&Spawn::scheduleSpawn, this, spawnId, interval - 1500), makeTaskTag(TASK_KIND_SCHEDULER, SCHEDULER_EVENT_SPAWN)));
 	}
 }
 
@@ -20,61 +20,265 @@
 #include "otpch.h"
 
 #include "tasks.h"
+#include "scheduler.h"
 #include "game.h"
+#include "lockfree.h"
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
 
 extern Game g_game;
 
-Task* createTask(std::function<void (void)> f)
+const uint16_t TASK_FREE_LIST_CAPACITY = 4096;
+const uint16_t TASK_LOCAL_CACHE_CAPACITY = 256;
+const size_t TASK_BLOCK_SIZE = sizeof(SchedulerTask) > sizeof(Task) ? sizeof(SchedulerTask) : sizeof(Task);
+
+using TaskFreeList = LockfreeFreeList<TASK_BLOCK_SIZE, TASK_FREE_LIST_CAPACITY>;
+
+namespace {
+
+struct TaskLocalCache
+{
+	~TaskLocalCache() {
+		auto& freeList = TaskFreeList::get();
+		for (void* p : blocks) {
+			if (!freeList.bounded_push(p)) {
+				::operator delete(p);
+			}
+		}
+	}
+
+	std::vector<void*> blocks;
+};
+
+thread_local TaskLocalCache taskLocalCache;
+
+std::atomic<uint64_t> taskHeapFallbacks {0};
+std::mutex taskHeapFallbackLock;
+std::map<std::string, uint64_t> taskHeapFallbackSites;
+
+std::string demangleTypeName(const std::string& name)
 {
-	return new Task(std::move(f));
+#ifdef __GNUG__
+	int status = 0;
+	std::unique_ptr<char, void(*)(void*)> demangled(abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status), std::free);
+	if (status == 0) {
+		return demangled.get();
+	}
+#endif
+	return name;
 }
 
-void Dispatcher::threadMain()
+}
+
+void* Task::operator new(size_t size)
 {
-	io_service.run();
-	g_database.disconnect();
+	if (size > TASK_BLOCK_SIZE) {
+		return ::operator new(size);
+	}
+
+	auto& blocks = taskLocalCache.blocks;
+	if (!blocks.empty()) {
+		void* p = blocks.back();
+		blocks.pop_back();
+		return p;
+	}
+
+	void* p; // NOTE: p doesn't have to be initialized
+	if (!TaskFreeList::get().pop(p)) {
+		p = ::operator new(TASK_BLOCK_SIZE);
+	}
+	return p;
 }
 
-void Dispatcher::addTask(std::function<void (void)> functor)
+void Task::operator delete(void* p, size_t size)
 {
-	#if BOOST_VERSION >= 106600
-	boost::asio::post(io_service,
-	#else
-	io_service.post(
-	#endif
-	[this, functor]() {
-		++dispatcherCycle;
+	if (size > TASK_BLOCK_SIZE) {
+		::operator delete(p);
+		return;
+	}
 
-		// execute it
-		(functor)();
-	});
+	auto& blocks = taskLocalCache.blocks;
+	if (blocks.size() < TASK_LOCAL_CACHE_CAPACITY) {
+		blocks.push_back(p);
+		return;
+	}
+
+	if (!TaskFreeList::get().bounded_push(p)) {
+		::operator delete(p);
+	}
 }
 
-void Dispatcher::addTask(Task* task)
+void TaskFunction::recordHeapFallback(const char* site)
 {
-	#if BOOST_VERSION >= 106600
-	boost::asio::post(io_service,
-	#else
-	io_service.post(
-	#endif
-	[this, task]() {
+	++taskHeapFallbacks;
+
+	std::lock_guard<std::mutex> lockClass(taskHeapFallbackLock);
+	++taskHeapFallbackSites[site];
+}
+
+uint64_t TaskFunction::getHeapFallbacks()
+{
+	return taskHeapFallbacks.load(std::memory_order_relaxed);
+}
+
+std::vector<std::pair<std::string, uint64_t>> TaskFunction::getHeapFallbackSites()
+{
+	std::lock_guard<std::mutex> lockClass(taskHeapFallbackLock);
+	std::vector<std::pair<std::string, uint64_t>> sites;
+	sites.reserve(taskHeapFallbackSites.size());
+	for (const auto& it : taskHeapFallbackSites) {
+		sites.emplace_back(demangleTypeName(it.first), it.second);
+	}
+	return sites;
+}
+
+void Dispatcher::threadMain()
+{
+	std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
+
+	while (getState() != THREAD_STATE_TERMINATED) {
+		taskLockUnique.lock();
+
+		Task* task = popTask();
+		if (!task) {
+			taskSignal.wait(taskLockUnique);
+			taskLockUnique.unlock();
+			continue;
+		}
+
+		taskLockUnique.unlock();
+
 		++dispatcherCycle;
 
+		const auto start = std::chrono::steady_clock::now();
+
 		// execute it
 		(*task)();
+
+		const auto end = std::chrono::steady_clock::now();
+		stats.record(task->getTag(),
+			static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(start - task->getEnqueueTime()).count()),
+			static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()),
+			taskBudget.load(std::memory_order_relaxed));
 		delete task;
-	});
+	}
+
+	// the terminate task only ran on empty lanes, so these were added after it
+	for (auto& lane : lanes) {
+		for (Task* task : lane) {
+			delete task;
+		}
+		lane.clear();
+	}
+
+	g_database.disconnect();
+}
+
+void Dispatcher::addTask(Task* task)
+{
+	pushTask(task, getTaskLane(task->getTag()));
+}
+
+void Dispatcher::pushTask(Task* task, DispatcherLane_t lane)
+{
+	task->setEnqueueTime(std::chrono::steady_clock::now());
+
+	DispatcherLaneStats& laneStat = laneStats[lane];
+
+	bool doSignal;
+	{
+		std::lock_guard<std::mutex> lockClass(taskLock);
+		doSignal = lanes[DISPATCHER_LANE_INPUT].empty() && lanes[DISPATCHER_LANE_TIMER].empty() && lanes[DISPATCHER_LANE_BACKGROUND].empty();
+		lanes[lane].push_back(task);
+
+		const uint32_t depth = static_cast<uint32_t>(lanes[lane].size());
+		laneStat.depth.store(depth, std::memory_order_relaxed);
+		if (depth > laneStat.maxDepth.load(std::memory_order_relaxed)) {
+			laneStat.maxDepth.store(depth, std::memory_order_relaxed);
+		}
+	}
+
+	// the dispatcher thread only sleeps on an empty queue
+	if (doSignal) {
+		taskSignal.notify_one();
+	}
 }
 
 void Dispatcher::shutdown()
 {
-	#if BOOST_VERSION >= 106600
-	boost::asio::post(io_service,
-	#else
-	io_service.post(
-	#endif
-	[this]() {
+	Task* task = createTask([this]() {
 		setState(THREAD_STATE_TERMINATED);
-		io_service.stop();
 	});
+	task->setEnqueueTime(std::chrono::steady_clock::now());
+
+	bool doSignal;
+	{
+		std::lock_guard<std::mutex> lockClass(taskLock);
+		doSignal = lanes[DISPATCHER_LANE_INPUT].empty() && lanes[DISPATCHER_LANE_TIMER].empty() && lanes[DISPATCHER_LANE_BACKGROUND].empty();
+		terminateTask = task;
+	}
+
+	if (doSignal) {
+		taskSignal.notify_one();
+	}
+}
+
+DispatcherLane_t Dispatcher::getTaskLane(uint16_t tag)
+{
+	// packets run in the order they were added together with the connection tasks and the
+	// follow-up tasks tagged with their packet, everything else may be overtaken by them
+	switch (static_cast<TaskKind_t>(tag >> 8)) {
+		case TASK_KIND_PACKET:
+		case TASK_KIND_CONNECTION:
+			return DISPATCHER_LANE_INPUT;
+
+		case TASK_KIND_DATABASE:
+		case TASK_KIND_PATH:
+			return DISPATCHER_LANE_BACKGROUND;
+
+		default:
+			return DISPATCHER_LANE_TIMER;
+	}
+}
+
+Task* Dispatcher::popTask()
+{
+	for (uint8_t lane = DISPATCHER_LANE_INPUT; lane < DISPATCHER_LANE_LAST; ++lane) {
+		std::deque<Task*>& tasks = lanes[lane];
+		if (tasks.empty()) {
+			continue;
+		}
+
+		if (laneBurst[lane] >= DISPATCHER_LANE_BURST[lane]) {
+			bool lowerWaiting = false;
+			for (uint8_t lower = lane + 1; lower < DISPATCHER_LANE_LAST; ++lower) {
+				if (!lanes[lower].empty()) {
+					lowerWaiting = true;
+					break;
+				}
+			}
+
+			laneBurst[lane] = 0;
+			if (lowerWaiting) {
+				continue;
+			}
+		}
+
+		++laneBurst[lane];
+
+		Task* task = tasks.front();
+		tasks.pop_front();
+
+		DispatcherLaneStats& laneStat = laneStats[lane];
+		laneStat.depth.store(static_cast<uint32_t>(tasks.size()), std::memory_order_relaxed);
+		laneStat.executed.fetch_add(1, std::memory_order_relaxed);
+		return task;
+	}
+
+	// every task that was added before shutdown has run
+	Task* task = terminateTask;
+	terminateTask = nullptr;
+	return task;
 }
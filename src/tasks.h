@@ -21,35 +21,220 @@
 #define FS_TASKS_H_A66AC384766041E59DCA059DAB6E1976
 
 #include <condition_variable>
+#include <deque>
+#include <typeinfo>
 #include "thread_holder_base.h"
 #include "enums.h"
+#include "taskstats.h"
 
 const int DISPATCHER_TASK_EXPIRATION = 2000;
 const auto SYSTEM_TIME_ZERO = std::chrono::system_clock::time_point(std::chrono::milliseconds(0));
 
+// large enough for std::bind of a member function pointer, an object pointer and a few ids/positions
+static constexpr size_t TASK_FUNCTION_INLINE_SIZE = 64;
+
+// move-only callable with inline storage, callables that don't fit fall back to the heap
+class TaskFunction
+{
+	public:
+		TaskFunction() = default;
+
+		template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, TaskFunction>::value>::type>
+		TaskFunction(F&& f) {
+			using Functor = typename std::decay<F>::type;
+			emplace<Functor>(std::forward<F>(f), std::integral_constant<bool, fitsInline<Functor>()>());
+		}
+
+		TaskFunction(TaskFunction&& rhs) noexcept : ops(rhs.ops) {
+			if (ops) {
+				ops->move(storage, rhs.storage);
+				rhs.ops = nullptr;
+			}
+		}
+		TaskFunction& operator=(TaskFunction&& rhs) noexcept {
+			if (this != &rhs) {
+				reset();
+				ops = rhs.ops;
+				if (ops) {
+					ops->move(storage, rhs.storage);
+					rhs.ops = nullptr;
+				}
+			}
+			return *this;
+		}
+
+		// non-copyable
+		TaskFunction(const TaskFunction&) = delete;
+		TaskFunction& operator=(const TaskFunction&) = delete;
+
+		~TaskFunction() {
+			reset();
+		}
+
+		void operator()() {
+			ops->invoke(storage);
+		}
+
+		explicit operator bool() const {
+			return ops != nullptr;
+		}
+
+		static uint64_t getHeapFallbacks();
+		// sites are the functor types, demangled they name the bound function or the function
+		// the lambda was written in, the task tag is often only set after construction
+		static std::vector<std::pair<std::string, uint64_t>> getHeapFallbackSites();
+
+	private:
+		struct Operations {
+			void (*invoke)(void*);
+			void (*move)(void*, void*);
+			void (*destroy)(void*);
+		};
+
+		template <typename Functor>
+		static constexpr bool fitsInline() {
+			return sizeof(Functor) <= TASK_FUNCTION_INLINE_SIZE && alignof(Functor) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<Functor>::value;
+		}
+
+		template <typename Functor>
+		struct InlineOperations {
+			static void invoke(void* p) {
+				(*static_cast<Functor*>(p))();
+			}
+			static void move(void* dst, void* src) {
+				new (dst) Functor(std::move(*static_cast<Functor*>(src)));
+				static_cast<Functor*>(src)->~Functor();
+			}
+			static void destroy(void* p) {
+				static_cast<Functor*>(p)->~Functor();
+			}
+			static const Operations operations;
+		};
+
+		template <typename Functor>
+		struct HeapOperations {
+			static void invoke(void* p) {
+				(**static_cast<Functor**>(p))();
+			}
+			static void move(void* dst, void* src) {
+				*static_cast<Functor**>(dst) = *static_cast<Functor**>(src);
+			}
+			static void destroy(void* p) {
+				delete *static_cast<Functor**>(p);
+			}
+			static const Operations operations;
+		};
+
+		template <typename Functor, typename F>
+		void emplace(F&& f, std::true_type) {
+			new (storage) Functor(std::forward<F>(f));
+			ops = &InlineOperations<Functor>::operations;
+		}
+
+		template <typename Functor, typename F>
+		void emplace(F&& f, std::false_type) {
+			recordHeapFallback(typeid(Functor).name());
+			*reinterpret_cast<Functor**>(storage) = new Functor(std::forward<F>(f));
+			ops = &HeapOperations<Functor>::operations;
+		}
+
+		void reset() {
+			if (ops) {
+				ops->destroy(storage);
+				ops = nullptr;
+			}
+		}
+
+		static void recordHeapFallback(const char* site);
+
+		alignas(std::max_align_t) unsigned char storage[TASK_FUNCTION_INLINE_SIZE];
+		const Operations* ops = nullptr;
+};
+
+template <typename Functor>
+const TaskFunction::Operations TaskFunction::InlineOperations<Functor>::operations = {
+	&TaskFunction::InlineOperations<Functor>::invoke,
+	&TaskFunction::InlineOperations<Functor>::move,
+	&TaskFunction::InlineOperations<Functor>::destroy
+};
+
+template <typename Functor>
+const TaskFunction::Operations TaskFunction::HeapOperations<Functor>::operations = {
+	&TaskFunction::HeapOperations<Functor>::invoke,
+	&TaskFunction::HeapOperations<Functor>::move,
+	&TaskFunction::HeapOperations<Functor>::destroy
+};
+
 class Task
 {
 	public:
 		// DO NOT allocate this class on the stack
-		explicit Task(std::function<void (void)>&& f) : func(std::move(f)) {}
+		explicit Task(TaskFunction&& f, uint16_t tag = 0) : func(std::move(f)), tag(tag) {}
 
 		virtual ~Task() = default;
 		void operator()() {
 			func();
 		}
 
+		void setTag(uint16_t newTag) {
+			tag = newTag;
+		}
+		uint16_t getTag() const {
+			return tag;
+		}
+
+		void setEnqueueTime(std::chrono::steady_clock::time_point time) {
+			enqueueTime = time;
+		}
+		std::chrono::steady_clock::time_point getEnqueueTime() const {
+			return enqueueTime;
+		}
+
+		// tasks and scheduler tasks are recycled through a per-thread cache backed by a lock-free free list,
+		// the virtual destructor passes the size of the actual type so bigger subclasses go back to the heap
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+
 	private:
 		// Expiration has another meaning for scheduler tasks,
 		// then it is the time the task should be added to the
 		// dispatcher
-		std::function<void (void)> func;
+		TaskFunction func;
+		std::chrono::steady_clock::time_point enqueueTime;
+		uint16_t tag;
 };
 
-Task* createTask(std::function<void (void)> f);
+// a tag identifies the kind of work a task does for the dispatcher statistics,
+// the detail is the packet opcode or the scheduler event type
+static constexpr uint16_t makeTaskTag(TaskKind_t kind, uint8_t detail = 0)
+{
+	return static_cast<uint16_t>((kind << 8) | detail);
+}
+
+template <typename F>
+Task* createTask(F&& f, uint16_t tag = makeTaskTag(TASK_KIND_GENERIC))
+{
+	return new Task(TaskFunction(std::forward<F>(f)), tag);
+}
+
+// player input is served first, but after a burst of consecutive tasks from one
+// lane a waiting lower lane gets one task through so it can't starve
+static constexpr uint32_t DISPATCHER_LANE_BURST[DISPATCHER_LANE_LAST] = {8, 4, 1};
+
+struct DispatcherLaneStats
+{
+	std::atomic<uint32_t> depth {0};
+	std::atomic<uint32_t> maxDepth {0};
+	std::atomic<uint64_t> executed {0};
+	std::atomic<uint64_t> expired {0};
+};
 
 class Dispatcher : public ThreadHolder<Dispatcher> {
 	public:
-		void addTask(std::function<void (void)> functor);
+		template <typename F, typename = typename std::enable_if<!std::is_convertible<F, Task*>::value>::type>
+		void addTask(F&& functor, uint16_t tag = makeTaskTag(TASK_KIND_GENERIC)) {
+			addTask(createTask(std::forward<F>(functor), tag));
+		}
 		void addTask(Task* task);
 
 		void shutdown();
@@ -58,13 +243,42 @@ class Dispatcher : public ThreadHolder<Dispatcher> {
 			return dispatcherCycle;
 		}
 
+		DispatcherStats& getStats() {
+			return stats;
+		}
+
+		// budget in milliseconds, cached on config load so the dispatcher loop does not read the config per task
+		void setTaskBudget(uint32_t budget) {
+			taskBudget.store(budget * 1000, std::memory_order_relaxed);
+		}
+
+		const DispatcherLaneStats& getLaneStats(DispatcherLane_t lane) const {
+			return laneStats[lane];
+		}
+		void addExpiredTask(DispatcherLane_t lane) {
+			laneStats[lane].expired.fetch_add(1, std::memory_order_relaxed);
+		}
+
 		void threadMain();
 
 	private:
+		static DispatcherLane_t getTaskLane(uint16_t tag);
+		void pushTask(Task* task, DispatcherLane_t lane);
+		Task* popTask();
+
 		std::thread thread;
+		std::mutex taskLock;
+		std::condition_variable taskSignal;
+
+		std::deque<Task*> lanes[DISPATCHER_LANE_LAST];
+		// runs once every lane is empty
+		Task* terminateTask = nullptr;
+		uint32_t laneBurst[DISPATCHER_LANE_LAST] = {};
+		DispatcherLaneStats laneStats[DISPATCHER_LANE_LAST];
+
 		uint64_t dispatcherCycle = 0;
-		boost::asio::io_service io_service;
-		boost::asio::io_service::work work{ io_service };
+		std::atomic<uint32_t> taskBudget {0};
+		DispatcherStats stats;
 };
 
 extern Dispatcher g_dispatcher;
@@ -0,0 +1,232 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <cmath>
+
+#include "taskstats.h"
+#include "tools.h"
+
+void LatencyHistogram::record(uint32_t value)
+{
+	buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	total.fetch_add(value, std::memory_order_relaxed);
+
+	uint32_t currentMax = max.load(std::memory_order_relaxed);
+	while (value > currentMax && !max.compare_exchange_weak(currentMax, value, std::memory_order_relaxed));
+}
+
+void LatencyHistogram::reset()
+{
+	for (auto& bucket : buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	count.store(0, std::memory_order_relaxed);
+	total.store(0, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+}
+
+uint32_t LatencyHistogram::getPercentile(double percentile) const
+{
+	const uint64_t samples = getCount();
+	if (samples == 0) {
+		return 0;
+	}
+
+	const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(samples * percentile / 100.)));
+	uint64_t seen = 0;
+	for (uint32_t index = 0; index < BUCKET_COUNT; ++index) {
+		seen += buckets[index].load(std::memory_order_relaxed);
+		if (seen >= rank) {
+			return std::min<uint32_t>(getBucketValue(index), getMax());
+		}
+	}
+	return getMax();
+}
+
+uint32_t LatencyHistogram::getBucketIndex(uint32_t value)
+{
+	if (value < SUB_BUCKET_COUNT) {
+		return value;
+	}
+
+	const uint32_t msb = _mm_msb(value);
+	return (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + ((value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1));
+}
+
+uint32_t LatencyHistogram::getBucketValue(uint32_t index)
+{
+	if (index < SUB_BUCKET_COUNT) {
+		return index;
+	}
+
+	// highest value that still falls into the bucket
+	const uint32_t shift = index / SUB_BUCKET_COUNT - 1;
+	const uint64_t lowest = static_cast<uint64_t>(SUB_BUCKET_COUNT | (index & (SUB_BUCKET_COUNT - 1))) << shift;
+	return static_cast<uint32_t>(lowest + (UINT64_C(1) << shift) - 1);
+}
+
+DispatcherStats::DispatcherStats()
+{
+	for (auto& tag : tags) {
+		tag.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+DispatcherStats::~DispatcherStats()
+{
+	for (auto& tag : tags) {
+		delete tag.load(std::memory_order_relaxed);
+	}
+}
+
+void DispatcherStats::record(uint16_t tag, uint32_t waitTime, uint32_t executionTime, uint32_t budget)
+{
+	if (tag >= TAG_COUNT) {
+		return;
+	}
+
+	TaskTagStatistics* statistics = tags[tag].load(std::memory_order_acquire);
+	if (!statistics) {
+		TaskTagStatistics* created = new TaskTagStatistics();
+		if (tags[tag].compare_exchange_strong(statistics, created, std::memory_order_acq_rel)) {
+			statistics = created;
+		} else {
+			delete created;
+		}
+	}
+
+	statistics->wait.record(waitTime);
+	statistics->execution.record(executionTime);
+
+	if (budget != 0 && executionTime > budget) {
+		const uint64_t overBudget = statistics->overBudget.fetch_add(1, std::memory_order_relaxed) + 1;
+
+		const int64_t now = OTSYS_TIME();
+		int64_t lastWarning = statistics->lastWarning.load(std::memory_order_relaxed);
+		if (now - lastWarning >= WARNING_INTERVAL && statistics->lastWarning.compare_exchange_strong(lastWarning, now, std::memory_order_relaxed)) {
+			const uint64_t suppressed = overBudget - statistics->warnedOverBudget.exchange(overBudget, std::memory_order_relaxed) - 1;
+			std::cout << "[Warning - Dispatcher] " << getTaskTagName(tag) << " took " << executionTime / 1000. << " ms (waited " << waitTime / 1000. << " ms)";
+			if (suppressed != 0) {
+				std::cout << ", " << suppressed << " more over budget since the last warning";
+			}
+			std::cout << '.' << std::endl;
+		}
+	}
+}
+
+void DispatcherStats::reset()
+{
+	for (auto& tag : tags) {
+		if (TaskTagStatistics* statistics = tag.load(std::memory_order_acquire)) {
+			statistics->wait.reset();
+			statistics->execution.reset();
+			statistics->overBudget.store(0, std::memory_order_relaxed);
+			statistics->warnedOverBudget.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+void DispatcherStats::dump(std::ostream& os) const
+{
+	os << std::left << std::setw(40) << "task" << std::right
+		<< std::setw(10) << "count" << std::setw(12) << "exec total"
+		<< std::setw(10) << "exec p50" << std::setw(10) << "exec p99" << std::setw(10) << "exec max"
+		<< std::setw(10) << "wait p50" << std::setw(10) << "wait p99" << std::setw(10) << "wait max"
+		<< std::setw(8) << "slow" << " (times in us)" << std::endl;
+
+	for (uint32_t tag = 0; tag < TAG_COUNT; ++tag) {
+		const TaskTagStatistics* statistics = getTagStatistics(tag);
+		if (!statistics || statistics->execution.getCount() == 0) {
+			continue;
+		}
+
+		os << std::left << std::setw(40) << getTaskTagName(tag) << std::right
+			<< std::setw(10) << statistics->execution.getCount() << std::setw(12) << statistics->execution.getTotal()
+			<< std::setw(10) << statistics->execution.getPercentile(50) << std::setw(10) << statistics->execution.getPercentile(99) << std::setw(10) << statistics->execution.getMax()
+			<< std::setw(10) << statistics->wait.getPercentile(50) << std::setw(10) << statistics->wait.getPercentile(99) << std::setw(10) << statistics->wait.getMax()
+			<< std::setw(8) << statistics->overBudget.load(std::memory_order_relaxed) << std::endl;
+	}
+}
+
+std::string getTaskTagName(uint16_t tag)
+{
+	static const char* schedulerEventNames[] = {
+		"generic", "creature think", "creature walk", "creature attack", "condition", "player action",
+		"decay", "spawn", "raid", "globalevent", "autosend", "light", "map clean"
+	};
+	static const char* connectionTaskNames[] = {
+		"connect", "release", "login", "character list", "status"
+	};
+
+	const uint8_t detail = static_cast<uint8_t>(tag);
+	std::ostringstream ss;
+	switch (static_cast<TaskKind_t>(tag >> 8)) {
+		case TASK_KIND_PACKET:
+			ss << "packet 0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<uint32_t>(detail);
+			break;
+
+		case TASK_KIND_SCHEDULER:
+			ss << "scheduler ";
+			if (detail < sizeof(schedulerEventNames) / sizeof(schedulerEventNames[0])) {
+				ss << schedulerEventNames[detail];
+			} else {
+				ss << static_cast<uint32_t>(detail);
+			}
+			break;
+
+		case TASK_KIND_DATABASE:
+			ss << "database callback";
+			break;
+
+		case TASK_KIND_LUA:
+			ss << "lua event";
+			break;
+
+		case TASK_KIND_PATH:
+			ss << "path result";
+			break;
+
+		case TASK_KIND_CONNECTION:
+			ss << "connection ";
+			if (detail < sizeof(connectionTaskNames) / sizeof(connectionTaskNames[0])) {
+				ss << connectionTaskNames[detail];
+			} else {
+				ss << static_cast<uint32_t>(detail);
+			}
+			break;
+
+		default:
+			ss << "generic";
+			break;
+	}
+	return ss.str();
+}
+
+const char* getDispatcherLaneName(DispatcherLane_t lane)
+{
+	switch (lane) {
+		case DISPATCHER_LANE_INPUT: return "input";
+		case DISPATCHER_LANE_TIMER: return "timer";
+		case DISPATCHER_LANE_BACKGROUND: return "background";
+		default: return "unknown";
+	}
+}
@@ -0,0 +1,107 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_TASKSTATS_H_1AE3E62B9A504CCF9FACABBFDD458B56
+#define FS_TASKSTATS_H_1AE3E62B9A504CCF9FACABBFDD458B56
+
+#include <array>
+#include <atomic>
+#include "enums.h"
+
+// log-linear histogram of microsecond latencies, every power of two is split into
+// SUB_BUCKET_COUNT linear buckets so the relative error stays below 12.5%
+class LatencyHistogram
+{
+	public:
+		static constexpr uint32_t SUB_BUCKET_BITS = 3;
+		static constexpr uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+		static constexpr uint32_t BUCKET_COUNT = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+		LatencyHistogram() {
+			reset();
+		}
+
+		// non-copyable
+		LatencyHistogram(const LatencyHistogram&) = delete;
+		LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+		void record(uint32_t value);
+		void reset();
+
+		uint64_t getCount() const {
+			return count.load(std::memory_order_relaxed);
+		}
+		uint64_t getTotal() const {
+			return total.load(std::memory_order_relaxed);
+		}
+		uint32_t getMax() const {
+			return max.load(std::memory_order_relaxed);
+		}
+		uint32_t getPercentile(double percentile) const;
+
+	private:
+		static uint32_t getBucketIndex(uint32_t value);
+		static uint32_t getBucketValue(uint32_t index);
+
+		std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets;
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> total;
+		std::atomic<uint32_t> max;
+};
+
+struct TaskTagStatistics
+{
+	LatencyHistogram wait;
+	LatencyHistogram execution;
+	std::atomic<uint64_t> overBudget {0};
+	std::atomic<uint64_t> warnedOverBudget {0};
+	std::atomic<int64_t> lastWarning {0};
+};
+
+class DispatcherStats
+{
+	public:
+		static constexpr uint32_t TAG_COUNT = TASK_KIND_LAST << 8;
+		// over budget tasks are always counted, but warned about at most once per tag and interval
+		static constexpr int64_t WARNING_INTERVAL = 60 * 1000;
+
+		DispatcherStats();
+		~DispatcherStats();
+
+		// non-copyable
+		DispatcherStats(const DispatcherStats&) = delete;
+		DispatcherStats& operator=(const DispatcherStats&) = delete;
+
+		void record(uint16_t tag, uint32_t waitTime, uint32_t executionTime, uint32_t budget);
+		void reset();
+
+		const TaskTagStatistics* getTagStatistics(uint16_t tag) const {
+			return tag < TAG_COUNT ? tags[tag].load(std::memory_order_acquire) : nullptr;
+		}
+
+		void dump(std::ostream& os) const;
+
+	private:
+		std::array<std::atomic<TaskTagStatistics*>, TAG_COUNT> tags;
+};
+
+std::string getTaskTagName(uint16_t tag);
+const char* getDispatcherLaneName(DispatcherLane_t lane);
+
+#endif
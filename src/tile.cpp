@@ -333,7 +333,7 @@ Item* Tile::getItemByTopOrder(int32_t topOrder)
 	//4: creatures
 	if (TileItemVector* items = getItemList()) {
 		for (auto it = ItemVector::const_reverse_iterator(items->getEndTopItem()), end = ItemVector::const_reverse_iterator(items->getBeginTopItem()); it != end; ++it) {
-			if (Item::items[(*it)->getID()].alwaysOnTopOrder == topOrder) {
+			if (Item::items.getPackedType((*it)->getID()).alwaysOnTopOrder == topOrder) {
 				return (*it);
 			}
 		}
@@ -351,15 +351,13 @@ Thing* Tile::getTopVisibleThing(const Creature* creature)
 	TileItemVector* items = getItemList();
 	if (items) {
 		for (auto it = ItemVector::const_reverse_iterator(items->getEndDownItem()), end = ItemVector::const_reverse_iterator(items->getBeginDownItem()); it != end; ++it) {
-			const ItemType& iit = Item::items[(*it)->getID()];
-			if (!iit.lookThrough) {
+			if (!Item::items.getPackedType((*it)->getID()).hasFlag(ITEMFLAG_LOOKTHROUGH)) {
 				return (*it);
 			}
 		}
 
 		for (auto it = ItemVector::const_reverse_iterator(items->getEndTopItem()), end = ItemVector::const_reverse_iterator(items->getBeginTopItem()); it != end; ++it) {
-			const ItemType& iit = Item::items[(*it)->getID()];
-			if (!iit.lookThrough) {
+			if (!Item::items.getPackedType((*it)->getID()).hasFlag(ITEMFLAG_LOOKTHROUGH)) {
 				return (*it);
 			}
 		}
@@ -370,6 +368,10 @@ Thing* Tile::getTopVisibleThing(const Creature* creature)
 
 void Tile::onAddTileItem(Item* item)
 {
+	if (item->isCleanable()) {
+		g_game.map.markCleanable(getPosition());
+	}
+
 	#if GAME_FEATURE_BROWSEFIELD > 0
 	if (item->hasProperty(CONST_PROP_MOVEABLE) || item->getContainer()) {
 		auto it = g_game.browseFields.find(this);
@@ -402,6 +404,10 @@ void Tile::onAddTileItem(Item* item)
 
 void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newItem, const ItemType& newType)
 {
+	if (newItem->isCleanable()) {
+		g_game.map.markCleanable(getPosition());
+	}
+
 	#if GAME_FEATURE_BROWSEFIELD > 0
 	if (newItem->hasProperty(CONST_PROP_MOVEABLE) || newItem->getContainer()) {
 		auto it = g_game.browseFields.find(this);
@@ -607,16 +613,16 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, uint32_t flags
 		} else {
 			//FLAG_IGNOREBLOCKITEM is set
 			if (ground) {
-				const ItemType& iiType = Item::items[ground->getID()];
-				if (iiType.blockSolid && (!iiType.moveable || ground->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID))) {
+				const PackedItemType& iiType = Item::items.getPackedType(ground->getID());
+				if (iiType.hasFlag(ITEMFLAG_BLOCKSOLID) && (!iiType.hasFlag(ITEMFLAG_MOVEABLE) || ground->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID))) {
 					return RETURNVALUE_NOTPOSSIBLE;
 				}
 			}
 
 			if (const auto items = getItemList()) {
 				for (const Item* item : *items) {
-					const ItemType& iiType = Item::items[item->getID()];
-					if (iiType.blockSolid && (!iiType.moveable || item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID))) {
+					const PackedItemType& iiType = Item::items.getPackedType(item->getID());
+					if (iiType.hasFlag(ITEMFLAG_BLOCKSOLID) && (!iiType.hasFlag(ITEMFLAG_MOVEABLE) || item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID))) {
 						return RETURNVALUE_NOTPOSSIBLE;
 					}
 				}
@@ -656,14 +662,14 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, uint32_t flags
 			}
 		} else {
 			if (ground) {
-				const ItemType& iiType = Item::items[ground->getID()];
-				if (iiType.blockSolid) {
-					if (!iiType.allowPickupable || item->isMagicField() || item->isBlocking()) {
+				const PackedItemType& iiType = Item::items.getPackedType(ground->getID());
+				if (iiType.hasFlag(ITEMFLAG_BLOCKSOLID)) {
+					if (!iiType.hasFlag(ITEMFLAG_ALLOWPICKUPABLE) || item->isMagicField() || item->isBlocking()) {
 						if (!item->isPickupable()) {
 							return RETURNVALUE_NOTENOUGHROOM;
 						}
 
-						if (!iiType.hasHeight || iiType.pickupable || iiType.isBed()) {
+						if (!iiType.hasFlag(ITEMFLAG_HASHEIGHT) || iiType.hasFlag(ITEMFLAG_PICKUPABLE) || iiType.hasFlag(ITEMFLAG_BED)) {
 							return RETURNVALUE_NOTENOUGHROOM;
 						}
 					}
@@ -672,12 +678,12 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, uint32_t flags
 
 			if (items) {
 				for (const Item* tileItem : *items) {
-					const ItemType& iiType = Item::items[tileItem->getID()];
-					if (!iiType.blockSolid) {
+					const PackedItemType& iiType = Item::items.getPackedType(tileItem->getID());
+					if (!iiType.hasFlag(ITEMFLAG_BLOCKSOLID)) {
 						continue;
 					}
 
-					if (iiType.allowPickupable && !item->isMagicField() && !item->isBlocking()) {
+					if (iiType.hasFlag(ITEMFLAG_ALLOWPICKUPABLE) && !item->isMagicField() && !item->isBlocking()) {
 						continue;
 					}
 
@@ -685,7 +691,7 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, uint32_t flags
 						return RETURNVALUE_NOTENOUGHROOM;
 					}
 
-					if (!iiType.hasHeight || iiType.pickupable || iiType.isBed()) {
+					if (!iiType.hasFlag(ITEMFLAG_HASHEIGHT) || iiType.hasFlag(ITEMFLAG_PICKUPABLE) || iiType.hasFlag(ITEMFLAG_BED)) {
 						return RETURNVALUE_NOTENOUGHROOM;
 					}
 				}
@@ -830,7 +836,7 @@ void Tile::addThing(int32_t, Thing* thing)
 {
 	Creature* creature = thing->getCreature();
 	if (creature) {
-		g_game.map.clearSpectatorCache(creature->getPlayer());
+		g_game.map.clearSpectatorCache(getPosition(), creature->getPlayer());
 		creature->setParent(this);
 		CreatureVector* creatures = makeCreatures();
 		#if CLIENT_VERSION >= 853
@@ -851,13 +857,14 @@ void Tile::addThing(int32_t, Thing* thing)
 
 		item->setParent(this);
 
-		const ItemType& itemType = Item::items[item->getID()];
-		if (itemType.isGroundTile()) {
+		const PackedItemType& packedType = Item::items.getPackedType(item->getID());
+		if (packedType.hasFlag(ITEMFLAG_GROUND)) {
 			if (ground == nullptr) {
 				ground = item;
 				onAddTileItem(item);
 			} else {
 				const ItemType& oldType = Item::items[ground->getID()];
+				const ItemType& itemType = Item::items[item->getID()];
 
 				Item* oldGround = ground;
 				ground->setParent(nullptr);
@@ -868,12 +875,12 @@ void Tile::addThing(int32_t, Thing* thing)
 				onUpdateTileItem(oldGround, oldType, item, itemType);
 				postRemoveNotification(oldGround, nullptr, 0);
 			}
-		} else if (itemType.alwaysOnTop) {
-			if (itemType.isSplash() && items) {
+		} else if (packedType.hasFlag(ITEMFLAG_ALWAYSONTOP)) {
+			if (packedType.hasFlag(ITEMFLAG_SPLASH) && items) {
 				//remove old splash if exists
 				for (ItemVector::const_iterator it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it) {
 					Item* oldSplash = *it;
-					if (!Item::items[oldSplash->getID()].isSplash()) {
+					if (!Item::items.getPackedType(oldSplash->getID()).hasFlag(ITEMFLAG_SPLASH)) {
 						continue;
 					}
 
@@ -889,7 +896,7 @@ void Tile::addThing(int32_t, Thing* thing)
 			if (items) {
 				for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it) {
 					//Note: this is different from internalAddThing
-					if (itemType.alwaysOnTopOrder <= Item::items[(*it)->getID()].alwaysOnTopOrder) {
+					if (packedType.alwaysOnTopOrder <= Item::items.getPackedType((*it)->getID()).alwaysOnTopOrder) {
 						items->insert(it, item);
 						isInserted = true;
 						break;
@@ -906,7 +913,7 @@ void Tile::addThing(int32_t, Thing* thing)
 			items->addTopItemCount(1);
 			onAddTileItem(item);
 		} else {
-			if (itemType.isMagicField()) {
+			if (packedType.hasFlag(ITEMFLAG_MAGICFIELD)) {
 				//remove old field item if exists
 				if (items) {
 					for (ItemVector::const_iterator it = items->getBeginDownItem(), end = items->getEndDownItem(); it != end; ++it) {
@@ -1036,7 +1043,7 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 		if (creatures) {
 			auto it = std::find(creatures->begin(), creatures->end(), thing);
 			if (it != creatures->end()) {
-				g_game.map.clearSpectatorCache(creature->getPlayer());
+				g_game.map.clearSpectatorCache(getPosition(), creature->getPlayer());
 				creatures->erase(it);
 			}
 		}
@@ -1121,6 +1128,7 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 
 void Tile::removeCreature(Creature* creature)
 {
+	g_game.map.removeObservers(creature, tilePos);
 	g_game.map.getMapSector(tilePos.x, tilePos.y)->removeCreature(creature);
 	removeThing(creature, 0);
 }
@@ -1439,7 +1447,7 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 
 	Creature* creature = thing->getCreature();
 	if (creature) {
-		g_game.map.clearSpectatorCache(creature->getPlayer());
+		g_game.map.clearSpectatorCache(getPosition(), creature->getPlayer());
 		CreatureVector* creatures = makeCreatures();
 		#if CLIENT_VERSION >= 853
 		creatures->insert(creatures->begin(), creature);
@@ -1452,8 +1460,8 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 			return;
 		}
 
-		const ItemType& itemType = Item::items[item->getID()];
-		if (itemType.isGroundTile()) {
+		const PackedItemType& packedType = Item::items.getPackedType(item->getID());
+		if (packedType.hasFlag(ITEMFLAG_GROUND)) {
 			if (ground == nullptr) {
 				ground = item;
 				setTileFlags(item);
@@ -1466,10 +1474,10 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 			return /*RETURNVALUE_NOTPOSSIBLE*/;
 		}
 
-		if (itemType.alwaysOnTop) {
+		if (packedType.hasFlag(ITEMFLAG_ALWAYSONTOP)) {
 			bool isInserted = false;
 			for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it) {
-				if (Item::items[(*it)->getID()].alwaysOnTopOrder > itemType.alwaysOnTopOrder) {
+				if (Item::items.getPackedType((*it)->getID()).alwaysOnTopOrder > packedType.alwaysOnTopOrder) {
 					items->insert(it, item);
 					isInserted = true;
 					break;
@@ -1488,12 +1496,18 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 	}
 }
 
+static bool changesWalkability(const Item* item)
+{
+	const PackedItemType& it = Item::items.getPackedType(item->getID());
+	return it.floorChange != 0 || (it.flags & (ITEMFLAG_GROUND | ITEMFLAG_BLOCKSOLID | ITEMFLAG_BLOCKPATHFIND)) != 0 || item->getTeleport();
+}
+
 void Tile::setTileFlags(const Item* item)
 {
 	if (!hasFlag(TILESTATE_FLOORCHANGE)) {
-		const ItemType& it = Item::items[item->getID()];
-		if (it.floorChange != 0) {
-			setFlag(it.floorChange);
+		uint8_t floorChange = Item::items.getPackedType(item->getID()).floorChange;
+		if (floorChange != 0) {
+			setFlag(floorChange);
 		}
 	}
 
@@ -1549,12 +1563,21 @@ void Tile::setTileFlags(const Item* item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		setFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	if (changesWalkability(item)) {
+		g_game.map.updateWalkability(*this);
+	} else if (item->getMagicField()) {
+		g_game.map.updateFields(*this);
+	}
+
+	if (item->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		g_game.map.updateSightBlock(*this);
+	}
 }
 
 void Tile::resetTileFlags(const Item* item)
 {
-	const ItemType& it = Item::items[item->getID()];
-	if (it.floorChange != 0) {
+	if (Item::items.getPackedType(item->getID()).floorChange != 0) {
 		resetFlag(TILESTATE_FLOORCHANGE);
 	}
 
@@ -1697,6 +1720,16 @@ void Tile::resetTileFlags(const Item* item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		resetFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	if (changesWalkability(item)) {
+		g_game.map.updateWalkability(*this);
+	} else if (item->getMagicField()) {
+		g_game.map.updateFields(*this);
+	}
+
+	if (item->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		g_game.map.updateSightBlock(*this);
+	}
 }
 
 bool Tile::isMoveableBlocking() const
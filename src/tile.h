@@ -242,6 +242,9 @@ class Tile : public Cylinder
 		bool hasProperty(ITEMPROPERTY prop) const;
 		bool hasProperty(const Item* exclude, ITEMPROPERTY prop) const;
 
+		uint32_t getFlags() const {
+			return flags;
+		}
 		bool hasFlag(uint32_t flag) const {
 			return hasBitSet(flag, this->flags);
 		}
@@ -0,0 +1,112 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "workerpool.h"
+
+WorkerPool::~WorkerPool()
+{
+	shutdown();
+}
+
+void WorkerPool::start(size_t threadCount)
+{
+	stopping = false;
+	threads.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&WorkerPool::threadMain, this);
+	}
+}
+
+void WorkerPool::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(jobLock);
+		stopping = true;
+	}
+	jobSignal.notify_all();
+
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+	if (threads.empty() || count <= 1) {
+		for (size_t index = 0; index < count; ++index) {
+			job(index);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lockGuard(jobLock);
+		currentJob = &job;
+		jobCount = count;
+		nextIndex.store(0, std::memory_order_relaxed);
+		activeWorkers = threads.size();
+		++jobGeneration;
+	}
+	jobSignal.notify_all();
+
+	// the calling thread takes its share instead of idling
+	runJob(job, count);
+
+	std::unique_lock<std::mutex> jobLockUnique(jobLock);
+	doneSignal.wait(jobLockUnique, [this]() { return activeWorkers == 0; });
+	currentJob = nullptr;
+}
+
+void WorkerPool::runJob(const std::function<void(size_t)>& job, size_t count)
+{
+	size_t index;
+	while ((index = nextIndex.fetch_add(1, std::memory_order_relaxed)) < count) {
+		job(index);
+	}
+}
+
+void WorkerPool::threadMain()
+{
+	uint64_t seenGeneration = 0;
+
+	std::unique_lock<std::mutex> jobLockUnique(jobLock);
+	while (true) {
+		jobSignal.wait(jobLockUnique, [&]() { return stopping || jobGeneration != seenGeneration; });
+		if (stopping) {
+			break;
+		}
+
+		seenGeneration = jobGeneration;
+		const std::function<void(size_t)>& job = *currentJob;
+		size_t count = jobCount;
+
+		jobLockUnique.unlock();
+		runJob(job, count);
+		jobLockUnique.lock();
+
+		if (--activeWorkers == 0) {
+			doneSignal.notify_one();
+		}
+	}
+}
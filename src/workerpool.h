@@ -0,0 +1,68 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_WORKERPOOL_H_B48CC70378675D4BB4BC87421943052B
+#define FS_WORKERPOOL_H_B48CC70378675D4BB4BC87421943052B
+
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+class WorkerPool
+{
+	public:
+		WorkerPool() = default;
+		~WorkerPool();
+
+		// non-copyable
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		void start(size_t threadCount);
+		void shutdown();
+
+		// Runs job(0) .. job(count - 1) spread over the workers and the calling
+		// thread and returns once every index has been processed. Jobs must not
+		// call parallelFor themselves.
+		void parallelFor(size_t count, const std::function<void(size_t)>& job);
+
+		size_t getThreadCount() const {
+			return threads.size();
+		}
+
+		void threadMain();
+	private:
+		void runJob(const std::function<void(size_t)>& job, size_t count);
+
+		std::vector<std::thread> threads;
+		std::mutex jobLock;
+		std::condition_variable jobSignal;
+		std::condition_variable doneSignal;
+
+		const std::function<void(size_t)>* currentJob = nullptr;
+		std::atomic<size_t> nextIndex{0};
+		size_t jobCount = 0;
+		size_t activeWorkers = 0;
+		uint64_t jobGeneration = 0;
+		bool stopping = false;
+};
+
+extern WorkerPool g_workerPool;
+
+#endif